@@ -0,0 +1,445 @@
+#include "Kr/KrBasic.h"
+#include "Kr/KrString.h"
+#include "StringBuilder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+
+//
+// Starts the server in this process and drives it with concurrent keep-alive clients
+// replaying the samples, then reports the throughput, the latency percentiles and the
+// memory high-water mark. Everything runs on localhost.
+//
+
+#if PLATFORM_LINUX
+
+#include <pthread.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// Defined in Server.cpp
+void RunServer(int port, int reactors, bool sandbox);
+pid_t SandboxForkServerProcess();
+
+// Input given to every sample, the samples reading from the console take what they need
+static const char BenchInput[] = "##INPUT 10 20 30 40 50\n";
+
+struct Bench_Sample
+{
+	char    name[256];
+	String  request;
+};
+
+struct Bench_Options
+{
+	int         clients = 4;
+	int         requests = 100;
+	int         port = 8001;
+	int         reactors = 1;
+	bool        sandbox = false;
+	bool        kill_fork_server = false;
+	const char *path = "/";
+	const char *samples = "Samples";
+	const char *header = nullptr;
+};
+
+struct Bench_Client
+{
+	Bench_Options *options;
+	Bench_Sample * samples;
+	int64_t        sample_count;
+	int            index;
+	double *       latencies;
+	int64_t        bytes;
+	int64_t        failed;
+};
+
+static double bench_seconds()
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static String read_entire_file(const char *file)
+{
+	FILE *f = fopen(file, "rb");
+	if (!f) return String();
+
+	fseek(f, 0, SEEK_END);
+	long fsize = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	uint8_t *string = (uint8_t *)MemoryAllocate(fsize + 1);
+	fread(string, 1, fsize, f);
+	fclose(f);
+
+	string[fsize] = 0;
+	return String(string, (int64_t)fsize);
+}
+
+static bool load_samples(Bench_Options *options, Array<Bench_Sample> *samples)
+{
+	DIR *dir = opendir(options->samples);
+	if (!dir)
+		return false;
+
+	while (auto entry = readdir(dir))
+	{
+		auto name = entry->d_name;
+		auto length = strlen(name);
+		if (length < 3 || strcmp(name + length - 3, ".kn") != 0)
+			continue;
+
+		char file[1024];
+		snprintf(file, sizeof(file), "%s/%s", options->samples, name);
+
+		String code = read_entire_file(file);
+		if (!code.data)
+			continue;
+
+		String_Builder body;
+		if (options->header)
+			WriteFormatted(&body, "%\n", options->header);
+		Write(&body, BenchInput);
+		Write(&body, code);
+
+		String_Builder request;
+		WriteFormatted(&request, "POST % HTTP/1.1\r\nHost: localhost\r\nConnection: keep-alive\r\nContent-Length: %\r\n\r\n", options->path, body.written);
+		for (auto buk = &body.head; buk; buk = buk->next)
+			WriteBuffer(&request, buk->data, buk->written);
+
+		auto sample = samples->Add();
+		snprintf(sample->name, sizeof(sample->name), "%s", name);
+		sample->request = BuildString(&request);
+
+		FreeBuilder(&request);
+		FreeBuilder(&body);
+		MemoryFree(code.data, code.length + 1);
+	}
+
+	closedir(dir);
+
+	// Same order on every run
+	qsort(samples->data, samples->count, sizeof(Bench_Sample), [](const void *a, const void *b) -> int {
+		return strcmp(((Bench_Sample *)a)->name, ((Bench_Sample *)b)->name);
+	});
+
+	return samples->count != 0;
+}
+
+static int bench_connect(int port)
+{
+	sockaddr_in addr = {};
+	addr.sin_family      = AF_INET;
+	addr.sin_port        = htons((uint16_t)port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	// The server might still be starting
+	for (int attempt = 0; attempt < 100; ++attempt)
+	{
+		int fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0)
+			return -1;
+
+		if (connect(fd, (sockaddr *)&addr, sizeof(addr)) == 0)
+		{
+			int flag = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+			return fd;
+		}
+
+		close(fd);
+		usleep(20000);
+	}
+
+	return -1;
+}
+
+static bool send_all(int fd, uint8_t *data, int64_t length)
+{
+	while (length > 0)
+	{
+		auto sent = send(fd, data, length, MSG_NOSIGNAL);
+		if (sent <= 0)
+			return false;
+		data += sent;
+		length -= sent;
+	}
+	return true;
+}
+
+// Reads one response and returns the length of its body, -1 on failure
+static int64_t receive_response(int fd, Array<uint8_t> *buffer)
+{
+	buffer->count = 0;
+
+	int64_t header_end = -1;
+	int64_t content_length = -1;
+
+	while (true)
+	{
+		if (buffer->allocated - buffer->count < 64 * 1024)
+			buffer->Reserve(buffer->allocated + 256 * 1024);
+
+		auto received = recv(fd, buffer->data + buffer->count, buffer->allocated - buffer->count, 0);
+		if (received <= 0)
+			return -1;
+		buffer->count += received;
+
+		if (header_end < 0)
+		{
+			String text(buffer->data, buffer->count);
+			auto pos = StrFind(text, "\r\n\r\n", 0);
+			if (pos < 0)
+				continue;
+
+			header_end = pos + 4;
+
+			String headers = SubStr(text, 0, pos);
+			for (ptrdiff_t index = 0; index < headers.length; ++index)
+			{
+				String rest = StrRemovePrefix(headers, index);
+				if (rest.length > 15 && StrMatchCaseInsensitive(SubStr(rest, 0, 15), "Content-Length:"))
+				{
+					content_length = strtoll((char *)rest.data + 15, nullptr, 10);
+					break;
+				}
+			}
+
+			if (content_length < 0)
+				return -1;
+		}
+
+		if (buffer->count >= header_end + content_length)
+			return content_length;
+	}
+}
+
+static void *bench_client(void *param)
+{
+	auto client  = (Bench_Client *)param;
+	auto options = client->options;
+
+	InitThreadContext(0);
+
+	Array<uint8_t> buffer;
+
+	int fd = bench_connect(options->port);
+
+	for (int request = 0; request < options->requests; ++request)
+	{
+		auto sample = &client->samples[(client->index + request) % client->sample_count];
+
+		double start = bench_seconds();
+
+		int64_t length = -1;
+		if (fd >= 0 && send_all(fd, sample->request.data, sample->request.length))
+			length = receive_response(fd, &buffer);
+
+		client->latencies[request] = bench_seconds() - start;
+
+		if (length < 0)
+		{
+			client->failed += 1;
+
+			// The connection is not usable after a failure
+			if (fd >= 0) close(fd);
+			fd = bench_connect(options->port);
+			continue;
+		}
+
+		client->bytes += length;
+	}
+
+	if (fd >= 0) close(fd);
+	Free(&buffer);
+
+	return nullptr;
+}
+
+static void *bench_server(void *param)
+{
+	auto options = (Bench_Options *)param;
+	RunServer(options->port, options->reactors, options->sandbox);
+	return nullptr;
+}
+
+static double percentile(double *sorted, int64_t count, double fraction)
+{
+	int64_t index = (int64_t)ceil(fraction * count) - 1;
+	return sorted[Clamp(0, count - 1, index)];
+}
+
+static void print_usage(const char *program)
+{
+	fprintf(stderr, "Usage: %s [-c clients] [-n requests per client] [-p port] [-reactors count] [-sandbox] [-kill-fork-server] [-path /|/run] [-header \"##TRACE delta\"] [samples directory]\n\n", program);
+}
+
+int main(int argc, char **argv)
+{
+	InitThreadContext(0);
+
+	Bench_Options options;
+
+	for (int index = 1; index < argc; ++index)
+	{
+		auto arg = argv[index];
+		bool has_value = index + 1 < argc;
+
+		if (strcmp(arg, "-c") == 0 && has_value)
+			options.clients = atoi(argv[++index]);
+		else if (strcmp(arg, "-n") == 0 && has_value)
+			options.requests = atoi(argv[++index]);
+		else if (strcmp(arg, "-p") == 0 && has_value)
+			options.port = atoi(argv[++index]);
+		else if (strcmp(arg, "-reactors") == 0 && has_value)
+			options.reactors = atoi(argv[++index]);
+		else if (strcmp(arg, "-sandbox") == 0)
+			options.sandbox = true;
+		else if (strcmp(arg, "-kill-fork-server") == 0)
+			options.kill_fork_server = true;
+		else if (strcmp(arg, "-path") == 0 && has_value)
+			options.path = argv[++index];
+		else if (strcmp(arg, "-header") == 0 && has_value)
+			options.header = argv[++index];
+		else if (arg[0] != '-')
+			options.samples = arg;
+		else
+		{
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (options.clients <= 0 || options.requests <= 0 || (options.kill_fork_server && !options.sandbox))
+	{
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	Array<Bench_Sample> samples;
+	if (!load_samples(&options, &samples))
+	{
+		fprintf(stderr, "No samples found in \"%s\".\n\n", options.samples);
+		return 1;
+	}
+
+	// The server prints the requests and the program output, the report goes to the original stdout
+	FILE *report = fdopen(dup(fileno(stdout)), "w");
+	if (!report || !freopen("/dev/null", "w", stdout))
+	{
+		fprintf(stderr, "Could not redirect the server output.\n\n");
+		return 1;
+	}
+
+	pthread_t server;
+	pthread_create(&server, nullptr, bench_server, &options);
+	pthread_detach(server);
+
+	int64_t total = (int64_t)options.clients * options.requests;
+
+	auto latencies = new double[total];
+	auto clients   = new Bench_Client[options.clients];
+	auto threads   = new pthread_t[options.clients];
+
+	for (int index = 0; index < options.clients; ++index)
+	{
+		auto client = &clients[index];
+		client->options      = &options;
+		client->samples      = samples.data;
+		client->sample_count = samples.count;
+		client->index        = index;
+		client->latencies    = latencies + (int64_t)index * options.requests;
+		client->bytes        = 0;
+		client->failed       = 0;
+	}
+
+	// Warm up the server with every sample once
+	{
+		Bench_Options warmup = options;
+		warmup.requests = (int)samples.count;
+
+		Bench_Client client = clients[0];
+		client.options   = &warmup;
+		client.latencies = new double[samples.count];
+		bench_client(&client);
+		delete[] client.latencies;
+
+		if (client.failed == samples.count)
+		{
+			fprintf(stderr, "Could not connect to the server on port %d.\n\n", options.port);
+			return 1;
+		}
+	}
+
+	// The sandbox restarts its fork server, no request may fail because of it
+	if (options.kill_fork_server)
+	{
+		pid_t fork_server = SandboxForkServerProcess();
+		if (fork_server <= 0 || kill(fork_server, SIGKILL) != 0)
+		{
+			fprintf(stderr, "Could not kill the sandbox fork server.\n\n");
+			return 1;
+		}
+	}
+
+	double start = bench_seconds();
+
+	for (int index = 0; index < options.clients; ++index)
+		pthread_create(&threads[index], nullptr, bench_client, &clients[index]);
+	for (int index = 0; index < options.clients; ++index)
+		pthread_join(threads[index], nullptr);
+
+	double elapsed = bench_seconds() - start;
+
+	int64_t bytes = 0, failed = 0;
+	for (int index = 0; index < options.clients; ++index)
+	{
+		bytes  += clients[index].bytes;
+		failed += clients[index].failed;
+	}
+
+	qsort(latencies, total, sizeof(double), [](const void *a, const void *b) -> int {
+		double x = *(double *)a, y = *(double *)b;
+		return (x > y) - (x < y);
+	});
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	fprintf(report, "samples     : %d from %s\n", (int)samples.count, options.samples);
+	fprintf(report, "path        : %s%s%s\n", options.path, options.header ? " " : "", options.header ? options.header : "");
+	fprintf(report, "clients     : %d x %d requests\n", options.clients, options.requests);
+	fprintf(report, "reactors    : %d%s\n", options.reactors, options.sandbox ? (options.kill_fork_server ? ", sandbox, fork server killed" : ", sandbox") : "");
+	fprintf(report, "failed      : %zd\n", failed);
+	fprintf(report, "elapsed     : %.3f s\n", elapsed);
+	fprintf(report, "throughput  : %.1f requests/s, %.2f MB/s\n", total / elapsed, bytes / elapsed / (1024.0 * 1024.0));
+	fprintf(report, "latency p50 : %.3f ms\n", percentile(latencies, total, 0.50) * 1000);
+	fprintf(report, "latency p99 : %.3f ms\n", percentile(latencies, total, 0.99) * 1000);
+	fprintf(report, "latency p999: %.3f ms\n", percentile(latencies, total, 0.999) * 1000);
+	fprintf(report, "latency max : %.3f ms\n", latencies[total - 1] * 1000);
+	fprintf(report, "memory peak : %.1f MB\n", usage.ru_maxrss / 1024.0);
+	fflush(report);
+
+	// The server thread never returns
+	_exit(failed ? 1 : 0);
+}
+
+#else
+
+int main(int argc, char **argv)
+{
+	fprintf(stderr, "Error: kano-bench is only supported on Linux\n");
+	return 1;
+}
+
+#endif
@@ -1,6 +1,8 @@
 #pragma once
 #include "SyntaxNode.h"
 
+#include <atomic>
+
 using Kano_Char = uint8_t;
 using Kano_Int  = int64_t;
 using Kano_Real = double;
@@ -18,15 +20,20 @@ enum Code_Type_Kind
 	CODE_TYPE_STRUCT,
 	CODE_TYPE_ARRAY_VIEW,
 	CODE_TYPE_STATIC_ARRAY,
+	CODE_TYPE_SIZED_INTEGER,
+	CODE_TYPE_SIZED_REAL,
 
 	_CODE_TYPE_COUNT
 };
 
 struct Code_Type
 {
-	Code_Type_Kind kind         = CODE_TYPE_NULL;
-	uint32_t       runtime_size = 0;
-	uint32_t       alignment    = 0;
+	Code_Type_Kind    kind         = CODE_TYPE_NULL;
+	uint32_t          runtime_size = 0;
+	uint32_t          alignment    = 0;
+
+	// Published once complete, the types are shared by the threads of the execution
+	std::atomic<struct Type_Info *> info = { nullptr };
 };
 
 struct Code_Type_Character : public Code_Type
@@ -59,6 +66,41 @@ struct Code_Type_Real : public Code_Type
 	}
 };
 
+// The narrow types are only for storage, the operators promote them to int and float
+struct Code_Type_Sized_Integer : public Code_Type
+{
+	bool is_signed = true;
+
+	Code_Type_Sized_Integer(uint32_t size, bool sign)
+	{
+		kind         = CODE_TYPE_SIZED_INTEGER;
+		runtime_size = size;
+		alignment    = size;
+		is_signed    = sign;
+	}
+};
+
+struct Code_Type_Sized_Real : public Code_Type
+{
+	Code_Type_Sized_Real()
+	{
+		kind         = CODE_TYPE_SIZED_REAL;
+		runtime_size = sizeof(float);
+		alignment    = sizeof(float);
+	}
+};
+
+inline Kano_Int code_type_sized_integer_value(uint32_t size, bool is_signed, const void *data)
+{
+	switch (size)
+	{
+		case 1: return is_signed ? (Kano_Int)*(const int8_t *)data : (Kano_Int)*(const uint8_t *)data;
+		case 2: return is_signed ? (Kano_Int)*(const int16_t *)data : (Kano_Int)*(const uint16_t *)data;
+		case 4: return is_signed ? (Kano_Int)*(const int32_t *)data : (Kano_Int)*(const uint32_t *)data;
+	}
+	return 0;
+}
+
 struct Code_Type_Bool : public Code_Type
 {
 	Code_Type_Bool()
@@ -104,9 +146,21 @@ struct Code_Type_Procedure : public Code_Type
 	int64_t    argument_count = 0;
 	bool        is_variadic    = false;
 
+	// SYMBOL_BIT_REFERENCE and SYMBOL_BIT_READ_ONLY of the 'ref' and 'in' arguments, null when all
+	// the arguments are passed by value. The type of the argument passed by reference is its pointer
+	uint32_t *  argument_flags = nullptr;
+
 	Code_Type * return_type    = nullptr;
+
+	// Set on the C procedures that can be called concurrently without the lock of the shared state
+	bool        thread_safe    = false;
 };
 
+inline uint32_t code_type_argument_flags(Code_Type_Procedure *proc, int64_t index)
+{
+	return proc->argument_flags ? proc->argument_flags[index] : 0;
+}
+
 struct Code_Type_Struct : public Code_Type
 {
 	Code_Type_Struct()
@@ -138,6 +192,7 @@ struct Code_Type_Array_View : public Code_Type
 	}
 
 	Code_Type *element_type = nullptr;
+	bool       soa          = false;
 };
 
 struct Code_Type_Static_Array : public Code_Type
@@ -149,6 +204,10 @@ struct Code_Type_Static_Array : public Code_Type
 
 	Code_Type *element_type  = nullptr;
 	uint32_t   element_count = 0;
+
+	// The #soa arrays of structs keep each member in its own block of element_count values,
+	// the block of a member starts at element_count times the offset of the member
+	bool       soa           = false;
 };
 
 //
@@ -240,6 +299,8 @@ enum Code_Node_Kind
 	CODE_NODE_TYPE_CAST,
 	CODE_NODE_UNARY_OPERATOR,
 	CODE_NODE_BINARY_OPERATOR,
+	CODE_NODE_ARRAY_OPERATOR,
+	CODE_NODE_VECTOR,
 	CODE_NODE_EXPRESSION,
 	CODE_NODE_ASSIGNMENT,
 	CODE_NODE_RETURN,
@@ -253,6 +314,7 @@ enum Code_Node_Kind
 	CODE_NODE_FOR,
 	CODE_NODE_WHILE,
 	CODE_NODE_DO,
+	CODE_NODE_SPAWN,
 	CODE_NODE_BLOCK,
 
 	_CODE_NODE_COUNT,
@@ -421,6 +483,49 @@ struct Code_Node_Binary_Operator : public Code_Node
 	Code_Node *          right = nullptr;
 };
 
+// Element wise arithmetic of the arrays of int or float, either operand may be a scalar that is broadcast.
+// Nested static arrays are flattened, the result of the non compound operators is written in the frame at stack_top
+struct Code_Node_Array_Operator : public Code_Node
+{
+	Code_Node_Array_Operator()
+	{
+		kind = CODE_NODE_ARRAY_OPERATOR;
+	}
+
+	Binary_Operator_Kind op_kind;
+
+	Code_Node *          left  = nullptr;
+	Code_Node *          right = nullptr;
+
+	Code_Type *          element_type = nullptr;
+	uint64_t             stack_top    = 0;
+};
+
+enum Vector_Intrinsic
+{
+	VECTOR_INTRINSIC_LENGTH,
+	VECTOR_INTRINSIC_NORMALIZE,
+	VECTOR_INTRINSIC_CROSS,
+	VECTOR_INTRINSIC_SWIZZLE,
+};
+
+// The operations on the static arrays of 2 to 4 numbers (vec2, vec3, vec4 and the int versions), the vector
+// results are written in the frame at stack_top
+struct Code_Node_Vector : public Code_Node
+{
+	Code_Node_Vector()
+	{
+		kind = CODE_NODE_VECTOR;
+	}
+
+	Vector_Intrinsic intrinsic;
+
+	Code_Node *      arguments[2] = {};
+	uint8_t          swizzle[4]   = {};
+
+	uint64_t         stack_top    = 0;
+};
+
 struct Code_Node_Expression : public Code_Node
 {
 	Code_Node_Expression()
@@ -510,6 +615,11 @@ struct Code_Node_Subscript : public Code_Node
 
 	Code_Node_Expression *expression = nullptr;
 	Code_Node_Expression *subscript  = nullptr;
+
+	// Set when a member of the element of #soa array is addressed, the type of the
+	// address is then the type of the member
+	bool                  soa        = false;
+	uint64_t              soa_offset = 0;
 };
 
 struct Code_Node_Offset : public Code_Node
@@ -549,6 +659,15 @@ struct Code_Node_For : public Code_Node
 	Code_Node_Statement * body           = nullptr;
 
 	Symbol_Table          symbols;
+
+	// Set for the parallel loops, the induction variable goes from its initial value
+	// by step until the bound, the variables from private_offset are per worker
+	bool                  parallel       = false;
+	uint64_t              private_offset = 0;
+	uint64_t              induction      = 0;
+	Binary_Operator_Kind  compare        = BINARY_OPERATOR_RELATIONAL_LESS;
+	Code_Node *           bound          = nullptr;
+	Kano_Int              step           = 0;
 };
 
 struct Code_Node_While : public Code_Node
@@ -575,6 +694,16 @@ struct Code_Node_Do : public Code_Node
 	Code_Node_Statement *condition = nullptr;
 };
 
+struct Code_Node_Spawn : public Code_Node
+{
+	Code_Node_Spawn()
+	{
+		kind = CODE_NODE_SPAWN;
+	}
+
+	Code_Node_Procedure_Call *call = nullptr;
+};
+
 struct Code_Node_Block : public Code_Node
 {
 	Code_Node_Block()
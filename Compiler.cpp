@@ -5,6 +5,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 void AssertHandle(const char *reason, const char *file, int line, const char *proc)
 {
@@ -45,15 +46,27 @@ int main(int argc, char **argv)
 	parser_register_error_proc(parser_on_error);
 	code_type_resolver_register_error_proc(code_type_resolver_on_error);
 
-	if (argc != 2) {
+	const char *file = nullptr;
+	for (int index = 1; index < argc; ++index) {
+		if (strcmp(argv[index], "-parallel") == 0 && index + 1 < argc) {
+			interp_parallel_threads(atoi(argv[++index]));
+		} else if (!file) {
+			file = argv[index];
+		} else {
+			file = nullptr;
+			break;
+		}
+	}
+
+	if (!file) {
 		fprintf(stderr, "Error: Expected file\n");
-		fprintf(stderr, "\tUsage: %s <file>\n\n", argv[0]);
+		fprintf(stderr, "\tUsage: %s [-parallel threads] <file>\n\n", argv[0]);
 		return 1;
 	}
 
-	String code = read_entire_file(argv[1]);
+	String code = read_entire_file(file);
 	if (!code.data) {
-		fprintf(stderr, "File \"%s\" could not be read.\n\n", argv[1]);
+		fprintf(stderr, "File \"%s\" could not be read.\n\n", file);
 		return 1;
 	}
 
@@ -6,3 +6,7 @@ constexpr uint32_t SYMBOL_BIT_CONSTANT     = 0x2;
 constexpr uint32_t SYMBOL_BIT_TYPE         = 0x4;
 constexpr uint32_t SYMBOL_BIT_CONST_EXPR   = 0x8;
 constexpr uint32_t SYMBOL_BIT_COMPILER_DEF = 0x10;
+constexpr uint32_t SYMBOL_BIT_INTRINSIC    = 0x20;
+constexpr uint32_t SYMBOL_BIT_SOA_ELEMENT  = 0x40;
+constexpr uint32_t SYMBOL_BIT_REFERENCE    = 0x80;
+constexpr uint32_t SYMBOL_BIT_READ_ONLY    = 0x100;
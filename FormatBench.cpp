@@ -0,0 +1,161 @@
+#include "Kr/KrBasic.h"
+#include "StringBuilder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+
+//
+// Compares the number formatting of String_Builder against snprintf,
+// the output of both is checked to be the same before timing them
+//
+
+void AssertHandle(const char *reason, const char *file, int line, const char *proc)
+{
+	fprintf(stderr, "Internal Compiler Error %s. File: %s(%d)\n", reason, file, line);
+	DebugTriggerbreakpoint();
+}
+
+constexpr int FORMAT_BENCH_COUNT = 1000000;
+
+static uint64_t bench_random_state = 0x9e3779b97f4a7c15;
+
+static uint64_t bench_random()
+{
+	// xorshift64*
+	bench_random_state ^= bench_random_state >> 12;
+	bench_random_state ^= bench_random_state << 25;
+	bench_random_state ^= bench_random_state >> 27;
+	return bench_random_state * 0x2545f4914f6cdd1d;
+}
+
+static double bench_seconds()
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static bool compare_output(String_Builder *builder, const char *expected, const char *what)
+{
+	String result = BuildString(builder);
+	ResetBuilder(builder);
+
+	bool same = result.length == (int64_t)strlen(expected) && memcmp(result.data, expected, result.length) == 0;
+	if (!same)
+	{
+		fprintf(stderr, "Mismatch for %s: expected \"%s\", got \"%.*s\"\n", what, expected, (int)result.length, result.data);
+	}
+
+	MemoryFree(result.data, result.length + 1);
+	return same;
+}
+
+static bool verify(int64_t *integers, double *reals)
+{
+	String_Builder builder;
+	char buffer[512];
+	bool ok = true;
+
+	for (int index = 0; index < FORMAT_BENCH_COUNT; ++index)
+	{
+		Write(&builder, integers[index]);
+		snprintf(buffer, sizeof(buffer), "%zd", integers[index]);
+		ok &= compare_output(&builder, buffer, "int64_t");
+
+		Write(&builder, reals[index]);
+		snprintf(buffer, sizeof(buffer), "%.2f", reals[index]);
+		ok &= compare_output(&builder, buffer, "double");
+	}
+
+	int64_t edge_integers[] = { 0, 9, 10, 99, 100, -1, INT64_MAX, INT64_MIN };
+	for (auto value : edge_integers)
+	{
+		Write(&builder, value);
+		snprintf(buffer, sizeof(buffer), "%zd", value);
+		ok &= compare_output(&builder, buffer, "int64_t");
+	}
+
+	double edge_reals[] = { 0.0, -0.0, 0.005, 0.015, 0.125, 0.375, 2.675, 1.005, -0.001, 99.995, 9.999,
+		1e-300, 4.5e15, 9.2e18, 1e19, 1e300, -1e300, INFINITY, -INFINITY, NAN };
+	for (auto value : edge_reals)
+	{
+		Write(&builder, value);
+		snprintf(buffer, sizeof(buffer), "%.2f", value);
+		ok &= compare_output(&builder, buffer, "double");
+	}
+
+	void *pointers[] = { nullptr, (void *)0x1234, (void *)0x7ffd5a3c1e20, (void *)UINT64_MAX };
+	for (auto value : pointers)
+	{
+		Write(&builder, value);
+		snprintf(buffer, sizeof(buffer), "%08llx", (unsigned long long)(size_t)value);
+		ok &= compare_output(&builder, buffer, "pointer");
+	}
+
+	FreeBuilder(&builder);
+	return ok;
+}
+
+template <typename Type>
+static void bench(const char *name, const char *format, Type *values)
+{
+	String_Builder builder;
+	char buffer[512];
+
+	double start = bench_seconds();
+	for (int index = 0; index < FORMAT_BENCH_COUNT; ++index)
+	{
+		int written = snprintf(buffer, sizeof(buffer), format, values[index]);
+		WriteBuffer(&builder, buffer, written);
+	}
+	double snprintf_time = bench_seconds() - start;
+	int64_t snprintf_size = builder.written;
+	ResetBuilder(&builder);
+
+	start = bench_seconds();
+	for (int index = 0; index < FORMAT_BENCH_COUNT; ++index)
+	{
+		Write(&builder, values[index]);
+	}
+	double write_time = bench_seconds() - start;
+	int64_t write_size = builder.written;
+
+	FreeBuilder(&builder);
+
+	printf("%-8s snprintf: %7.2f ms  Write: %7.2f ms  speedup: %5.2fx  (%zd/%zd bytes)\n",
+		name, snprintf_time * 1000, write_time * 1000, snprintf_time / write_time, snprintf_size, write_size);
+}
+
+int main(int argc, char **argv)
+{
+	InitThreadContext(0);
+
+	auto integers = new int64_t[FORMAT_BENCH_COUNT];
+	auto small    = new int64_t[FORMAT_BENCH_COUNT];
+	auto reals    = new double[FORMAT_BENCH_COUNT];
+
+	for (int index = 0; index < FORMAT_BENCH_COUNT; ++index)
+	{
+		integers[index] = (int64_t)bench_random();
+		small[index]    = (int64_t)(bench_random() % 2000) - 1000;
+
+		// Mix of magnitudes, most values in the traces are small
+		double mantissa = (double)(bench_random() >> 11) / (double)(1ull << 53);
+		int exponent    = (int)(bench_random() % 16) - 4;
+		reals[index]    = (bench_random() & 1 ? -1 : 1) * mantissa * pow(10.0, exponent);
+	}
+
+	if (!verify(integers, reals))
+	{
+		fprintf(stderr, "Error: Formatting does not match snprintf\n");
+		return 1;
+	}
+
+	bench("int64", "%zd", integers);
+	bench("small", "%zd", small);
+	bench("double", "%.2f", reals);
+
+	return 0;
+}
@@ -1,6 +1,19 @@
 #pragma once
 #include "Kr/KrBasic.h"
 
+#include <atomic>
+#include <mutex>
+
+// The memories double in size, the address space runs out long before this
+constexpr int HEAP_MAX_MEMORIES = 48;
+
+// In the concurrent mode the small blocks are recycled through per thread caches of
+// power of two size classes, the shared free list is only locked to refill or drain them
+constexpr uint64_t HEAP_CACHE_MIN_SIZE = 16;
+constexpr int      HEAP_CACHE_CLASSES  = 8;
+constexpr int      HEAP_CACHE_BATCH    = 16;
+constexpr int      HEAP_CACHE_CAPACITY = 64;
+
 struct Heap_Allocator
 {
 	struct Memory
@@ -23,17 +36,36 @@ struct Heap_Allocator
 
 	uint64_t allocation = 0;
 
-	uint64_t total_allocated = 0;
-	uint64_t total_freed = 0;
-	
-	Array<Memory> memories;
+	std::atomic<uint64_t> total_allocated = { 0 };
+	std::atomic<uint64_t> total_freed = { 0 };
+
+	// Only appended to, so that the lookups do not need the lock
+	Memory           memories[HEAP_MAX_MEMORIES];
+	std::atomic<int> memory_count = { 0 };
+
+	// Set once the heap is used by several threads, guards the free list and the memories
+	bool       concurrent = false;
+	uint64_t   id = 0;
+	std::mutex lock;
 };
 
+struct Heap_Cache
+{
+	uint64_t                heap_id = 0;
+	Heap_Allocator::Bucket *lists[HEAP_CACHE_CLASSES] = {};
+	int                     counts[HEAP_CACHE_CLASSES] = {};
+};
+
+inline std::atomic<uint64_t> HeapIds;
+inline thread_local Heap_Cache HeapCache;
+
 static inline bool heap_contains_memory(Heap_Allocator *allocator, void *ptr)
 {
-	for (auto memory : allocator->memories)
+	int count = allocator->memory_count.load(std::memory_order_acquire);
+	for (int index = 0; index < count; ++index)
 	{
-		if (ptr >= memory.ptr && ptr < (uint8_t *)memory.ptr + memory.size)
+		auto memory = &allocator->memories[index];
+		if (ptr >= memory->ptr && ptr < (uint8_t *)memory->ptr + memory->size)
 		{
 			return true;
 		}
@@ -42,22 +74,15 @@ static inline bool heap_contains_memory(Heap_Allocator *allocator, void *ptr)
 	return false;
 }
 
-static inline void heap_free(Heap_Allocator *allocator, void *ptr)
+static inline void heap_push_free(Heap_Allocator *allocator, Heap_Allocator::Bucket *buk)
 {
-	if (heap_contains_memory(allocator, ptr))
-	{
-		auto buk = (Heap_Allocator::Bucket *)((uint8_t *)ptr - sizeof(Heap_Allocator::Bucket::size));
-		allocator->total_freed += buk->size;
-		buk->next[0] = allocator->free_list;
-		allocator->free_list = buk;
-	}
+	buk->next[0] = allocator->free_list;
+	allocator->free_list = buk;
 }
 
-static inline void *heap_alloc(Heap_Allocator *allocator, uint64_t size)
+// First fit from the free list, the memory is grown when nothing fits
+static inline Heap_Allocator::Bucket *heap_alloc_bucket(Heap_Allocator *allocator, uint64_t size)
 {
-	size = Maximum(size, sizeof(Heap_Allocator::Bucket::ptr));
-	allocator->total_allocated += size;
-
 	Heap_Allocator::Bucket *parent = nullptr;
 	for (auto buk = allocator->free_list; buk; buk = buk->next[0])
 	{
@@ -75,8 +100,7 @@ static inline void *heap_alloc(Heap_Allocator *allocator, uint64_t size)
 					allocator->free_list = next;
 
 				buk->size = size;
-				memset(buk->ptr, 0, size);
-				return (void *)buk->ptr;
+				return buk;
 			}
 			else
 			{
@@ -84,8 +108,7 @@ static inline void *heap_alloc(Heap_Allocator *allocator, uint64_t size)
 					parent->next[0] = buk->next[0];
 				else
 					allocator->free_list = buk->next[0];
-				memset(buk->ptr, 0, size);
-				return (void *)buk->ptr;
+				return buk;
 			}
 		}
 
@@ -100,12 +123,135 @@ static inline void *heap_alloc(Heap_Allocator *allocator, uint64_t size)
 	mem.size = allocator->allocation;
 	mem.ptr = MemoryAllocate(mem.size);
 
-	allocator->memories.Add(mem);
-	
+	int count = allocator->memory_count.load(std::memory_order_relaxed);
+	Assert(count < HEAP_MAX_MEMORIES);
+	allocator->memories[count] = mem;
+	allocator->memory_count.store(count + 1, std::memory_order_release);
+
 	auto buk = (Heap_Allocator::Bucket *)mem.ptr;
 	buk->size = mem.size - sizeof(buk->size);
-	buk->next[0] = allocator->free_list;
-	allocator->free_list = buk;
+	heap_push_free(allocator, buk);
+
+	return heap_alloc_bucket(allocator, size);
+}
+
+// Size class of a block, -1 when the block is not cached
+static inline int heap_cache_class(uint64_t size)
+{
+	uint64_t class_size = HEAP_CACHE_MIN_SIZE;
+	for (int index = 0; index < HEAP_CACHE_CLASSES; ++index, class_size *= 2)
+	{
+		if (size <= class_size)
+			return index;
+	}
+	return -1;
+}
+
+static inline Heap_Cache *heap_cache(Heap_Allocator *allocator)
+{
+	// The blocks cached for a heap that no longer exists are dropped
+	auto cache = &HeapCache;
+	if (cache->heap_id != allocator->id)
+	{
+		*cache         = Heap_Cache();
+		cache->heap_id = allocator->id;
+	}
+	return cache;
+}
+
+static inline void heap_make_concurrent(Heap_Allocator *allocator)
+{
+	if (!allocator->concurrent)
+	{
+		allocator->id         = HeapIds.fetch_add(1) + 1;
+		allocator->concurrent = true;
+	}
+}
+
+static inline void heap_free(Heap_Allocator *allocator, void *ptr)
+{
+	if (heap_contains_memory(allocator, ptr))
+	{
+		auto buk = (Heap_Allocator::Bucket *)((uint8_t *)ptr - sizeof(Heap_Allocator::Bucket::size));
+		allocator->total_freed += buk->size;
+
+		if (!allocator->concurrent)
+		{
+			heap_push_free(allocator, buk);
+			return;
+		}
+
+		// Only the blocks of the exact class size go back to a cache
+		int index = heap_cache_class(buk->size);
+		if (index < 0 || buk->size != (HEAP_CACHE_MIN_SIZE << index))
+		{
+			std::lock_guard<std::mutex> guard(allocator->lock);
+			heap_push_free(allocator, buk);
+			return;
+		}
+
+		auto cache = heap_cache(allocator);
+		buk->next[0] = cache->lists[index];
+		cache->lists[index] = buk;
+		cache->counts[index] += 1;
+
+		if (cache->counts[index] > HEAP_CACHE_CAPACITY)
+		{
+			std::lock_guard<std::mutex> guard(allocator->lock);
+			while (cache->counts[index] > HEAP_CACHE_CAPACITY / 2)
+			{
+				auto drained = cache->lists[index];
+				cache->lists[index] = drained->next[0];
+				cache->counts[index] -= 1;
+				heap_push_free(allocator, drained);
+			}
+		}
+	}
+}
+
+static inline void *heap_alloc(Heap_Allocator *allocator, uint64_t size)
+{
+	size = Maximum(size, sizeof(Heap_Allocator::Bucket::ptr));
+
+	Heap_Allocator::Bucket *buk = nullptr;
+
+	if (!allocator->concurrent)
+	{
+		allocator->total_allocated += size;
+		buk = heap_alloc_bucket(allocator, size);
+	}
+	else
+	{
+		int index = heap_cache_class(size);
+		if (index < 0)
+		{
+			std::lock_guard<std::mutex> guard(allocator->lock);
+			buk = heap_alloc_bucket(allocator, size);
+		}
+		else
+		{
+			auto cache = heap_cache(allocator);
+			if (!cache->lists[index])
+			{
+				std::lock_guard<std::mutex> guard(allocator->lock);
+				for (int count = 0; count < HEAP_CACHE_BATCH; ++count)
+				{
+					auto refill = heap_alloc_bucket(allocator, HEAP_CACHE_MIN_SIZE << index);
+					refill->next[0] = cache->lists[index];
+					cache->lists[index] = refill;
+					cache->counts[index] += 1;
+				}
+			}
+
+			buk = cache->lists[index];
+			cache->lists[index] = buk->next[0];
+			cache->counts[index] -= 1;
+		}
+
+		// The whole block is counted since the freed size is read from the block
+		allocator->total_allocated += buk->size;
+	}
 
-	return heap_alloc(allocator, size);
+	memset(buk->ptr, 0, size);
+	return (void *)buk->ptr;
 }
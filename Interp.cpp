@@ -2,8 +2,24 @@
 #include "CodeNode.h"
 
 #include "Resolver.h"
+#include "HeapAllocator.h"
 
 #include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if PLATFORM_LINUX
+#include <ucontext.h>
+#include <sys/mman.h>
+#endif
 
 struct Evaluation_Value
 {
@@ -43,17 +59,52 @@ template <typename T> T *evaluation_value_pointer(Evaluation_Value &val)
 }
 #define EvaluationTypePointer(val, type) evaluation_value_pointer<type>(val)
 
-static inline uint64_t interp_push_into_stack(Interpreter *interp, Evaluation_Value var, uint64_t offset)
+// Reading the clock for every tick is too costly, the deadline is checked every few ticks
+constexpr uint64_t INTERP_DEADLINE_CHECK_TICKS = 4096;
+
+// Ticks a spawned task runs before it gives its thread to the other tasks
+constexpr uint64_t INTERP_TASK_QUANTUM = 1024;
+
+static void interp_task_yield(Interpreter *interp);
+
+static uint64_t interp_clock_ms()
 {
-	memmove(interp->stack + interp->stack_top + offset, EvaluationTypePointer(var, void *), var.type->runtime_size);
-	offset += var.type->runtime_size;
-	return offset;
+	using namespace std::chrono;
+	return (uint64_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static void interp_start_budget(Interpreter *interp)
+{
+	if (interp->budget.milliseconds && !interp->deadline)
+		interp->deadline = interp_clock_ms() + interp->budget.milliseconds;
+}
+
+// Counts a tick and halts the execution when the budget is exhausted
+static inline bool interp_budget_exhausted(Interpreter *interp)
+{
+	interp->ticks += 1;
+
+	bool exhausted = interp->ticks > interp->budget.ticks;
+	if (!exhausted && interp->deadline && (interp->ticks % INTERP_DEADLINE_CHECK_TICKS) == 0)
+		exhausted = interp_clock_ms() >= interp->deadline;
+
+	if (exhausted)
+	{
+		interp->budget_exceeded = true;
+		interp->halt = true;
+	}
+	else if (interp->task && (interp->ticks % INTERP_TASK_QUANTUM) == 0)
+	{
+		interp_task_yield(interp);
+	}
+
+	return exhausted;
 }
 
-static inline uint64_t interp_push_into_stack_reduced(Interpreter *interp, Evaluation_Value var, uint64_t offset)
+static inline uint64_t interp_push_into_stack(Interpreter *interp, Evaluation_Value var, uint64_t offset)
 {
-	offset -= var.type->runtime_size;
 	memmove(interp->stack + interp->stack_top + offset, EvaluationTypePointer(var, void *), var.type->runtime_size);
+	offset += var.type->runtime_size;
 	return offset;
 }
 
@@ -61,16 +112,18 @@ static inline uint64_t interp_push_into_stack_reduced(Interpreter *interp, Evalu
 //
 //
 
+template <bool Traced>
 static Evaluation_Value interp_eval_root_expression(Interpreter *interp, Code_Node_Expression *expression);
 
+template <bool Traced>
 static Evaluation_Value interp_eval_address(Interpreter *interp, Code_Node_Address *node)
 {
 	if (node->subscript)
 	{
 		Assert(node->address == nullptr);
 
-		auto expression = interp_eval_root_expression(interp, node->subscript->expression);
-		auto subscript = interp_eval_root_expression(interp, node->subscript->subscript);
+		auto expression = interp_eval_root_expression<Traced>(interp, node->subscript->expression);
+		auto subscript = interp_eval_root_expression<Traced>(interp, node->subscript->subscript);
 
 		Assert(subscript.type->kind == CODE_TYPE_INTEGER || subscript.type->kind == CODE_TYPE_CHARACTER);
 
@@ -80,11 +133,15 @@ static Evaluation_Value interp_eval_address(Interpreter *interp, Code_Node_Addre
 		if (expr_type == CODE_TYPE_STATIC_ARRAY)
 		{
 			address = EvaluationTypePointer(expression, uint8_t);
+			if (node->subscript->soa)
+				address += ((Code_Type_Static_Array *)expression.type)->element_count * node->subscript->soa_offset;
 		}
 		else if (expr_type == CODE_TYPE_ARRAY_VIEW)
 		{
 			auto arr = EvaluationTypeValue(expression, Array_View<uint8_t>);
 			address = arr.data;
+			if (node->subscript->soa)
+				address += arr.count * node->subscript->soa_offset;
 		}
 		else
 		{
@@ -118,6 +175,8 @@ static Evaluation_Value interp_eval_address(Interpreter *interp, Code_Node_Addre
 			if (address_kind == Symbol_Address::STACK)
 			{
 				offset += interp->stack_top;
+				if (offset < interp->stack_private)
+					memory = interp->shared_stack;
 			}
 			else if (address_kind == Symbol_Address::GLOBAL)
 			{
@@ -143,6 +202,8 @@ static Evaluation_Value interp_eval_address(Interpreter *interp, Code_Node_Addre
 		else
 		{
 			offset += interp->stack_top;
+			if (offset < interp->stack_private)
+				memory = interp->shared_stack;
 		}
 
 		Evaluation_Value type_value;
@@ -152,19 +213,61 @@ static Evaluation_Value interp_eval_address(Interpreter *interp, Code_Node_Addre
 	}
 }
 
+template <bool Traced>
 static Evaluation_Value interp_eval_root_expression(Interpreter *interp, Code_Node_Expression *root);
 
+template <bool Traced>
 static Evaluation_Value interp_eval_offset(Interpreter *interp, Code_Node_Offset *root)
 {
-	auto dest = interp_eval_root_expression(interp, root->expression);
+	auto dest = interp_eval_root_expression<Traced>(interp, root->expression);
 	dest.from_address += root->offset;
 	dest.type = root->type;
 	return dest;
 }
 
+// The sized types are stored in their own width, they are widened to int and float when read
+
+static void interp_sized_integer_store(Code_Type *type, void *data, Kano_Int value)
+{
+	switch (type->runtime_size)
+	{
+		case 1: *(uint8_t *)data = (uint8_t)value; break;
+		case 2: *(uint16_t *)data = (uint16_t)value; break;
+		case 4: *(uint32_t *)data = (uint32_t)value; break;
+		NoDefaultCase();
+	}
+}
+
+static Kano_Int interp_value_to_int(Evaluation_Value &value)
+{
+	switch (value.type->kind)
+	{
+		case CODE_TYPE_BOOL: return EvaluationTypeValue(value, Kano_Bool);
+		case CODE_TYPE_CHARACTER: return EvaluationTypeValue(value, Kano_Char);
+		case CODE_TYPE_INTEGER: return EvaluationTypeValue(value, Kano_Int);
+		case CODE_TYPE_REAL: return (Kano_Int)EvaluationTypeValue(value, Kano_Real);
+		case CODE_TYPE_SIZED_INTEGER: return code_type_sized_integer_value(value.type->runtime_size, ((Code_Type_Sized_Integer *)value.type)->is_signed, EvaluationTypePointer(value, void));
+		case CODE_TYPE_SIZED_REAL: return (Kano_Int)EvaluationTypeValue(value, float);
+		NoDefaultCase();
+	}
+	return 0;
+}
+
+static Kano_Real interp_value_to_real(Evaluation_Value &value)
+{
+	switch (value.type->kind)
+	{
+		case CODE_TYPE_REAL: return EvaluationTypeValue(value, Kano_Real);
+		case CODE_TYPE_SIZED_REAL: return EvaluationTypeValue(value, float);
+		default: break;
+	}
+	return (Kano_Real)interp_value_to_int(value);
+}
+
+template <bool Traced>
 static Evaluation_Value interp_eval_type_cast(Interpreter *interp, Code_Node_Type_Cast *cast)
 {
-	auto value = interp_eval_root_expression(interp, cast->child);
+	auto value = interp_eval_root_expression<Traced>(interp, cast->child);
 
 	Evaluation_Value type_value;
 	type_value.type = cast->type;
@@ -172,6 +275,11 @@ static Evaluation_Value interp_eval_type_cast(Interpreter *interp, Code_Node_Typ
 	switch (cast->type->kind)
 	{
 		case CODE_TYPE_REAL: {
+			if (value.type->kind == CODE_TYPE_SIZED_INTEGER || value.type->kind == CODE_TYPE_SIZED_REAL)
+			{
+				type_value.imm.real_value = interp_value_to_real(value);
+				break;
+			}
 			Assert(value.type->kind == CODE_TYPE_INTEGER || value.type->kind == CODE_TYPE_CHARACTER);
 			type_value.imm.real_value = (Kano_Real)EvaluationTypeValue(value, Kano_Int);
 		}
@@ -190,6 +298,10 @@ static Evaluation_Value interp_eval_type_cast(Interpreter *interp, Code_Node_Typ
 			{
 				type_value.imm.int_value = (Kano_Int)EvaluationTypeValue(value, Kano_Char);
 			}
+			else if (value.type->kind == CODE_TYPE_SIZED_INTEGER || value.type->kind == CODE_TYPE_SIZED_REAL)
+			{
+				type_value.imm.int_value = interp_value_to_int(value);
+			}
 			else
 			{
 				Unreachable();
@@ -210,12 +322,30 @@ static Evaluation_Value interp_eval_type_cast(Interpreter *interp, Code_Node_Typ
 			{
 				type_value.imm.bool_value = EvaluationTypeValue(value, Kano_Char) != 0;
 			}
+			else if (value.type->kind == CODE_TYPE_SIZED_INTEGER)
+			{
+				type_value.imm.bool_value = interp_value_to_int(value) != 0;
+			}
+			else if (value.type->kind == CODE_TYPE_SIZED_REAL)
+			{
+				type_value.imm.bool_value = EvaluationTypeValue(value, float) != 0.0f;
+			}
 			else
 			{
 				Unreachable();
 			}
 		}
 		break;
+
+		case CODE_TYPE_SIZED_INTEGER: {
+			interp_sized_integer_store(cast->type, &type_value.imm, interp_value_to_int(value));
+		}
+		break;
+
+		case CODE_TYPE_SIZED_REAL: {
+			*(float *)&type_value.imm = (float)interp_value_to_real(value);
+		}
+		break;
 		
 		case CODE_TYPE_POINTER: {
 			Assert(value.type->kind == CODE_TYPE_POINTER);
@@ -237,13 +367,15 @@ static Evaluation_Value interp_eval_type_cast(Interpreter *interp, Code_Node_Typ
 	return type_value;
 }
 
+template <bool Traced>
 static Evaluation_Value interp_eval_expression(Interpreter *interp, Code_Node *root);
 
+template <bool Traced>
 static Evaluation_Value interp_eval_return(Interpreter *interp, Code_Node_Return *node)
 {
 	if (node->expression)
 	{
-		auto result = interp_eval_expression(interp, node->expression);
+		auto result = interp_eval_expression<Traced>(interp, node->expression);
 		interp_push_into_stack(interp, result, 0);
 		interp->return_count += 1;
 		return result;
@@ -270,14 +402,16 @@ static Evaluation_Value interp_eval_literal(Interpreter *interp, Code_Node_Liter
 	return type_value;
 }
 
+template <bool Traced>
 static Evaluation_Value interp_eval_expression(Interpreter *interp, Code_Node *root);
 
+template <bool Traced>
 static Evaluation_Value interp_eval_unary_operator(Interpreter *interp, Code_Node_Unary_Operator *root)
 {
 	switch (root->op_kind)
 	{
 		case UNARY_OPERATOR_LOGICAL_NOT: {
-			auto type_value = interp_eval_expression(interp, root->child);
+			auto type_value = interp_eval_expression<Traced>(interp, root->child);
 			auto ref        = EvaluationTypePointer(type_value, bool);
 			*ref            = !*ref;
 			return type_value;
@@ -285,7 +419,7 @@ static Evaluation_Value interp_eval_unary_operator(Interpreter *interp, Code_Nod
 		break;
 		
 		case UNARY_OPERATOR_BITWISE_NOT: {
-			auto type_value = interp_eval_expression(interp, root->child);
+			auto type_value = interp_eval_expression<Traced>(interp, root->child);
 			auto ref        = EvaluationTypePointer(type_value, int64_t);
 			*ref            = ~*ref;
 			return type_value;
@@ -293,13 +427,13 @@ static Evaluation_Value interp_eval_unary_operator(Interpreter *interp, Code_Nod
 		break;
 		
 		case UNARY_OPERATOR_PLUS: {
-			auto type_value = interp_eval_expression(interp, root->child);
+			auto type_value = interp_eval_expression<Traced>(interp, root->child);
 			return type_value;
 		}
 		break;
 		
 		case UNARY_OPERATOR_MINUS: {
-			auto value = interp_eval_expression(interp, root->child);
+			auto value = interp_eval_expression<Traced>(interp, root->child);
 			
 			if (value.type->kind == CODE_TYPE_INTEGER)
 			{
@@ -322,7 +456,7 @@ static Evaluation_Value interp_eval_unary_operator(Interpreter *interp, Code_Nod
 		break;
 		
 		case UNARY_OPERATOR_DEREFERENCE:  {
-			Evaluation_Value pointer = interp_eval_expression(interp, root->child);
+			Evaluation_Value pointer = interp_eval_expression<Traced>(interp, root->child);
 
 			Evaluation_Value type_value;
 			type_value.type    = root->type;
@@ -333,11 +467,8 @@ static Evaluation_Value interp_eval_unary_operator(Interpreter *interp, Code_Nod
 		break;
 
 		case UNARY_OPERATOR_POINTER_TO: {
-			Assert(root->child->kind == CODE_NODE_ADDRESS);
-			
-			auto address = (Code_Node_Address *)root->child;
-
-			auto pointer = interp_eval_address(interp, address);
+			// The l-values are always read from their address
+			auto pointer = interp_eval_expression<Traced>(interp, root->child);
 			Assert(pointer.from_address);
 			
 			Evaluation_Value type_value;
@@ -392,6 +523,9 @@ static Evaluation_Value binary_add(Evaluation_Value a, Evaluation_Value b, Code_
 			return r;
 		}
 		break;
+
+		// The resolver promotes the sized types before the operators
+		case CODE_TYPE_SIZED_INTEGER: case CODE_TYPE_SIZED_REAL: break;
 	}
 	
 	Unreachable();
@@ -430,6 +564,8 @@ static Evaluation_Value binary_sub(Evaluation_Value a, Evaluation_Value b, Code_
 			return r;
 		}
 		break;
+
+		case CODE_TYPE_SIZED_INTEGER: case CODE_TYPE_SIZED_REAL: break;
 	}
 	
 	Unreachable();
@@ -463,6 +599,8 @@ static Evaluation_Value binary_mul(Evaluation_Value a, Evaluation_Value b, Code_
 			return r;
 		}
 		break;
+
+		case CODE_TYPE_SIZED_INTEGER: case CODE_TYPE_SIZED_REAL: break;
 	}
 	
 	Unreachable();
@@ -496,6 +634,8 @@ static Evaluation_Value binary_div(Evaluation_Value a, Evaluation_Value b, Code_
 			return r;
 		}
 		break;
+
+		case CODE_TYPE_SIZED_INTEGER: case CODE_TYPE_SIZED_REAL: break;
 	}
 	
 	Unreachable();
@@ -613,6 +753,8 @@ static Evaluation_Value binary_gt(Evaluation_Value a, Evaluation_Value b, Code_T
 			return r;
 		}
 		break;
+
+		case CODE_TYPE_SIZED_INTEGER: case CODE_TYPE_SIZED_REAL: break;
 	}
 	
 	Unreachable();
@@ -646,6 +788,8 @@ static Evaluation_Value binary_lt(Evaluation_Value a, Evaluation_Value b, Code_T
 			return r;
 		}
 		break;
+
+		case CODE_TYPE_SIZED_INTEGER: case CODE_TYPE_SIZED_REAL: break;
 	}
 	
 	Unreachable();
@@ -679,6 +823,8 @@ static Evaluation_Value binary_ge(Evaluation_Value a, Evaluation_Value b, Code_T
 			return r;
 		}
 		break;
+
+		case CODE_TYPE_SIZED_INTEGER: case CODE_TYPE_SIZED_REAL: break;
 	}
 	
 	Unreachable();
@@ -712,6 +858,8 @@ static Evaluation_Value binary_le(Evaluation_Value a, Evaluation_Value b, Code_T
 			return r;
 		}
 		break;
+
+		case CODE_TYPE_SIZED_INTEGER: case CODE_TYPE_SIZED_REAL: break;
 	}
 	
 	Unreachable();
@@ -758,6 +906,8 @@ static Evaluation_Value binary_cmp(Evaluation_Value a, Evaluation_Value b, Code_
 			return r;
 		}
 		break;
+
+		case CODE_TYPE_SIZED_INTEGER: case CODE_TYPE_SIZED_REAL: break;
 	}
 	
 	Unreachable();
@@ -804,6 +954,8 @@ static Evaluation_Value binary_ncmp(Evaluation_Value a, Evaluation_Value b, Code
 			return r;
 		}
 		break;
+
+		case CODE_TYPE_SIZED_INTEGER: case CODE_TYPE_SIZED_REAL: break;
 	}
 	
 	Unreachable();
@@ -847,6 +999,8 @@ static Evaluation_Value binary_cadd(Evaluation_Value a, Evaluation_Value b, Code
 			return a;
 		}
 		break;
+
+		case CODE_TYPE_SIZED_INTEGER: case CODE_TYPE_SIZED_REAL: break;
 	}
 	
 	Unreachable();
@@ -889,6 +1043,8 @@ static Evaluation_Value binary_csub(Evaluation_Value a, Evaluation_Value b, Code
 			return a;
 		}
 		break;
+
+		case CODE_TYPE_SIZED_INTEGER: case CODE_TYPE_SIZED_REAL: break;
 	}
 	
 	Unreachable();
@@ -924,6 +1080,8 @@ static Evaluation_Value binary_cmul(Evaluation_Value a, Evaluation_Value b, Code
 			return a;
 		}
 		break;
+
+		case CODE_TYPE_SIZED_INTEGER: case CODE_TYPE_SIZED_REAL: break;
 	}
 	
 	Unreachable();
@@ -959,6 +1117,8 @@ static Evaluation_Value binary_cdiv(Evaluation_Value a, Evaluation_Value b, Code
 			return a;
 		}
 		break;
+
+		case CODE_TYPE_SIZED_INTEGER: case CODE_TYPE_SIZED_REAL: break;
 	}
 	
 	Unreachable();
@@ -1106,12 +1266,15 @@ static BinaryOperatorProc BinaryOperators[] = {
 	binary_cmul, binary_cdiv, binary_cmod, binary_crs, binary_cls, binary_cadd, binary_cxor, binary_cor,
 	binary_land, binary_lor };
 
+template <bool Traced>
 static Evaluation_Value interp_eval_expression(Interpreter *interp, Code_Node *root);
+template <bool Traced>
 static Evaluation_Value interp_eval_root_expression(Interpreter *interp, Code_Node_Expression *root);
 
+template <bool Traced>
 static Evaluation_Value interp_eval_binary_operator(Interpreter *interp, Code_Node_Binary_Operator *node)
 {
-	auto b = interp_eval_expression(interp, node->right);
+	auto b = interp_eval_expression<Traced>(interp, node->right);
 
 	// Copy to imm value, so that it doesn't change changed if procedures are being called when solving for a
 	if (b.from_address)
@@ -1120,171 +1283,656 @@ static Evaluation_Value interp_eval_binary_operator(Interpreter *interp, Code_No
 		b.from_address = nullptr;
 	}
 
-	auto a = interp_eval_expression(interp, node->left);
+	auto a = interp_eval_expression<Traced>(interp, node->left);
 
 	Assert(node->op_kind < ArrayCount(BinaryOperators));
+
+	// Only the compound operators work on the sized types, the operation is done on the widened
+	// values and the result is narrowed back into the destination
+	if (node->type->kind == CODE_TYPE_SIZED_INTEGER || node->type->kind == CODE_TYPE_SIZED_REAL)
+	{
+		static Code_Type_Integer IntType;
+		static Code_Type_Real    RealType;
+
+		Evaluation_Value x, y;
+		if (node->type->kind == CODE_TYPE_SIZED_INTEGER)
+		{
+			x.type          = &IntType;
+			x.imm.int_value = interp_value_to_int(a);
+			y.type          = &IntType;
+			y.imm.int_value = interp_value_to_int(b);
+
+			auto r = BinaryOperators[node->op_kind](x, y, &IntType);
+			interp_sized_integer_store(node->type, EvaluationTypePointer(a, void), r.imm.int_value);
+		}
+		else
+		{
+			x.type           = &RealType;
+			x.imm.real_value = interp_value_to_real(a);
+			y.type           = &RealType;
+			y.imm.real_value = interp_value_to_real(b);
+
+			auto r = BinaryOperators[node->op_kind](x, y, &RealType);
+			*EvaluationTypePointer(a, float) = (float)r.imm.real_value;
+		}
+
+		a.type = node->type;
+		return a;
+	}
 	
 	return BinaryOperators[node->op_kind](a, b, node->type);
 }
 
-static Evaluation_Value interp_eval_assignment(Interpreter *interp, Code_Node_Assignment *node)
+//
+// Element wise array arithmetic, long arrays are split in blocks that are run on the threads of the parallel for
+//
+
+constexpr int64_t INTERP_ARRAY_BLOCK_SIZE   = 16 * 1024;
+constexpr int64_t INTERP_ARRAY_PARALLEL_MIN = 128 * 1024;
+
+template <typename T>
+struct Interp_Array_Kernel
 {
-	auto value = interp_eval_root_expression(interp, (Code_Node_Expression *)node->value);
-	
-	auto dst = interp_eval_root_expression(interp, node->destination);
-	
-	if (dst.from_address)
+	Binary_Operator_Kind op;
+	const T *            x;
+	const T *            y;
+	T *                  out;
+	bool                 x_scalar;
+	bool                 y_scalar;
+	int64_t              count;
+};
+
+template <typename T>
+static inline T interp_array_apply(Binary_Operator_Kind op, T a, T b)
+{
+	switch (op)
 	{
-		uint64_t *source = (uint64_t *)EvaluationTypePointer(value, void *);
-		memcpy(dst.from_address, source, value.type->runtime_size);
+		case BINARY_OPERATOR_ADDITION: return a + b;
+		case BINARY_OPERATOR_SUBTRACTION: return a - b;
+		case BINARY_OPERATOR_MULTIPLICATION: return a * b;
+		case BINARY_OPERATOR_DIVISION: return a / b;
+		NoDefaultCase();
 	}
-	else if (dst.type->kind == CODE_TYPE_POINTER)
+	return a;
+}
+
+// Scalar version, the SIMD overloads below are picked for the operations they support
+template <typename T>
+static int64_t interp_array_simd(Binary_Operator_Kind op, const T *x, bool x_scalar, const T *y, bool y_scalar, T *out, int64_t count)
+{
+	return 0;
+}
+
+#if defined(__SSE2__)
+
+template <typename Apply>
+static inline int64_t interp_array_simd_pd(const Kano_Real *x, bool x_scalar, const Kano_Real *y, bool y_scalar, Kano_Real *out, int64_t count, Apply apply)
+{
+	auto xs = _mm_set1_pd(x[0]);
+	auto ys = _mm_set1_pd(y[0]);
+
+	int64_t index = 0;
+	for (; index + 2 <= count; index += 2)
 	{
-		memcpy(dst.imm.pointer_value, EvaluationTypePointer(value, void *), value.type->runtime_size);
+		auto a = x_scalar ? xs : _mm_loadu_pd(x + index);
+		auto b = y_scalar ? ys : _mm_loadu_pd(y + index);
+		_mm_storeu_pd(out + index, apply(a, b));
 	}
-	else
+	return index;
+}
+
+static int64_t interp_array_simd(Binary_Operator_Kind op, const Kano_Real *x, bool x_scalar, const Kano_Real *y, bool y_scalar, Kano_Real *out, int64_t count)
+{
+	switch (op)
 	{
-		Unreachable();
+		case BINARY_OPERATOR_ADDITION: return interp_array_simd_pd(x, x_scalar, y, y_scalar, out, count, [](__m128d a, __m128d b) { return _mm_add_pd(a, b); });
+		case BINARY_OPERATOR_SUBTRACTION: return interp_array_simd_pd(x, x_scalar, y, y_scalar, out, count, [](__m128d a, __m128d b) { return _mm_sub_pd(a, b); });
+		case BINARY_OPERATOR_MULTIPLICATION: return interp_array_simd_pd(x, x_scalar, y, y_scalar, out, count, [](__m128d a, __m128d b) { return _mm_mul_pd(a, b); });
+		case BINARY_OPERATOR_DIVISION: return interp_array_simd_pd(x, x_scalar, y, y_scalar, out, count, [](__m128d a, __m128d b) { return _mm_div_pd(a, b); });
+		NoDefaultCase();
 	}
-	
-	return value;
+	return 0;
 }
 
-static void interp_eval_block(Interpreter *interp, Code_Node_Block *root, bool isproc);
+template <typename Apply>
+static inline int64_t interp_array_simd_ps(const float *x, bool x_scalar, const float *y, bool y_scalar, float *out, int64_t count, Apply apply)
+{
+	auto xs = _mm_set1_ps(x[0]);
+	auto ys = _mm_set1_ps(y[0]);
 
-static inline void interp_push_aligned_parameter(Interpreter *interp, Code_Node_Procedure_Call *root, uint64_t prev_top, uint64_t new_top, uint64_t offset)
+	int64_t index = 0;
+	for (; index + 4 <= count; index += 4)
+	{
+		auto a = x_scalar ? xs : _mm_loadu_ps(x + index);
+		auto b = y_scalar ? ys : _mm_loadu_ps(y + index);
+		_mm_storeu_ps(out + index, apply(a, b));
+	}
+	return index;
+}
+
+static int64_t interp_array_simd(Binary_Operator_Kind op, const float *x, bool x_scalar, const float *y, bool y_scalar, float *out, int64_t count)
 {
-	for (int64_t index = 0; index < root->parameter_count; ++index)
+	switch (op)
 	{
-		auto param = root->parameters[index];
-		offset = AlignPower2Up(offset, (uint64_t)param->type->alignment);
-		interp->stack_top = prev_top;
-		auto var = interp_eval_root_expression(interp, param);
-		interp->stack_top = new_top;
-		offset = interp_push_into_stack(interp, var, offset);
+		case BINARY_OPERATOR_ADDITION: return interp_array_simd_ps(x, x_scalar, y, y_scalar, out, count, [](__m128 a, __m128 b) { return _mm_add_ps(a, b); });
+		case BINARY_OPERATOR_SUBTRACTION: return interp_array_simd_ps(x, x_scalar, y, y_scalar, out, count, [](__m128 a, __m128 b) { return _mm_sub_ps(a, b); });
+		case BINARY_OPERATOR_MULTIPLICATION: return interp_array_simd_ps(x, x_scalar, y, y_scalar, out, count, [](__m128 a, __m128 b) { return _mm_mul_ps(a, b); });
+		case BINARY_OPERATOR_DIVISION: return interp_array_simd_ps(x, x_scalar, y, y_scalar, out, count, [](__m128 a, __m128 b) { return _mm_div_ps(a, b); });
+		NoDefaultCase();
 	}
+	return 0;
 }
 
-static Evaluation_Value interp_make_type_value(Interpreter *interp, Code_Type *type) {
-	Evaluation_Value value;
-	value.imm.pointer_value = (uint8_t *)type;
-	value.type = code_type_resolver_find_type(interp->resolver, "*void");
-	return value;
+// Addition and subtraction wrap around the same for the signed and the unsigned 32 bit integers
+template <typename T>
+static inline int64_t interp_array_simd_epi32(Binary_Operator_Kind op, const T *x, bool x_scalar, const T *y, bool y_scalar, T *out, int64_t count)
+{
+	if (op != BINARY_OPERATOR_ADDITION && op != BINARY_OPERATOR_SUBTRACTION)
+		return 0;
+
+	auto xs = _mm_set1_epi32((int)x[0]);
+	auto ys = _mm_set1_epi32((int)y[0]);
+
+	int64_t index = 0;
+	for (; index + 4 <= count; index += 4)
+	{
+		auto a = x_scalar ? xs : _mm_loadu_si128((const __m128i *)(x + index));
+		auto b = y_scalar ? ys : _mm_loadu_si128((const __m128i *)(y + index));
+		auto r = (op == BINARY_OPERATOR_ADDITION) ? _mm_add_epi32(a, b) : _mm_sub_epi32(a, b);
+		_mm_storeu_si128((__m128i *)(out + index), r);
+	}
+	return index;
 }
 
-static Evaluation_Value interp_eval_procedure_call(Interpreter *interp, Code_Node_Procedure_Call *root)
+static int64_t interp_array_simd(Binary_Operator_Kind op, const int32_t *x, bool x_scalar, const int32_t *y, bool y_scalar, int32_t *out, int64_t count)
 {
-	auto prev_top = interp->stack_top;
+	return interp_array_simd_epi32(op, x, x_scalar, y, y_scalar, out, count);
+}
 
-	auto new_top = root->stack_top + prev_top;
+static int64_t interp_array_simd(Binary_Operator_Kind op, const uint32_t *x, bool x_scalar, const uint32_t *y, bool y_scalar, uint32_t *out, int64_t count)
+{
+	return interp_array_simd_epi32(op, x, x_scalar, y, y_scalar, out, count);
+}
 
-	// @Note: We do not align variadics to simplify the variadics routine
+// SSE2 only has the 64 bit addition and subtraction, the rest is left to the scalar loop
+static int64_t interp_array_simd(Binary_Operator_Kind op, const Kano_Int *x, bool x_scalar, const Kano_Int *y, bool y_scalar, Kano_Int *out, int64_t count)
+{
+	if (op != BINARY_OPERATOR_ADDITION && op != BINARY_OPERATOR_SUBTRACTION)
+		return 0;
 
-	uint64_t variadics_args_size = 0;
-	for (int64_t i = 0; i < root->variadic_count; ++i)
+	auto xs = _mm_set1_epi64x(x[0]);
+	auto ys = _mm_set1_epi64x(y[0]);
+
+	int64_t index = 0;
+	for (; index + 2 <= count; index += 2)
 	{
-		variadics_args_size += root->variadics[i]->type->runtime_size;
-		variadics_args_size += sizeof(Code_Type *);
+		auto a = x_scalar ? xs : _mm_loadu_si128((const __m128i *)(x + index));
+		auto b = y_scalar ? ys : _mm_loadu_si128((const __m128i *)(y + index));
+		auto r = (op == BINARY_OPERATOR_ADDITION) ? _mm_add_epi64(a, b) : _mm_sub_epi64(a, b);
+		_mm_storeu_si128((__m128i *)(out + index), r);
 	}
+	return index;
+}
+
+#endif
 
+template <typename T>
+static void interp_array_run(void *data, int64_t first, int64_t last)
+{
+	auto kernel = (Interp_Array_Kernel<T> *)data;
+	for (auto block = first; block < last; ++block)
 	{
-		// @Note: Variadics are evaluated in reverse order because we add Code_Type * as well
-		// If this were done in forward order, the result placed by a function call in the top
-		// of the stack will be erased when we push Code_Type * into the stack
-		uint64_t offset = variadics_args_size;
-		for (int64_t i = root->variadic_count - 1; i >= 0; --i)
-		{
-			interp->stack_top = prev_top;
-			auto param = root->variadics[i];
-			auto var = interp_eval_root_expression(interp, param);
-			interp->stack_top = new_top;
-			offset = interp_push_into_stack_reduced(interp, var, offset);
-			offset = interp_push_into_stack_reduced(interp, interp_make_type_value(interp, param->type), offset);
-		}
+		auto begin = block * INTERP_ARRAY_BLOCK_SIZE;
+		auto count = Minimum(INTERP_ARRAY_BLOCK_SIZE, kernel->count - begin);
+		auto x     = kernel->x_scalar ? kernel->x : kernel->x + begin;
+		auto y     = kernel->y_scalar ? kernel->y : kernel->y + begin;
+		auto out   = kernel->out + begin;
+
+		auto index = interp_array_simd(kernel->op, x, kernel->x_scalar, y, kernel->y_scalar, out, count);
+		for (; index < count; ++index)
+			out[index] = interp_array_apply(kernel->op, x[kernel->x_scalar ? 0 : index], y[kernel->y_scalar ? 0 : index]);
 	}
-	
-	new_top += variadics_args_size;
+}
 
-	uint64_t return_type_size = 0;
-	if (root->type)
+template <typename T>
+static void interp_array_execute(Interpreter *interp, Interp_Array_Kernel<T> *kernel)
+{
+	auto block_count = (kernel->count + INTERP_ARRAY_BLOCK_SIZE - 1) / INTERP_ARRAY_BLOCK_SIZE;
+	if (kernel->count >= INTERP_ARRAY_PARALLEL_MIN)
+		interp_parallel_range(interp, block_count, interp_array_run<T>, kernel);
+	else
+		interp_array_run<T>(kernel, 0, block_count);
+}
+
+// The element count of the array operands, the data of the scalar operands is the value itself
+static uint8_t *interp_array_operand(Evaluation_Value &value, Code_Type *element_type, int64_t *count)
+{
+	switch (value.type->kind)
 	{
-		new_top = AlignPower2Up(new_top, (uint64_t)root->type->alignment);
-		return_type_size = root->type->runtime_size;
+		case CODE_TYPE_STATIC_ARRAY: {
+			*count = value.type->runtime_size / element_type->runtime_size;
+			return EvaluationTypePointer(value, uint8_t);
+		}
+
+		case CODE_TYPE_ARRAY_VIEW: {
+			auto view   = EvaluationTypeValue(value, Array_View<uint8_t>);
+			auto width  = ((Code_Type_Array_View *)value.type)->element_type->runtime_size / element_type->runtime_size;
+			*count      = view.count * width;
+			return view.data;
+		}
+
+		default: break;
 	}
-	else if (root->parameter_count)
+
+	// Copied, so that the value does not change while the other operand is computed
+	if (value.from_address)
 	{
-		new_top = AlignPower2Up(new_top, (uint64_t)root->parameters[0]->type->alignment);
+		memcpy(&value.imm, value.from_address, value.type->runtime_size);
+		value.from_address = nullptr;
 	}
 
-	interp_push_aligned_parameter(interp, root, prev_top, new_top, return_type_size);
+	*count = -1;
+	return (uint8_t *)&value.imm;
+}
 
-	interp->stack_top = prev_top;
-	auto proc_expr = interp_eval_root_expression(interp, root->procedure);
-	auto procedure = EvaluationTypeValue(proc_expr, Code_Value_Procedure);
-	
-	auto prev_proc = interp->current_procedure;
-	interp->stack_top = new_top;
-	interp->current_procedure = root->procedure_type;
+template <bool Traced>
+static Evaluation_Value interp_eval_array_operator(Interpreter *interp, Code_Node_Array_Operator *node)
+{
+	// The left is computed first, the resolver placed the array results of the right above it
+	auto a = interp_eval_expression<Traced>(interp, node->left);
 
-	if (procedure.block)
-		interp_eval_block(interp, procedure.block, true);
-	else
-		procedure.ccall(interp);
+	int64_t a_count = 0;
+	auto    x       = interp_array_operand(a, node->element_type, &a_count);
+
+	auto b = interp_eval_expression<Traced>(interp, node->right);
+
+	int64_t b_count = 0;
+	auto    y       = interp_array_operand(b, node->element_type, &b_count);
 
 	Evaluation_Value result;
-	if (root->type)
+	result.type = node->type;
+
+	auto op       = node->op_kind;
+	bool compound = op >= BINARY_OPERATOR_COMPOUND_ADDITION;
+
+	uint8_t *out       = nullptr;
+	int64_t  out_count = 0;
+
+	if (compound)
 	{
-		result.from_address = (uint8_t *)(interp->stack + interp->stack_top);
-		result.type    = root->type;
+		op        = (Binary_Operator_Kind)(op - BINARY_OPERATOR_COMPOUND_ADDITION + BINARY_OPERATOR_ADDITION);
+		result    = a;
+		out       = x;
+		out_count = a_count;
 	}
 	else
 	{
-		result.from_address = nullptr;
-		result.type    = nullptr;
+		result.from_address = interp->stack + interp->stack_top + node->stack_top;
+		out                 = result.from_address;
+		out_count           = node->type->runtime_size / node->element_type->runtime_size;
 	}
 
-	interp->current_procedure = prev_proc;
-	interp->stack_top = prev_top;
-	
-	return result;
-}
+	// Only the elements that both operands have are computed, the rest of the result is cleared
+	auto count = out_count;
+	if (a_count >= 0)
+		count = Minimum(count, a_count);
+	if (b_count >= 0)
+		count = Minimum(count, b_count);
 
-static Evaluation_Value interp_eval_expression(Interpreter *interp, Code_Node *root)
-{
-	switch (root->kind)
+	switch (node->element_type->kind)
 	{
-		case CODE_NODE_LITERAL: return interp_eval_literal(interp, (Code_Node_Literal *)root);
-		case CODE_NODE_UNARY_OPERATOR: return interp_eval_unary_operator(interp, (Code_Node_Unary_Operator *)root);
-		case CODE_NODE_BINARY_OPERATOR: return interp_eval_binary_operator(interp, (Code_Node_Binary_Operator *)root);
-		case CODE_NODE_ADDRESS: return interp_eval_address(interp, (Code_Node_Address *)root);
-		case CODE_NODE_OFFSET: return interp_eval_offset(interp, (Code_Node_Offset *)root);
-		case CODE_NODE_ASSIGNMENT: return interp_eval_assignment(interp, (Code_Node_Assignment *)root);
-		case CODE_NODE_TYPE_CAST: return interp_eval_type_cast(interp, (Code_Node_Type_Cast *)root);
-		case CODE_NODE_IF: return interp_eval_expression(interp, (Code_Node *)root);
-		case CODE_NODE_PROCEDURE_CALL: return interp_eval_procedure_call(interp, (Code_Node_Procedure_Call *)root);
-		case CODE_NODE_RETURN: return interp_eval_return(interp, (Code_Node_Return *)root);
-		case CODE_NODE_BREAK: interp_eval_break(interp, (Code_Node_Break *)root); return Evaluation_Value{};
-		case CODE_NODE_CONTINUE: interp_eval_continue(interp, (Code_Node_Continue *)root); return Evaluation_Value{};
-		
+		case CODE_TYPE_REAL: {
+			Interp_Array_Kernel<Kano_Real> kernel = { op, (Kano_Real *)x, (Kano_Real *)y, (Kano_Real *)out, a_count < 0, b_count < 0, count };
+			interp_array_execute(interp, &kernel);
+		}
+		break;
+
+		case CODE_TYPE_INTEGER: {
+			Interp_Array_Kernel<Kano_Int> kernel = { op, (Kano_Int *)x, (Kano_Int *)y, (Kano_Int *)out, a_count < 0, b_count < 0, count };
+			interp_array_execute(interp, &kernel);
+		}
+		break;
+
+		case CODE_TYPE_SIZED_REAL: {
+			Interp_Array_Kernel<float> kernel = { op, (float *)x, (float *)y, (float *)out, a_count < 0, b_count < 0, count };
+			interp_array_execute(interp, &kernel);
+		}
+		break;
+
+		case CODE_TYPE_SIZED_INTEGER: {
+			Assert(node->element_type->runtime_size == sizeof(int32_t));
+			if (((Code_Type_Sized_Integer *)node->element_type)->is_signed)
+			{
+				Interp_Array_Kernel<int32_t> kernel = { op, (int32_t *)x, (int32_t *)y, (int32_t *)out, a_count < 0, b_count < 0, count };
+				interp_array_execute(interp, &kernel);
+			}
+			else
+			{
+				Interp_Array_Kernel<uint32_t> kernel = { op, (uint32_t *)x, (uint32_t *)y, (uint32_t *)out, a_count < 0, b_count < 0, count };
+				interp_array_execute(interp, &kernel);
+			}
+		}
+		break;
+
 		NoDefaultCase();
 	}
-	
-	Unreachable();
-	return Evaluation_Value{};
+
+	if (count < out_count && !compound)
+		memset(out + count * node->element_type->runtime_size, 0, (out_count - count) * node->element_type->runtime_size);
+
+	return result;
 }
 
-static Evaluation_Value interp_eval_root_expression(Interpreter *interp, Code_Node_Expression *root)
+//
+// Vectors of 2 to 4 elements, the operands are loaded before the result is written since they may share the frame
+//
+
+static Kano_Real interp_vector_dot(const Kano_Real *x, int64_t count)
 {
-	return interp_eval_expression(interp, root->child);
+#if defined(__SSE2__)
+	auto sum = _mm_mul_pd(_mm_loadu_pd(x), _mm_loadu_pd(x));
+	if (count == 4)
+		sum = _mm_add_pd(sum, _mm_mul_pd(_mm_loadu_pd(x + 2), _mm_loadu_pd(x + 2)));
+	else if (count == 3)
+		sum = _mm_add_pd(sum, _mm_set_pd(0, x[2] * x[2]));
+	return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+#else
+	Kano_Real sum = 0;
+	for (int64_t index = 0; index < count; ++index)
+		sum += x[index] * x[index];
+	return sum;
+#endif
 }
 
-int64_t interp_evaluate_constant_expression(Code_Node_Expression *root) {
-	Interpreter interp;
-	interp_init(&interp, nullptr, 0, 0);
+static void interp_vector_normalize(const Kano_Real *x, Kano_Real *out, int64_t count)
+{
+	auto length = sqrt(interp_vector_dot(x, count));
+	auto scale  = length > 0 ? 1 / length : 0;
+
+#if defined(__SSE2__)
+	auto s  = _mm_set1_pd(scale);
+	auto lo = _mm_mul_pd(_mm_loadu_pd(x), s);
+	auto hi = _mm_mul_pd(_mm_set_pd(count == 4 ? x[3] : 0, count >= 3 ? x[2] : 0), s);
+	_mm_storeu_pd(out, lo);
+	if (count == 4)
+		_mm_storeu_pd(out + 2, hi);
+	else if (count == 3)
+		_mm_store_sd(out + 2, hi);
+#else
+	Kano_Real result[4];
+	for (int64_t index = 0; index < count; ++index)
+		result[index] = x[index] * scale;
+	memcpy(out, result, sizeof(Kano_Real) * count);
+#endif
+}
 
-	Assert(root->type->kind == CODE_TYPE_INTEGER || root->type->kind == CODE_TYPE_CHARACTER);
+template <typename T>
+static void interp_vector_cross(const T *a, const T *b, T *out)
+{
+	T result[3] = {
+		a[1] * b[2] - a[2] * b[1],
+		a[2] * b[0] - a[0] * b[2],
+		a[0] * b[1] - a[1] * b[0],
+	};
+	memcpy(out, result, sizeof(result));
+}
 
-	auto value = interp_eval_root_expression(&interp, root);
+template <bool Traced>
+static Evaluation_Value interp_eval_vector(Interpreter *interp, Code_Node_Vector *node)
+{
+	auto a = interp_eval_expression<Traced>(interp, node->arguments[0]);
+	auto x = EvaluationTypePointer(a, uint8_t);
+
+	uint8_t *y = nullptr;
+	if (node->arguments[1])
+	{
+		auto b = interp_eval_expression<Traced>(interp, node->arguments[1]);
+		y      = EvaluationTypePointer(b, uint8_t);
+	}
+
+	auto array = (Code_Type_Static_Array *)a.type;
+
+	Evaluation_Value result;
+	result.type = node->type;
+
+	if (node->intrinsic == VECTOR_INTRINSIC_LENGTH)
+	{
+		result.imm.real_value = sqrt(interp_vector_dot((Kano_Real *)x, array->element_count));
+		return result;
+	}
+
+	result.from_address = interp->stack + interp->stack_top + node->stack_top;
+
+	switch (node->intrinsic)
+	{
+		case VECTOR_INTRINSIC_NORMALIZE: {
+			interp_vector_normalize((Kano_Real *)x, (Kano_Real *)result.from_address, array->element_count);
+		}
+		break;
+
+		case VECTOR_INTRINSIC_CROSS: {
+			if (array->element_type->kind == CODE_TYPE_REAL)
+				interp_vector_cross((Kano_Real *)x, (Kano_Real *)y, (Kano_Real *)result.from_address);
+			else
+				interp_vector_cross((Kano_Int *)x, (Kano_Int *)y, (Kano_Int *)result.from_address);
+		}
+		break;
+
+		case VECTOR_INTRINSIC_SWIZZLE: {
+			// Both the element types are 8 bytes
+			static_assert(sizeof(Kano_Int) == sizeof(Kano_Real), "");
+
+			auto     count = ((Code_Type_Static_Array *)node->type)->element_count;
+			uint64_t components[4];
+			for (uint32_t index = 0; index < count; ++index)
+				components[index] = ((uint64_t *)x)[node->swizzle[index]];
+			memcpy(result.from_address, components, sizeof(uint64_t) * count);
+		}
+		break;
+
+		NoDefaultCase();
+	}
+
+	return result;
+}
+
+template <bool Traced>
+static Evaluation_Value interp_eval_assignment(Interpreter *interp, Code_Node_Assignment *node)
+{
+	auto value = interp_eval_root_expression<Traced>(interp, (Code_Node_Expression *)node->value);
+
+	// Assignment to a swizzle, the components are copied first as the value may be the same vector
+	if (node->destination->child->kind == CODE_NODE_VECTOR)
+	{
+		auto swizzle = (Code_Node_Vector *)node->destination->child;
+		auto vector  = interp_eval_expression<Traced>(interp, swizzle->arguments[0]);
+		Assert(vector.from_address);
+
+		auto     count = ((Code_Type_Static_Array *)swizzle->type)->element_count;
+		uint64_t components[4];
+		memcpy(components, EvaluationTypePointer(value, void *), sizeof(uint64_t) * count);
+		for (uint32_t index = 0; index < count; ++index)
+			((uint64_t *)vector.from_address)[swizzle->swizzle[index]] = components[index];
+
+		return value;
+	}
+	
+	auto dst = interp_eval_root_expression<Traced>(interp, node->destination);
+	
+	if (dst.from_address)
+	{
+		uint64_t *source = (uint64_t *)EvaluationTypePointer(value, void *);
+		memcpy(dst.from_address, source, value.type->runtime_size);
+	}
+	else if (dst.type->kind == CODE_TYPE_POINTER)
+	{
+		memcpy(dst.imm.pointer_value, EvaluationTypePointer(value, void *), value.type->runtime_size);
+	}
+	else
+	{
+		Unreachable();
+	}
+	
+	return value;
+}
+
+template <bool Traced>
+static void interp_eval_block(Interpreter *interp, Code_Node_Block *root, bool isproc);
+
+static void interp_shared_ccall(Interpreter *interp, CCall ccall);
+static void interp_task_join(Interpreter *interp);
+
+template <bool Traced>
+static inline void interp_push_aligned_parameter(Interpreter *interp, Code_Node_Procedure_Call *root, uint64_t prev_top, uint64_t new_top, uint64_t offset)
+{
+	for (int64_t index = 0; index < root->parameter_count; ++index)
+	{
+		auto param = root->parameters[index];
+		offset = AlignPower2Up(offset, (uint64_t)param->type->alignment);
+		interp->stack_top = prev_top;
+		auto var = interp_eval_root_expression<Traced>(interp, param);
+		interp->stack_top = new_top;
+		offset = interp_push_into_stack(interp, var, offset);
+	}
+}
+
+static Evaluation_Value interp_make_type_value(Interpreter *interp, Code_Type *type) {
+	Evaluation_Value value;
+	value.imm.pointer_value = (uint8_t *)type;
+	value.type = code_type_resolver_find_type(interp->resolver, "*void");
+	return value;
+}
+
+template <bool Traced>
+static Evaluation_Value interp_eval_procedure_call(Interpreter *interp, Code_Node_Procedure_Call *root)
+{
+	auto prev_top = interp->stack_top;
+
+	auto new_top = root->stack_top + prev_top;
+
+	// @Note: We do not align variadics to simplify the variadics routine
+
+	uint64_t variadics_args_size = 0;
+	for (int64_t i = 0; i < root->variadic_count; ++i)
+	{
+		variadics_args_size += root->variadics[i]->type->runtime_size;
+		variadics_args_size += sizeof(Code_Type *);
+	}
+
+	{
+		// @Note: Every variadic is placed after its Code_Type *, the resolver places the function
+		// calls of a variadic above its Code_Type * so that pushing the type does not erase them
+		uint64_t offset = 0;
+		for (int64_t i = 0; i < root->variadic_count; ++i)
+		{
+			interp->stack_top = prev_top;
+			auto param = root->variadics[i];
+			auto var = interp_eval_root_expression<Traced>(interp, param);
+			interp->stack_top = new_top;
+			offset = interp_push_into_stack(interp, interp_make_type_value(interp, param->type), offset);
+			offset = interp_push_into_stack(interp, var, offset);
+		}
+	}
+	
+	new_top += variadics_args_size;
+
+	uint64_t return_type_size = 0;
+	if (root->type)
+	{
+		new_top = AlignPower2Up(new_top, (uint64_t)root->type->alignment);
+		return_type_size = root->type->runtime_size;
+	}
+	else if (root->parameter_count)
+	{
+		new_top = AlignPower2Up(new_top, (uint64_t)root->parameters[0]->type->alignment);
+	}
+
+	interp_push_aligned_parameter<Traced>(interp, root, prev_top, new_top, return_type_size);
+
+	interp->stack_top = prev_top;
+	auto proc_expr = interp_eval_root_expression<Traced>(interp, root->procedure);
+	auto procedure = EvaluationTypeValue(proc_expr, Code_Value_Procedure);
+	
+	auto prev_proc = interp->current_procedure;
+	interp->stack_top = new_top;
+	interp->current_procedure = root->procedure_type;
+
+	if (procedure.block)
+	{
+		auto prev_group = interp->group;
+		interp->group   = nullptr;
+
+		if (!interp_budget_exhausted(interp))
+			interp_eval_block<Traced>(interp, procedure.block, true);
+
+		// The tasks spawned by the procedure finish before it returns
+		if (interp->group)
+			interp_task_join(interp);
+		interp->group = prev_group;
+	}
+	else if (interp->shared && !root->procedure_type->thread_safe)
+		interp_shared_ccall(interp, procedure.ccall);
+	else
+		procedure.ccall(interp);
+
+	Evaluation_Value result;
+	if (root->type)
+	{
+		result.from_address = (uint8_t *)(interp->stack + interp->stack_top);
+		result.type    = root->type;
+	}
+	else
+	{
+		result.from_address = nullptr;
+		result.type    = nullptr;
+	}
+
+	interp->current_procedure = prev_proc;
+	interp->stack_top = prev_top;
+	
+	return result;
+}
+
+template <bool Traced>
+static Evaluation_Value interp_eval_expression(Interpreter *interp, Code_Node *root)
+{
+	switch (root->kind)
+	{
+		case CODE_NODE_LITERAL: return interp_eval_literal(interp, (Code_Node_Literal *)root);
+		case CODE_NODE_UNARY_OPERATOR: return interp_eval_unary_operator<Traced>(interp, (Code_Node_Unary_Operator *)root);
+		case CODE_NODE_BINARY_OPERATOR: return interp_eval_binary_operator<Traced>(interp, (Code_Node_Binary_Operator *)root);
+		case CODE_NODE_ARRAY_OPERATOR: return interp_eval_array_operator<Traced>(interp, (Code_Node_Array_Operator *)root);
+		case CODE_NODE_VECTOR: return interp_eval_vector<Traced>(interp, (Code_Node_Vector *)root);
+		case CODE_NODE_ADDRESS: return interp_eval_address<Traced>(interp, (Code_Node_Address *)root);
+		case CODE_NODE_OFFSET: return interp_eval_offset<Traced>(interp, (Code_Node_Offset *)root);
+		case CODE_NODE_ASSIGNMENT: return interp_eval_assignment<Traced>(interp, (Code_Node_Assignment *)root);
+		case CODE_NODE_TYPE_CAST: return interp_eval_type_cast<Traced>(interp, (Code_Node_Type_Cast *)root);
+		case CODE_NODE_IF: return interp_eval_expression<Traced>(interp, (Code_Node *)root);
+		case CODE_NODE_PROCEDURE_CALL: return interp_eval_procedure_call<Traced>(interp, (Code_Node_Procedure_Call *)root);
+		case CODE_NODE_RETURN: return interp_eval_return<Traced>(interp, (Code_Node_Return *)root);
+		case CODE_NODE_BREAK: interp_eval_break(interp, (Code_Node_Break *)root); return Evaluation_Value{};
+		case CODE_NODE_CONTINUE: interp_eval_continue(interp, (Code_Node_Continue *)root); return Evaluation_Value{};
+		
+		NoDefaultCase();
+	}
+	
+	Unreachable();
+	return Evaluation_Value{};
+}
+
+template <bool Traced>
+static Evaluation_Value interp_eval_root_expression(Interpreter *interp, Code_Node_Expression *root)
+{
+	return interp_eval_expression<Traced>(interp, root->child);
+}
+
+int64_t interp_evaluate_constant_expression(Code_Node_Expression *root) {
+	Interpreter interp;
+	interp_init(&interp, nullptr, 0, 0);
+
+	Assert(root->type->kind == CODE_TYPE_INTEGER || root->type->kind == CODE_TYPE_CHARACTER);
+
+	auto value = interp_eval_root_expression<false>(&interp, root);
 
 	if (value.type->kind == CODE_TYPE_INTEGER)
 		return (int64_t)EvaluationTypeValue(value, Kano_Int);
@@ -1295,8 +1943,10 @@ int64_t interp_evaluate_constant_expression(Code_Node_Expression *root) {
 	return 0;
 }
 
+template <bool Traced>
 static bool interp_eval_statement(Interpreter *interp, Code_Node_Statement *root, Evaluation_Value *value);
 
+template <bool Traced>
 static void interp_eval_do(Interpreter *interp, Code_Node_Do *root)
 {
 	auto do_cond = root->condition;
@@ -1309,8 +1959,10 @@ static void interp_eval_do(Interpreter *interp, Code_Node_Do *root)
 	auto continue_index = interp->continue_count;
 	do
 	{
-		interp_eval_statement(interp, do_body, nullptr);
-		if (return_index != interp->return_count)
+		if (interp_budget_exhausted(interp))
+			break;
+		interp_eval_statement<Traced>(interp, do_body, nullptr);
+		if (return_index != interp->return_count || interp->halt)
 			break;
 		if (continue_index != interp->continue_count)
 		{
@@ -1322,59 +1974,545 @@ static void interp_eval_do(Interpreter *interp, Code_Node_Do *root)
 			interp->break_count = break_index;
 			break;
 		}
-		bool value = interp_eval_statement(interp, do_cond, &cond);
+		bool value = interp_eval_statement<Traced>(interp, do_cond, &cond);
 		Assert(value);
 	} while (EvaluationTypeValue(cond, bool));
 }
 
-static void interp_eval_while(Interpreter *interp, Code_Node_While *root)
+template <bool Traced>
+static void interp_eval_while(Interpreter *interp, Code_Node_While *root)
+{
+	auto while_cond = root->condition;
+	auto while_body = root->body;
+	
+	Evaluation_Value cond;
+	bool value = interp_eval_statement<Traced>(interp, while_cond, &cond);
+	Assert(value);
+	
+	auto return_index = interp->return_count;
+	auto break_index = interp->break_count;
+	auto continue_index = interp->continue_count;
+	while (EvaluationTypeValue(cond, bool))
+	{
+		if (interp_budget_exhausted(interp))
+			break;
+		interp_eval_statement<Traced>(interp, while_body, nullptr);
+		if (return_index != interp->return_count || interp->halt)
+			break;
+		if (continue_index != interp->continue_count)
+		{
+			interp->continue_count = continue_index;
+			continue;
+		}
+		if (break_index != interp->break_count)
+		{
+			interp->break_count = break_index;
+			break;
+		}
+		bool value = interp_eval_statement<Traced>(interp, while_cond, &cond);
+		Assert(value);
+	}
+}
+
+template <bool Traced>
+static void interp_eval_if(Interpreter *interp, Code_Node_If *root)
+{
+	auto cond = interp_eval_root_expression<Traced>(interp, (Code_Node_Expression *)root->condition);
+	if (EvaluationTypeValue(cond, bool))
+	{
+		interp_eval_statement<Traced>(interp, (Code_Node_Statement *)root->true_statement, nullptr);
+	}
+	else
+	{
+		if (root->false_statement)
+			interp_eval_statement<Traced>(interp, (Code_Node_Statement *)root->false_statement, nullptr);
+	}
+}
+
+//
+// The state shared by the concurrent executions, it is created by the first parallel for, spawn or thread
+//
+
+struct Interp_Shared
+{
+	// The allocator of the execution, e.g. the arena of a request, is not thread safe. Every thread
+	// of the execution allocates through the lock, it is held by the C procedures as well since
+	// their builders allocate from the allocator directly.
+	std::recursive_mutex ccall_lock;
+	Memory_Allocator     allocator;
+
+	// The threads not joined by the program are joined when the execution ends
+	std::mutex            thread_lock;
+	struct Interp_Thread *threads     = nullptr;
+	Kano_Int              next_handle = 0;
+};
+
+static void interp_thread_join_all(Interpreter *interp);
+
+static void *interp_shared_allocator_proc(Allocation_Kind kind, void *mem, size_t prev_size, size_t new_size, void *context)
+{
+	auto shared = (Interp_Shared *)context;
+	std::lock_guard<std::recursive_mutex> guard(shared->ccall_lock);
+	return shared->allocator.proc(kind, mem, prev_size, new_size, shared->allocator.context);
+}
+
+static Memory_Allocator interp_shared_allocator(Interp_Shared *shared)
+{
+	return Memory_Allocator{ interp_shared_allocator_proc, shared };
+}
+
+// The thread starting the execution allocates through the lock as well until the execution ends
+static Interp_Shared *interp_shared(Interpreter *interp)
+{
+	if (!interp->shared)
+	{
+		interp->shared            = new Interp_Shared;
+		interp->shared->allocator = ThreadContext.allocator;
+		ThreadContext.allocator   = interp_shared_allocator(interp->shared);
+		if (interp->heap)
+			heap_make_concurrent(interp->heap);
+	}
+	return interp->shared;
+}
+
+static void interp_release_shared(Interpreter *interp)
+{
+	if (interp->shared)
+	{
+		interp_thread_join_all(interp);
+		ThreadContext.allocator = interp->shared->allocator;
+	}
+	delete interp->shared;
+	interp->shared = nullptr;
+}
+
+// The C procedures share the heap and the console
+static void interp_shared_ccall(Interpreter *interp, CCall ccall)
+{
+	std::lock_guard<std::recursive_mutex> guard(interp->shared->ccall_lock);
+	ccall(interp);
+}
+
+//
+// The iterations of a parallel for are split into one lane per worker, every lane has
+// its own interpreter whose stack is a slice of the stack above the current frame.
+//
+
+// Smallest stack slice of a lane, less lanes are used when the stack is too small
+constexpr uint64_t INTERP_PARALLEL_MIN_STACK = 64 * 1024;
+
+// The lanes are taken a chunk at a time so that the idle workers have something to steal
+constexpr int64_t INTERP_PARALLEL_CHUNKS_PER_LANE = 16;
+
+// The owner takes the iterations from the front, the thieves take half of them from the back
+struct Interp_Parallel_Lane
+{
+	std::mutex  lock;
+	int64_t     first = 0;
+	int64_t     last  = 0;
+	Interpreter interp;
+};
+
+struct Interp_Parallel_Job
+{
+	Code_Node_For *       node       = nullptr;
+	Kano_Int              start      = 0;
+	int64_t               chunk      = 1;
+	Interp_Parallel_Lane *lanes      = nullptr;
+	int                   lane_count = 0;
+	std::atomic<bool>     stop       = { false };
+
+	// The workers keep their own context, only the allocator of the execution is shared
+	Memory_Allocator      allocator;
+
+	// Set when the lanes run a native kernel over the iterations instead of the loop body
+	Interp_Range_Kernel   kernel      = nullptr;
+	void *                kernel_data = nullptr;
+
+	// Guarded by the lock of the pool
+	int                   next_lane  = 1;
+	int                   active     = 0;
+	Interp_Parallel_Job * next       = nullptr;
+};
+
+struct Interp_Parallel_Pool
+{
+	std::mutex              lock;
+	std::condition_variable wake;
+	std::condition_variable idle;
+	Interp_Parallel_Job *   jobs         = nullptr;
+	int                     thread_count = 0;
+};
+
+static std::atomic<int> InterpParallelThreads;
+
+void interp_parallel_threads(int count)
+{
+	InterpParallelThreads = count;
+}
+
+static bool interp_parallel_pop(Interp_Parallel_Lane *lane, int64_t chunk, int64_t *first, int64_t *last)
+{
+	std::lock_guard<std::mutex> guard(lane->lock);
+	if (lane->first >= lane->last)
+		return false;
+	*first = lane->first;
+	*last  = Minimum(lane->first + chunk, lane->last);
+	lane->first = *last;
+	return true;
+}
+
+static bool interp_parallel_steal(Interp_Parallel_Job *job, int thief)
+{
+	for (int offset = 1; offset < job->lane_count; ++offset)
+	{
+		auto victim = &job->lanes[(thief + offset) % job->lane_count];
+
+		int64_t first, last;
+		{
+			std::lock_guard<std::mutex> guard(victim->lock);
+			auto remaining = victim->last - victim->first;
+			if (remaining <= 0)
+				continue;
+			last         = victim->last;
+			first        = last - (remaining + 1) / 2;
+			victim->last = first;
+		}
+
+		auto lane = &job->lanes[thief];
+		std::lock_guard<std::mutex> guard(lane->lock);
+		lane->first = first;
+		lane->last  = last;
+		return true;
+	}
+	return false;
+}
+
+static void interp_parallel_run(Interp_Parallel_Job *job, int index)
+{
+	auto lane   = &job->lanes[index];
+	auto interp = &lane->interp;
+	auto node   = job->node;
+
+	auto allocator          = ThreadContext.allocator;
+	ThreadContext.allocator = job->allocator;
+
+	auto continue_index = interp->continue_count;
+
+	int64_t first, last;
+	while (!job->stop.load(std::memory_order_relaxed))
+	{
+		if (!interp_parallel_pop(lane, job->chunk, &first, &last))
+		{
+			if (!interp_parallel_steal(job, index))
+				break;
+			continue;
+		}
+
+		if (job->kernel)
+		{
+			job->kernel(job->kernel_data, first, last);
+			continue;
+		}
+
+		for (auto iteration = first; iteration < last; ++iteration)
+		{
+			if (interp_budget_exhausted(interp))
+			{
+				job->stop = true;
+				break;
+			}
+
+			auto induction = (Kano_Int *)(interp->stack + interp->stack_top + node->induction);
+			*induction     = (Kano_Int)((uint64_t)job->start + (uint64_t)iteration * (uint64_t)node->step);
+
+			interp_eval_statement<false>(interp, node->body, nullptr);
+			interp->continue_count = continue_index;
+
+			if (interp->halt)
+			{
+				job->stop = true;
+				break;
+			}
+		}
+	}
+
+	if (interp->group)
+		interp_task_join(interp);
+
+	ThreadContext.allocator = allocator;
+}
+
+static void interp_parallel_unlink(Interp_Parallel_Pool *pool, Interp_Parallel_Job *job)
+{
+	for (auto link = &pool->jobs; *link; link = &(*link)->next)
+	{
+		if (*link == job)
+		{
+			*link = job->next;
+			break;
+		}
+	}
+}
+
+static void interp_parallel_worker(Interp_Parallel_Pool *pool)
+{
+	InitThreadContext(0);
+
+	std::unique_lock<std::mutex> lock(pool->lock);
+	while (true)
+	{
+		pool->wake.wait(lock, [pool] { return pool->jobs != nullptr; });
+
+		auto job   = pool->jobs;
+		int  index = job->next_lane++;
+
+		// No one else can join once every lane is taken
+		if (index >= job->lane_count - 1)
+			interp_parallel_unlink(pool, job);
+		if (index >= job->lane_count)
+			continue;
+
+		job->active += 1;
+		lock.unlock();
+
+		interp_parallel_run(job, index);
+
+		lock.lock();
+		job->active -= 1;
+		if (!job->active)
+			pool->idle.notify_all();
+	}
+}
+
+static Interp_Parallel_Pool *interp_parallel_pool()
+{
+	static Interp_Parallel_Pool *pool = []() {
+		// The pool outlives the allocator of the execution that starts it, e.g. the arena of a request
+		auto allocator          = ThreadContext.allocator;
+		ThreadContext.allocator = ThreadContextDefaultParams.allocator;
+		Defer { ThreadContext.allocator = allocator; };
+
+		auto pool = new Interp_Parallel_Pool;
+
+		int count = InterpParallelThreads.load();
+		if (count <= 0)
+			count = (int)std::thread::hardware_concurrency();
+
+		// The thread starting the loop works on it as well
+		pool->thread_count = Maximum(count, 1) - 1;
+		for (int index = 0; index < pool->thread_count; ++index)
+			std::thread(interp_parallel_worker, pool).detach();
+
+		return pool;
+	}();
+	return pool;
+}
+
+// The calling thread runs the first lane, the workers join for the others
+static void interp_parallel_execute(Interp_Parallel_Pool *pool, Interp_Parallel_Job *job)
+{
+	if (job->lane_count > 1)
+	{
+		std::lock_guard<std::mutex> guard(pool->lock);
+		auto link = &pool->jobs;
+		while (*link)
+			link = &(*link)->next;
+		*link = job;
+		pool->wake.notify_all();
+	}
+
+	interp_parallel_run(job, 0);
+
+	if (job->lane_count > 1)
+	{
+		std::unique_lock<std::mutex> lock(pool->lock);
+		interp_parallel_unlink(pool, job);
+		pool->idle.wait(lock, [job] { return job->active == 0; });
+	}
+}
+
+void interp_parallel_range(Interpreter *interp, int64_t count, Interp_Range_Kernel kernel, void *data)
+{
+	auto pool = interp_parallel_pool();
+
+	// The lanes of a parallel for and the tasks already run beside the other threads
+	if (interp->parallel || interp->task || !pool->thread_count || count < 2)
+	{
+		kernel(data, 0, count);
+		return;
+	}
+
+	int lane_count = (int)Minimum((int64_t)pool->thread_count + 1, count);
+
+	Interp_Parallel_Job job;
+	job.kernel      = kernel;
+	job.kernel_data = data;
+	job.lanes       = new Interp_Parallel_Lane[lane_count];
+	job.lane_count  = lane_count;
+
+	// The native kernels do not allocate, the default allocator is thread safe in any case
+	job.allocator   = ThreadContextDefaultParams.allocator;
+
+	for (int index = 0; index < lane_count; ++index)
+	{
+		job.lanes[index].first = count * index / lane_count;
+		job.lanes[index].last  = count * (index + 1) / lane_count;
+	}
+
+	interp_parallel_execute(pool, &job);
+
+	delete[] job.lanes;
+}
+
+// The range of a parallel for is computed once before its iterations, also when it runs sequentially
+template <bool Traced>
+static int64_t interp_eval_parallel_range(Interpreter *interp, Code_Node_For *root, Kano_Int *start)
 {
-	auto while_cond = root->condition;
-	auto while_body = root->body;
-	
-	Evaluation_Value cond;
-	bool value = interp_eval_statement(interp, while_cond, &cond);
-	Assert(value);
-	
-	auto return_index = interp->return_count;
-	auto break_index = interp->break_count;
+	interp_eval_statement<Traced>(interp, root->initialization, nullptr);
+
+	*start     = *(Kano_Int *)(interp->stack + interp->stack_top + root->induction);
+	auto value = interp_eval_expression<Traced>(interp, root->bound);
+	auto bound = EvaluationTypeValue(value, Kano_Int);
+
+	// The distances are computed unsigned, they do not fit in int64_t for the extreme bounds.
+	// The counts above INT64_MAX are clamped, the budget stops such loops long before.
+	uint64_t stride = root->step > 0 ? (uint64_t)root->step : 0 - (uint64_t)root->step;
+	uint64_t upper  = (uint64_t)bound - (uint64_t)*start;
+	uint64_t lower  = (uint64_t)*start - (uint64_t)bound;
+	uint64_t limit  = (uint64_t)INT64_MAX - 1;
+
+	uint64_t count = 0;
+	switch (root->compare)
+	{
+		case BINARY_OPERATOR_RELATIONAL_LESS:          count = bound > *start ? (upper - 1) / stride + 1 : 0; break;
+		case BINARY_OPERATOR_RELATIONAL_LESS_EQUAL:    count = bound >= *start ? Minimum(upper / stride, limit) + 1 : 0; break;
+		case BINARY_OPERATOR_RELATIONAL_GREATER:       count = *start > bound ? (lower - 1) / stride + 1 : 0; break;
+		case BINARY_OPERATOR_RELATIONAL_GREATER_EQUAL: count = *start >= bound ? Minimum(lower / stride, limit) + 1 : 0; break;
+		NoDefaultCase();
+	}
+
+	return (int64_t)Minimum(count, (uint64_t)INT64_MAX);
+}
+
+// Runs the iterations of the parallel for in order, the same iterations as the workers
+template <bool Traced>
+static void interp_eval_parallel_for_in_order(Interpreter *interp, Code_Node_For *root)
+{
+	Kano_Int start = 0;
+	auto     count = interp_eval_parallel_range<Traced>(interp, root, &start);
+
 	auto continue_index = interp->continue_count;
-	while (EvaluationTypeValue(cond, bool))
+	for (int64_t iteration = 0; iteration < count; ++iteration)
 	{
-		interp_eval_statement(interp, while_body, nullptr);
-		if (return_index != interp->return_count)
+		if (interp_budget_exhausted(interp))
 			break;
-		if (continue_index != interp->continue_count)
-		{
-			interp->continue_count = continue_index;
-			continue;
-		}
-		if (break_index != interp->break_count)
-		{
-			interp->break_count = break_index;
+
+		auto induction = (Kano_Int *)(interp->stack + interp->stack_top + root->induction);
+		*induction     = (Kano_Int)((uint64_t)start + (uint64_t)iteration * (uint64_t)root->step);
+
+		interp_eval_statement<Traced>(interp, root->body, nullptr);
+		interp->continue_count = continue_index;
+
+		if (interp->halt)
 			break;
-		}
-		bool value = interp_eval_statement(interp, while_cond, &cond);
-		Assert(value);
 	}
 }
 
-static void interp_eval_if(Interpreter *interp, Code_Node_If *root)
+// Returns false when the loop should be executed sequentially instead
+static bool interp_eval_parallel_for(Interpreter *interp, Code_Node_For *root)
 {
-	auto cond = interp_eval_root_expression(interp, (Code_Node_Expression *)root->condition);
-	if (EvaluationTypeValue(cond, bool))
+	// Nested parallel loops run on the worker that reaches them, the loops of a task on the task
+	if (interp->parallel || interp->task)
+		return false;
+
+	auto pool = interp_parallel_pool();
+	if (!pool->thread_count)
+		return false;
+
+	uint64_t private_top = interp->stack_top + root->private_offset;
+	if (private_top + 2 * INTERP_PARALLEL_MIN_STACK > interp->stack_size)
+		return false;
+
+	Kano_Int start = 0;
+	auto     count = interp_eval_parallel_range<false>(interp, root, &start);
+
+	if (count <= 0)
+		return true;
+
+	int lane_count = pool->thread_count + 1;
+	lane_count     = (int)Minimum((int64_t)lane_count, count);
+	lane_count     = (int)Minimum((uint64_t)lane_count, (interp->stack_size - private_top) / INTERP_PARALLEL_MIN_STACK);
+
+	uint64_t lane_stack = AlignPower2Down((interp->stack_size - private_top) / lane_count, (uint64_t)64);
+	uint64_t remaining  = interp->budget.ticks > interp->ticks ? interp->budget.ticks - interp->ticks : 0;
+
+	Interp_Parallel_Job job;
+	job.node       = root;
+	job.start      = start;
+	job.chunk      = Maximum((int64_t)1, count / (lane_count * INTERP_PARALLEL_CHUNKS_PER_LANE));
+	job.lanes      = new Interp_Parallel_Lane[lane_count];
+	job.lane_count = lane_count;
+	job.allocator  = interp_shared_allocator(interp_shared(interp));
+
+	for (int index = 0; index < lane_count; ++index)
 	{
-		interp_eval_statement(interp, (Code_Node_Statement *)root->true_statement, nullptr);
+		auto lane   = &job.lanes[index];
+		lane->first = count * index / lane_count;
+		lane->last  = count * (index + 1) / lane_count;
+
+		auto worker             = &lane->interp;
+		*worker                 = *interp;
+		worker->stack           = interp->stack + index * lane_stack;
+		worker->stack_size      = private_top + lane_stack;
+		worker->shared_stack    = interp->stack;
+		worker->stack_private   = private_top;
+		worker->parallel        = &job;
+		worker->return_count    = 0;
+		worker->break_count     = 0;
+		worker->continue_count  = 0;
+		worker->ticks           = 0;
+		worker->budget.ticks    = remaining;
+		worker->budget_exceeded = false;
+		worker->halt            = false;
 	}
-	else
+
+	interp_parallel_execute(pool, &job);
+
+	for (int index = 0; index < lane_count; ++index)
 	{
-		if (root->false_statement)
-			interp_eval_statement(interp, (Code_Node_Statement *)root->false_statement, nullptr);
+		auto worker = &job.lanes[index].interp;
+		interp->ticks += worker->ticks;
+		if (worker->budget_exceeded)
+			interp->budget_exceeded = true;
 	}
+
+	if (interp->ticks > interp->budget.ticks)
+		interp->budget_exceeded = true;
+	if (interp->budget_exceeded)
+		interp->halt = true;
+
+	delete[] job.lanes;
+
+	return true;
 }
 
+template <bool Traced>
 static void interp_eval_for(Interpreter *interp, Code_Node_For *root)
 {
+	// The traced executions run the loop in order so that the steps are deterministic
+	if (root->parallel)
+	{
+		if constexpr (!Traced)
+		{
+			if (interp_eval_parallel_for(interp, root))
+				return;
+		}
+
+		interp_eval_parallel_for_in_order<Traced>(interp, root);
+		return;
+	}
+
 	auto for_init = root->initialization;
 	auto for_cond = root->condition;
 	auto for_incr = root->increment;
@@ -1382,8 +2520,8 @@ static void interp_eval_for(Interpreter *interp, Code_Node_For *root)
 	
 	Evaluation_Value cond;
 	
-	interp_eval_statement(interp, for_init, nullptr);
-	bool value = interp_eval_statement(interp, for_cond, &cond);
+	interp_eval_statement<Traced>(interp, for_init, nullptr);
+	bool value = interp_eval_statement<Traced>(interp, for_cond, &cond);
 	Assert(value);
 	
 	auto return_index = interp->return_count;
@@ -1391,8 +2529,10 @@ static void interp_eval_for(Interpreter *interp, Code_Node_For *root)
 	auto continue_index = interp->continue_count;
 	while (EvaluationTypeValue(cond, bool))
 	{
-		interp_eval_statement(interp, for_body, nullptr);
-		if (return_index != interp->return_count)
+		if (interp_budget_exhausted(interp))
+			break;
+		interp_eval_statement<Traced>(interp, for_body, nullptr);
+		if (return_index != interp->return_count || interp->halt)
 			break;
 		if (continue_index != interp->continue_count)
 		{
@@ -1405,19 +2545,545 @@ static void interp_eval_for(Interpreter *interp, Code_Node_For *root)
 			break;
 		}
 		bool value;
-		value = interp_eval_statement(interp, for_incr, nullptr);
+		value = interp_eval_statement<Traced>(interp, for_incr, nullptr);
 		Assert(value);
-		value = interp_eval_statement(interp, for_cond, &cond);
+		value = interp_eval_statement<Traced>(interp, for_cond, &cond);
 		Assert(value);
 	}
 }
 
+//
+// A spawned task runs the procedure on an interpreter stack and a native stack of its own.
+// The tasks are multiplexed on the threads of the scheduler and switch at the ticks of the
+// budget, i.e. at the calls and the loop back edges. A procedure joins the tasks it spawned
+// when it returns, a task waiting on a join gives its thread to the other tasks.
+//
+
+#if PLATFORM_LINUX
+
+// Both stacks are reserved and only committed when touched
+constexpr uint64_t INTERP_TASK_STACK_SIZE        = 1024 * 1024;
+constexpr uint64_t INTERP_TASK_NATIVE_STACK_SIZE = 8 * 1024 * 1024;
+
+enum Interp_Task_State
+{
+	INTERP_TASK_YIELDED,
+	INTERP_TASK_JOINING,
+	INTERP_TASK_FINISHED
+};
+
+// Guarded by the lock of the scheduler
+struct Interp_Task_Group
+{
+	int64_t             pending         = 0;
+	uint64_t            ticks           = 0;
+	bool                budget_exceeded = false;
+	struct Interp_Task *waiter          = nullptr;
+};
+
+struct Interp_Task
+{
+	Interpreter          interp;
+	Code_Value_Procedure procedure;
+	Interp_Task_Group *  group        = nullptr;
+	Interp_Task_Group *  joining      = nullptr;
+	Interp_Task_State    state        = INTERP_TASK_YIELDED;
+	Memory_Allocator     allocator;
+	ucontext_t           fiber;
+	ucontext_t *         worker       = nullptr;
+	uint8_t *            native_stack = nullptr;
+	Interp_Task *        next         = nullptr;
+};
+
+struct Interp_Scheduler
+{
+	std::mutex              lock;
+	std::condition_variable ready;
+	std::condition_variable joined;
+	Interp_Task *           head = nullptr;
+	Interp_Task *           tail = nullptr;
+};
+
+// The task a worker is switching to, read by the task when it starts
+static thread_local Interp_Task *InterpTaskStarting;
+
+static void interp_task_push(Interp_Scheduler *scheduler, Interp_Task *task)
+{
+	task->next = nullptr;
+	if (scheduler->tail)
+		scheduler->tail->next = task;
+	else
+		scheduler->head = task;
+	scheduler->tail = task;
+	scheduler->ready.notify_one();
+}
+
+static Interp_Task *interp_task_pop(Interp_Scheduler *scheduler)
+{
+	auto task       = scheduler->head;
+	scheduler->head = task->next;
+	if (!scheduler->head)
+		scheduler->tail = nullptr;
+	return task;
+}
+
+static void interp_task_free(Interp_Task *task)
+{
+	munmap(task->native_stack, INTERP_TASK_NATIVE_STACK_SIZE);
+	munmap(task->interp.stack, INTERP_TASK_STACK_SIZE);
+	delete task;
+}
+
+static void interp_task_switch(Interp_Task *task, Interp_Task_State state)
+{
+	task->state = state;
+	swapcontext(&task->fiber, task->worker);
+}
+
+static void interp_task_yield(Interpreter *interp)
+{
+	interp_task_switch(interp->task, INTERP_TASK_YIELDED);
+}
+
+static void interp_task_entry()
+{
+	auto task   = InterpTaskStarting;
+	auto interp = &task->interp;
+
+	if (task->procedure.block)
+	{
+		if (!interp_budget_exhausted(interp))
+			interp_eval_block<false>(interp, task->procedure.block, true);
+	}
+	else
+		interp_shared_ccall(interp, task->procedure.ccall);
+
+	if (interp->group)
+		interp_task_join(interp);
+
+	interp_task_switch(task, INTERP_TASK_FINISHED);
+}
+
+static void interp_task_worker(Interp_Scheduler *scheduler)
+{
+	InitThreadContext(0);
+
+	ucontext_t worker;
+
+	std::unique_lock<std::mutex> lock(scheduler->lock);
+	while (true)
+	{
+		scheduler->ready.wait(lock, [scheduler] { return scheduler->head != nullptr; });
+
+		auto task = interp_task_pop(scheduler);
+		lock.unlock();
+
+		// The carriers keep their own context, only the allocator of the execution is shared
+		auto allocator          = ThreadContext.allocator;
+		ThreadContext.allocator = task->allocator;
+		task->worker            = &worker;
+		InterpTaskStarting      = task;
+		swapcontext(&worker, &task->fiber);
+		ThreadContext.allocator = allocator;
+
+		lock.lock();
+		switch (task->state)
+		{
+			case INTERP_TASK_YIELDED:
+				interp_task_push(scheduler, task);
+				break;
+
+			case INTERP_TASK_JOINING:
+				// The task is resumed by the last task of the group it is waiting on
+				if (task->joining->pending)
+					task->joining->waiter = task;
+				else
+					interp_task_push(scheduler, task);
+				break;
+
+			case INTERP_TASK_FINISHED: {
+				auto group    = task->group;
+				group->ticks += task->interp.ticks;
+				if (task->interp.budget_exceeded)
+					group->budget_exceeded = true;
+
+				group->pending -= 1;
+				if (!group->pending)
+				{
+					if (group->waiter)
+						interp_task_push(scheduler, group->waiter);
+					group->waiter = nullptr;
+					scheduler->joined.notify_all();
+				}
+
+				lock.unlock();
+				interp_task_free(task);
+				lock.lock();
+			}
+			break;
+
+			NoDefaultCase();
+		}
+	}
+}
+
+static Interp_Scheduler *interp_task_scheduler()
+{
+	static Interp_Scheduler *scheduler = []() {
+		// The scheduler outlives the allocator of the execution that starts it, e.g. the arena of a request
+		auto allocator          = ThreadContext.allocator;
+		ThreadContext.allocator = ThreadContextDefaultParams.allocator;
+		Defer { ThreadContext.allocator = allocator; };
+
+		auto scheduler = new Interp_Scheduler;
+
+		int count = InterpParallelThreads.load();
+		if (count <= 0)
+			count = (int)std::thread::hardware_concurrency();
+
+		for (int index = 0; index < Maximum(count, 1); ++index)
+			std::thread(interp_task_worker, scheduler).detach();
+
+		return scheduler;
+	}();
+	return scheduler;
+}
+
+static void interp_task_join(Interpreter *interp)
+{
+	auto scheduler = interp_task_scheduler();
+	auto group     = interp->group;
+
+	if (interp->task)
+	{
+		interp->task->joining = group;
+		interp_task_switch(interp->task, INTERP_TASK_JOINING);
+	}
+	else
+	{
+		std::unique_lock<std::mutex> lock(scheduler->lock);
+		scheduler->joined.wait(lock, [group] { return group->pending == 0; });
+	}
+
+	interp->ticks += group->ticks;
+	if (group->budget_exceeded || interp->ticks > interp->budget.ticks)
+		interp->budget_exceeded = true;
+	if (interp->budget_exceeded)
+		interp->halt = true;
+
+	auto allocator          = ThreadContext.allocator;
+	ThreadContext.allocator = ThreadContextDefaultParams.allocator;
+	delete group;
+	ThreadContext.allocator = allocator;
+
+	interp->group = nullptr;
+}
+
+// Returns false when the task could not be created
+static bool interp_task_spawn(Interpreter *interp, Code_Node_Procedure_Call *root)
+{
+	const int protection = PROT_READ | PROT_WRITE;
+	const int flags      = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+
+	auto stack  = (uint8_t *)mmap(nullptr, INTERP_TASK_STACK_SIZE, protection, flags, -1, 0);
+	auto native = (uint8_t *)mmap(nullptr, INTERP_TASK_NATIVE_STACK_SIZE, protection, flags, -1, 0);
+
+	if (stack == MAP_FAILED || native == MAP_FAILED)
+	{
+		if (stack != MAP_FAILED)
+			munmap(stack, INTERP_TASK_STACK_SIZE);
+		if (native != MAP_FAILED)
+			munmap(native, INTERP_TASK_NATIVE_STACK_SIZE);
+		return false;
+	}
+
+	// Guard page, the native stack grows down
+	mprotect(native, 4096, PROT_NONE);
+
+	auto scheduler = interp_task_scheduler();
+	auto shared    = interp_shared(interp);
+
+	Interp_Task *task;
+	{
+		// The tasks are freed by the workers
+		auto allocator          = ThreadContext.allocator;
+		ThreadContext.allocator = ThreadContextDefaultParams.allocator;
+		Defer { ThreadContext.allocator = allocator; };
+
+		task = new Interp_Task;
+		if (!interp->group)
+			interp->group = new Interp_Task_Group;
+	}
+
+	auto worker               = &task->interp;
+	*worker                   = *interp;
+	worker->stack             = stack;
+	worker->stack_size        = INTERP_TASK_STACK_SIZE;
+	worker->stack_top         = 0;
+	worker->shared_stack      = nullptr;
+	worker->stack_private     = 0;
+	worker->parallel          = nullptr;
+	worker->task              = task;
+	worker->group             = nullptr;
+	worker->return_count      = 0;
+	worker->break_count       = 0;
+	worker->continue_count    = 0;
+	worker->current_procedure = root->procedure_type;
+	worker->ticks             = 0;
+	worker->budget.ticks      = interp->budget.ticks > interp->ticks ? interp->budget.ticks - interp->ticks : 0;
+	worker->budget_exceeded   = false;
+	worker->halt              = false;
+
+	// The arguments are evaluated by the spawner and copied into the first frame of the task
+	uint64_t offset = root->type ? root->type->runtime_size : 0;
+	for (int64_t index = 0; index < root->parameter_count; ++index)
+	{
+		auto param = root->parameters[index];
+		offset     = AlignPower2Up(offset, (uint64_t)param->type->alignment);
+		auto var   = interp_eval_root_expression<false>(interp, param);
+		memmove(stack + offset, EvaluationTypePointer(var, void *), var.type->runtime_size);
+		offset += var.type->runtime_size;
+	}
+
+	auto proc_expr     = interp_eval_root_expression<false>(interp, root->procedure);
+	task->procedure    = EvaluationTypeValue(proc_expr, Code_Value_Procedure);
+	task->group        = interp->group;
+	task->allocator    = interp_shared_allocator(shared);
+	task->native_stack = native;
+
+	getcontext(&task->fiber);
+	task->fiber.uc_stack.ss_sp   = native;
+	task->fiber.uc_stack.ss_size = INTERP_TASK_NATIVE_STACK_SIZE;
+	task->fiber.uc_link          = nullptr;
+	makecontext(&task->fiber, interp_task_entry, 0);
+
+	std::lock_guard<std::mutex> guard(scheduler->lock);
+	task->group->pending += 1;
+	interp_task_push(scheduler, task);
+
+	return true;
+}
+
+#else
+
+static void interp_task_yield(Interpreter *interp)
+{
+}
+
+static void interp_task_join(Interpreter *interp)
+{
+}
+
+static bool interp_task_spawn(Interpreter *interp, Code_Node_Procedure_Call *root)
+{
+	return false;
+}
+
+#endif
+
+//
+// The OS threads run a procedure on an interpreter stack of their own, they share the
+// globals and the heap with the thread that started them.
+//
+
+constexpr uint64_t INTERP_THREAD_STACK_SIZE = 1024 * 1024;
+
+struct Interp_Thread
+{
+	Interpreter          interp;
+	Code_Value_Procedure procedure;
+	Memory_Allocator     allocator;
+	std::thread          thread;
+	Kano_Int             handle = 0;
+	Interp_Thread *      next   = nullptr;
+};
+
+static void interp_thread_run(Interp_Thread *thread)
+{
+	// The thread has a scratchpad of its own, only the allocator of the execution is shared
+	InitThreadContext(0);
+	ThreadContext.allocator = thread->allocator;
+
+	auto interp = &thread->interp;
+	if (thread->procedure.block)
+	{
+		if (!interp_budget_exhausted(interp))
+			interp_eval_block<false>(interp, thread->procedure.block, true);
+	}
+	else
+		interp_shared_ccall(interp, thread->procedure.ccall);
+
+	if (interp->group)
+		interp_task_join(interp);
+}
+
+Kano_Int interp_thread_start(Interpreter *interp, Code_Value_Procedure procedure, void *argument)
+{
+	auto proc_type = (Code_Type_Procedure *)code_type_resolver_find_type(interp->resolver, "proc(*void)");
+
+	// The traced executions run the procedure in place so that the steps are deterministic
+	if (interp->intercept)
+	{
+		auto prev_top  = interp->stack_top;
+		auto prev_proc = interp->current_procedure;
+
+		// The frame of the C procedure starting the thread is below the one of the procedure
+		uint64_t frame = prev_proc->return_type ? prev_proc->return_type->runtime_size : 0;
+		for (int64_t index = 0; index < prev_proc->argument_count; ++index)
+		{
+			auto type = prev_proc->arguments[index];
+			frame     = AlignPower2Up(frame, (uint64_t)type->alignment) + type->runtime_size;
+		}
+
+		interp->stack_top         = AlignPower2Up(prev_top + frame, (uint64_t)sizeof(Code_Value_Procedure));
+		interp->current_procedure = proc_type;
+		memcpy(interp->stack + interp->stack_top, &argument, sizeof(argument));
+
+		if (procedure.block)
+		{
+			if (!interp_budget_exhausted(interp))
+				interp_eval_block<true>(interp, procedure.block, true);
+		}
+		else
+			procedure.ccall(interp);
+
+		interp->stack_top         = prev_top;
+		interp->current_procedure = prev_proc;
+		return 0;
+	}
+
+	auto shared = interp_shared(interp);
+
+	Interp_Thread *thread;
+	{
+		// The thread is freed by whoever joins it
+		auto allocator          = ThreadContext.allocator;
+		ThreadContext.allocator = ThreadContextDefaultParams.allocator;
+		Defer { ThreadContext.allocator = allocator; };
+
+		thread = new Interp_Thread;
+		thread->interp.stack = new uint8_t[INTERP_THREAD_STACK_SIZE];
+	}
+
+	auto worker               = &thread->interp;
+	auto stack                = worker->stack;
+	*worker                   = *interp;
+	worker->stack             = stack;
+	worker->stack_size        = INTERP_THREAD_STACK_SIZE;
+	worker->stack_top         = 0;
+	worker->shared_stack      = nullptr;
+	worker->stack_private     = 0;
+	worker->parallel          = nullptr;
+	worker->task              = nullptr;
+	worker->group             = nullptr;
+	worker->return_count      = 0;
+	worker->break_count       = 0;
+	worker->continue_count    = 0;
+	worker->current_procedure = proc_type;
+	worker->ticks             = 0;
+	worker->budget.ticks      = interp->budget.ticks > interp->ticks ? interp->budget.ticks - interp->ticks : 0;
+	worker->budget_exceeded   = false;
+	worker->halt              = false;
+
+	memcpy(stack, &argument, sizeof(argument));
+
+	thread->procedure = procedure;
+	thread->allocator = interp_shared_allocator(shared);
+
+	{
+		std::lock_guard<std::mutex> guard(shared->thread_lock);
+		thread->handle  = ++shared->next_handle;
+		thread->next    = shared->threads;
+		shared->threads = thread;
+	}
+
+	thread->thread = std::thread(interp_thread_run, thread);
+
+	return thread->handle;
+}
+
+static void interp_thread_finish(Interpreter *interp, Interp_Thread *thread)
+{
+	thread->thread.join();
+
+	interp->ticks += thread->interp.ticks;
+	if (thread->interp.budget_exceeded || interp->ticks > interp->budget.ticks)
+		interp->budget_exceeded = true;
+	if (interp->budget_exceeded)
+		interp->halt = true;
+
+	auto allocator          = ThreadContext.allocator;
+	ThreadContext.allocator = ThreadContextDefaultParams.allocator;
+	delete[] thread->interp.stack;
+	delete thread;
+	ThreadContext.allocator = allocator;
+}
+
+void interp_thread_join(Interpreter *interp, Kano_Int handle)
+{
+	auto shared = interp->shared;
+	if (!shared)
+		return;
+
+	Interp_Thread *thread = nullptr;
+	{
+		std::lock_guard<std::mutex> guard(shared->thread_lock);
+		for (auto link = &shared->threads; *link; link = &(*link)->next)
+		{
+			if ((*link)->handle == handle)
+			{
+				thread = *link;
+				*link  = thread->next;
+				break;
+			}
+		}
+	}
+
+	// Unknown handles and the threads joined already are ignored
+	if (thread)
+		interp_thread_finish(interp, thread);
+}
+
+static void interp_thread_join_all(Interpreter *interp)
+{
+	auto shared = interp->shared;
+	while (true)
+	{
+		Interp_Thread *thread;
+		{
+			std::lock_guard<std::mutex> guard(shared->thread_lock);
+			thread = shared->threads;
+			if (!thread)
+				break;
+			shared->threads = thread->next;
+		}
+		interp_thread_finish(interp, thread);
+	}
+}
+
+template <bool Traced>
+static void interp_eval_spawn(Interpreter *interp, Code_Node_Spawn *root)
+{
+	// The traced executions run the task to completion at the spawn so that the steps are deterministic
+	if constexpr (!Traced)
+	{
+		if (interp_task_spawn(interp, root->call))
+			return;
+	}
+
+	interp_eval_procedure_call<Traced>(interp, root->call);
+}
+
+template <bool Traced>
 static bool interp_eval_statement(Interpreter *interp, Code_Node_Statement *root, Evaluation_Value *out_value)
 {
 	Assert(root->symbol_table);
 
-	interp->current_row = root->source_row;
-	interp->intercept(interp, INTERCEPT_STATEMENT, root);
+	if constexpr (Traced)
+	{
+		interp->current_row = root->source_row;
+		interp->intercept(interp, INTERCEPT_STATEMENT, root);
+	}
 
 	Evaluation_Value value;
 	Evaluation_Value *dst = out_value ? out_value : &value;
@@ -1425,31 +3091,35 @@ static bool interp_eval_statement(Interpreter *interp, Code_Node_Statement *root
 	switch (root->node->kind)
 	{
 		case CODE_NODE_EXPRESSION: 
-			*dst = interp_eval_root_expression(interp, (Code_Node_Expression *)root->node);
+			*dst = interp_eval_root_expression<Traced>(interp, (Code_Node_Expression *)root->node);
 			return true;
 		
 		case CODE_NODE_ASSIGNMENT:
-			*dst = interp_eval_assignment(interp, (Code_Node_Assignment *)root->node);
+			*dst = interp_eval_assignment<Traced>(interp, (Code_Node_Assignment *)root->node);
 			return true;
 		
 		case CODE_NODE_BLOCK:
-			interp_eval_block(interp, (Code_Node_Block *)root->node, false);
+			interp_eval_block<Traced>(interp, (Code_Node_Block *)root->node, false);
 			return false;
 		
 		case CODE_NODE_IF:
-			interp_eval_if(interp, (Code_Node_If *)root->node);
+			interp_eval_if<Traced>(interp, (Code_Node_If *)root->node);
 			return false;
 		
 		case CODE_NODE_FOR:
-			interp_eval_for(interp, (Code_Node_For *)root->node);
+			interp_eval_for<Traced>(interp, (Code_Node_For *)root->node);
 			return false;
 		
 		case CODE_NODE_WHILE:
-			interp_eval_while(interp, (Code_Node_While *)root->node);
+			interp_eval_while<Traced>(interp, (Code_Node_While *)root->node);
 			return false;
 		
 		case CODE_NODE_DO:
-			interp_eval_do(interp, (Code_Node_Do *)root->node);
+			interp_eval_do<Traced>(interp, (Code_Node_Do *)root->node);
+			return false;
+		
+		case CODE_NODE_SPAWN:
+			interp_eval_spawn<Traced>(interp, (Code_Node_Spawn *)root->node);
 			return false;
 		
 		NoDefaultCase();
@@ -1460,11 +3130,13 @@ static bool interp_eval_statement(Interpreter *interp, Code_Node_Statement *root
 	return false;
 }
 
+template <bool Traced>
 static void interp_eval_block(Interpreter *interp, Code_Node_Block *root, bool isproc)
 {
-	if (isproc)
+	if constexpr (Traced)
 	{
-		interp->intercept(interp, INTERCEPT_PROCEDURE_CALL, root);
+		if (isproc)
+			interp->intercept(interp, INTERCEPT_PROCEDURE_CALL, root);
 	}
 
 	auto return_index = interp->return_count;
@@ -1472,7 +3144,7 @@ static void interp_eval_block(Interpreter *interp, Code_Node_Block *root, bool i
 	auto continue_index = interp->continue_count;
 	for (auto statement = root->statement_head; statement; statement = statement->next)
 	{
-		interp_eval_statement(interp, statement, nullptr);
+		interp_eval_statement<Traced>(interp, statement, nullptr);
 
 		if (return_index != interp->return_count)
 		{
@@ -1481,13 +3153,14 @@ static void interp_eval_block(Interpreter *interp, Code_Node_Block *root, bool i
 			break;
 		}
 
-		if (break_index != interp->break_count || continue_index != interp->continue_count)
+		if (break_index != interp->break_count || continue_index != interp->continue_count || interp->halt)
 			break;
 	}
 
-	if (isproc)
+	if constexpr (Traced)
 	{
-		interp->intercept(interp, INTERCEPT_PROCEDURE_RETURN, root);
+		if (isproc)
+			interp->intercept(interp, INTERCEPT_PROCEDURE_RETURN, root);
 	}
 }
 
@@ -1508,8 +3181,20 @@ void interp_init(Interpreter *interp, Code_Type_Resolver *resolver, size_t stack
 
 void interp_eval_globals(Interpreter *interp, Array_View<Code_Node_Assignment *> exprs)
 {
-	for (auto expr : exprs)
-		interp_eval_assignment(interp, expr);
+	interp_start_budget(interp);
+
+	if (interp->intercept)
+	{
+		for (auto expr : exprs)
+			interp_eval_assignment<true>(interp, expr);
+	}
+	else
+	{
+		for (auto expr : exprs)
+			interp_eval_assignment<false>(interp, expr);
+	}
+
+	interp_release_shared(interp);
 }
 
 #include "JsonWriter.h"
@@ -1564,5 +3249,12 @@ Code_Node_Procedure_Call *interp_find_main(Interpreter *interp) {
 }
 
 void interp_evaluate_procedure(Interpreter *interp, Code_Node_Procedure_Call *proc) {
-	interp_eval_procedure_call(interp, proc);
+	interp_start_budget(interp);
+
+	if (interp->intercept)
+		interp_eval_procedure_call<true>(interp, proc);
+	else
+		interp_eval_procedure_call<false>(interp, proc);
+
+	interp_release_shared(interp);
 }
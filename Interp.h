@@ -11,27 +11,61 @@ enum Intercept_Kind
 
 typedef void(*Intercep_Proc)(struct Interpreter *interp, Intercept_Kind intercept, struct Code_Node *node);
 
-inline void intercept_default(struct Interpreter *interp, Intercept_Kind intercept, struct Code_Node *statement){};
+// A tick is counted for every loop iteration and procedure call, the execution
+// halts once the ticks or the milliseconds (zero for no deadline) run out
+struct Interp_Budget
+{
+	uint64_t ticks = UINT64_MAX;
+	uint64_t milliseconds = 0;
+};
 
+// The interpreters of the spawned tasks and of the parallel for lanes are copies of the
+// interpreter that started them, they own the per task state and share the rest
 struct Interpreter
 {
+	// Per task
 	uint8_t *stack = nullptr;
 	uint64_t stack_size = 0;
-	uint8_t *global = nullptr;
-	uint64_t global_size = 0;
 	uint64_t stack_top = 0;
 	int64_t  return_count = 0;
 	int64_t break_count = 0;
 	int64_t continue_count = 0;
 	struct Code_Type_Procedure *current_procedure = nullptr;
-	Symbol_Table *global_symbol_table = nullptr;
-	struct Heap_Allocator *heap = nullptr;
 
+	// Only updated when the intercept is set
 	uint64_t current_row = 0;
 
+	// Set to stop the execution, the blocks and loops unwind at the next statement
+	bool halt = false;
+
+	Interp_Budget budget;
+	uint64_t      ticks = 0;
+	uint64_t      deadline = 0;
+	bool          budget_exceeded = false;
+
+	// Set on the workers of a parallel for, the frame below stack_private belongs to
+	// the thread that started the loop and is addressed from shared_stack
+	uint8_t *shared_stack = nullptr;
+	uint64_t stack_private = 0;
+	struct Interp_Parallel_Job *parallel = nullptr;
+
+	// Set on the spawned tasks, the group collects the tasks spawned by the current procedure
+	struct Interp_Task *      task  = nullptr;
+	struct Interp_Task_Group *group = nullptr;
+
+	// Shared
+	uint8_t *global = nullptr;
+	uint64_t global_size = 0;
+	Symbol_Table *global_symbol_table = nullptr;
+	struct Heap_Allocator *heap = nullptr;
 	struct Code_Type_Resolver *resolver = nullptr;
 
-	Intercep_Proc intercept = intercept_default;
+	// Created once the execution goes concurrent, serializes the calls into the C procedures
+	struct Interp_Shared *shared = nullptr;
+
+	// The interpreter is compiled twice, the variant without the intercept is
+	// used when this is null and has no per statement hook and bookkeeping
+	Intercep_Proc intercept = nullptr;
 	void *user_context = nullptr;
 };
 
@@ -43,3 +77,17 @@ void interp_evaluate_procedure(Interpreter *interp, Code_Node_Procedure_Call *pr
 
 int64_t interp_evaluate_constant_expression(Code_Node_Expression *root);
 
+// Threads that execute a parallel for, including the one starting it, 0 uses one per core
+// The spawned tasks are scheduled on as many threads
+// Only takes effect before the first parallel for or spawn
+void interp_parallel_threads(int count);
+
+// Calls the kernel on sub ranges of [0, count) from the threads of the parallel for,
+// the whole range is run on the calling thread when it can not be split
+typedef void (*Interp_Range_Kernel)(void *data, int64_t first, int64_t last);
+void interp_parallel_range(Interpreter *interp, int64_t count, Interp_Range_Kernel kernel, void *data);
+
+// Runs the procedure on a new OS thread with an interpreter stack of its own, the globals and the heap
+// are shared. Returns the handle to join, the traced executions run the procedure to completion instead
+Kano_Int interp_thread_start(Interpreter *interp, Code_Value_Procedure procedure, void *argument);
+void     interp_thread_join(Interpreter *interp, Kano_Int handle);
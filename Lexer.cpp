@@ -478,6 +478,27 @@ void lexer_next(Lexer *lexer)
 			return;
 		}
 
+		// Directives
+		if (a == '#' && lexer_isalpha(b))
+		{
+			lexer->cursor++;
+
+			String content;
+			content.data = lexer->cursor;
+			while (lexer_isalpha(*lexer->cursor) || lexer_isnum(*lexer->cursor))
+				lexer->cursor++;
+			content.length = (lexer->cursor - content.data);
+
+			if (content == "soa")
+			{
+				lexer_make_token(lexer, TOKEN_KIND_SOA);
+				return;
+			}
+
+			lexer_error(lexer, "Unknown directive");
+			return;
+		}
+
 		if (lexer_isalpha(*lexer->cursor))
 		{
 			const char *string = (char *)lexer->cursor;
@@ -493,14 +514,15 @@ void lexer_next(Lexer *lexer)
 
 			static const String     KeyWords[]      = {"var",     "const", "true",   "false",  "byte", "int",   "float", "bool",
                                               "if",      "then",  "else",   "for",    "while", "do",    "size_of",
-                                              "type_of", "proc",  "struct", "return", "break", "continue", "cast",  "void",  "null"};
+                                              "type_of", "proc",  "struct", "return", "break", "continue", "cast",  "void",  "null",
+                                              "parallel", "spawn"};
 
 			static const Token_Kind KeyWordTokens[] = {
 			    TOKEN_KIND_VAR,   TOKEN_KIND_CONST,  TOKEN_KIND_TRUE,   TOKEN_KIND_FALSE, TOKEN_KIND_BYTE, TOKEN_KIND_INT,
 			    TOKEN_KIND_FLOAT, TOKEN_KIND_BOOL,   TOKEN_KIND_IF,     TOKEN_KIND_THEN,    TOKEN_KIND_ELSE,
 			    TOKEN_KIND_FOR,   TOKEN_KIND_WHILE,  TOKEN_KIND_DO,     TOKEN_KIND_SIZE_OF, TOKEN_KIND_TYPE_OF,
 			    TOKEN_KIND_PROC,  TOKEN_KIND_STRUCT, TOKEN_KIND_RETURN, TOKEN_KIND_BREAK, TOKEN_KIND_CONTINUE, TOKEN_KIND_CAST,    TOKEN_KIND_VOID,
-			    TOKEN_KIND_NULL};
+			    TOKEN_KIND_NULL,  TOKEN_KIND_PARALLEL, TOKEN_KIND_SPAWN};
 
 			static_assert(ArrayCount(KeyWords) == ArrayCount(KeyWordTokens));
 
@@ -8,6 +8,7 @@
 
 #include "StringBuilder.h"
 #include "StdLib.h"
+#include "Metrics.h"
 
 //
 //
@@ -38,77 +39,13 @@ struct Call_Stack {
 	Symbol_Table *symbols;
 };
 
-static void json_write_symbol(Json_Writer *json, Interpreter *interp, String name, Code_Type *type, void *data);
-
-static void json_write_type_name(Json_Writer *json, Code_Type *type)
-{
-	if (!type)
-	{
-		json->append_string_value("void");
-		return;
-	}
-
-	switch (type->kind)
-	{
-		case CODE_TYPE_NULL: json->append_string_value("void"); return;
-		case CODE_TYPE_CHARACTER: json->append_string_value("byte"); return;
-		case CODE_TYPE_INTEGER: json->append_string_value("int"); return;
-		case CODE_TYPE_REAL: json->append_string_value("float"); return;
-		case CODE_TYPE_BOOL: json->append_string_value("bool"); return;
-
-		case CODE_TYPE_POINTER: {
-			json->append_string_value("*"); 
-			json_write_type_name(json, ((Code_Type_Pointer *)type)->base_type);
-			return;
-		}
-
-		case CODE_TYPE_PROCEDURE: {
-			auto proc = (Code_Type_Procedure *)type;
-			json->append_string_value("proc(");
-			for (int64_t index = 0; index < proc->argument_count; ++index)
-			{
-				json_write_type_name(json, proc->arguments[index]);
-				if (index < proc->argument_count - 1) json->append_string_value(", ");
-			}
-			json->append_string_value(")");
-
-			if (proc->return_type)
-			{
-				json->append_string_value("->");
-				json_write_type_name(json, proc->return_type);
-			}
-			return;
-		}
-
-		case CODE_TYPE_STRUCT: {
-			auto strt = (Code_Type_Struct *)type;
-			json->append_string_value("%", strt->name); 
-			return;
-		}
-
-		case CODE_TYPE_ARRAY_VIEW: {
-			auto arr = (Code_Type_Array_View *)type;
-			json->append_string_value("[]");
-			json_write_type_name(json, arr->element_type);
-			return;
-		}
-
-		case CODE_TYPE_STATIC_ARRAY: {
-			auto arr = (Code_Type_Static_Array *)type;
-			json->append_string_value("[%]", arr->element_count);
-			json_write_type_name(json, arr->element_type);
-			return;
-		}
-	}
-}
+static void json_write_value(Json_Writer *json, Interpreter *interp, Code_Type *type, void *data, Memory_Type memory);
+static void json_write_ops(Json_Writer *json, Interpreter *interp, Type_Op *ops, int64_t count, uint8_t *base, Memory_Type memory);
 
 static void json_write_type(Json_Writer *json, Code_Type *type)
 {
 	json->begin_object();
-	json->write_key("name");
-	json->begin_string_value();
-	json_write_type_name(json, type);
-	json->end_string_value();
+	json->write_key_value_formatted("name", "%", type_name(type));
 
 	if (type->kind == CODE_TYPE_POINTER)
 	{
@@ -150,7 +87,150 @@ static void json_write_type(Json_Writer *json, Code_Type *type)
 	json->end_object();
 }
 
-static void json_write_value(Json_Writer *json, Interpreter *interp, Code_Type *type, void *data)
+static void json_write_pointer(Json_Writer *json, Interpreter *interp, Code_Type_Pointer *pointer_type, void *data)
+{
+	void *raw_ptr = *(void **)data;
+
+	json->begin_object();
+
+	if (raw_ptr)
+		json->write_key_value_formatted("raw", "0x%", raw_ptr);
+	else
+		json->write_key_value_formatted("raw", "%", "null");
+
+	json->write_key_value_formatted("base_type", "%", type_name(pointer_type->base_type));
+
+	auto mem_type = interp_get_memory_type(interp, raw_ptr);
+
+	json->write_key_value_formatted("memory", "%", memory_type_string(mem_type));
+
+	json->write_key("value");
+	if (mem_type != Memory_Type_INVALID)
+	{
+		json_write_value(json, interp, pointer_type->base_type, raw_ptr, mem_type);
+	}
+	else
+	{
+		json->write_single_value("%", raw_ptr ? String("(garbage)") : String("(invalid)"));
+	}
+
+	json->end_object();
+}
+
+// The members of the #soa elements are read from the block of each member
+static void json_write_soa(Json_Writer *json, Interpreter *interp, Code_Type_Struct *_struct, uint8_t *data, int64_t count, Memory_Type memory)
+{
+	json->begin_array();
+	for (int64_t element = 0; element < count; ++element)
+	{
+		json->begin_array();
+		for (int64_t index = 0; index < _struct->member_count; ++index)
+		{
+			auto member = &_struct->members[index];
+			auto member_data = data + count * member->offset + element * member->type->runtime_size;
+
+			json->begin_object();
+			json->write_key_value_formatted("name", "%", member->name);
+			json->write_key_value_formatted("type", "%", type_name(member->type));
+			json->write_key_value_formatted("address", "0x%", (void *)member_data);
+			json->write_key_value_formatted("memory", "%", memory_type_string(memory));
+			json->write_key("value");
+			json_write_value(json, interp, member->type, member_data, memory);
+			json->end_object();
+		}
+		json->end_array();
+	}
+	json->end_array();
+}
+
+static void json_write_array_view(Json_Writer *json, Interpreter *interp, Code_Type_Array_View *arr_type, void *data)
+{
+	Kano_Int *ptr = (Kano_Int *)data;
+
+	auto arr_count = ptr[0];
+	auto arr_data  = reinterpret_cast<uint8_t *>(*(size_t *)(ptr + 1));
+
+	auto element = arr_type->element_type;
+	auto ops     = &type_info(element)->ops;
+	auto mem_type = interp_get_memory_type(interp, arr_data);
+
+	if (!interp_array_view_readable(interp, arr_data, arr_count, element->runtime_size))
+		arr_count = 0;
+
+	if (arr_type->soa)
+	{
+		json_write_soa(json, interp, (Code_Type_Struct *)element, arr_data, arr_count, mem_type);
+		return;
+	}
+
+	json->begin_array();
+	for (int64_t index = 0; index < arr_count; ++index)
+	{
+		json_write_ops(json, interp, ops->data, ops->count, arr_data + index * element->runtime_size, mem_type);
+	}
+	json->end_array();
+}
+
+// Members of the values share the memory of their parent, so it is only looked up
+// for the values reached through pointers and array views
+static void json_write_ops(Json_Writer *json, Interpreter *interp, Type_Op *ops, int64_t count, uint8_t *base, Memory_Type memory)
+{
+	for (int64_t index = 0; index < count; ++index)
+	{
+		auto op   = &ops[index];
+		auto data = base + op->offset;
+
+		switch (op->kind)
+		{
+			case TYPE_OP_NULL: json->write_single_value("(null)"); break;
+			case TYPE_OP_CHARACTER: json->write_single_value("%", (int) *(Kano_Char *)data); break;
+			case TYPE_OP_INTEGER: json->write_single_value("%", *(Kano_Int *)data); break;
+			case TYPE_OP_REAL: json->write_single_value("%", *(Kano_Real *)data); break;
+			case TYPE_OP_BOOL: json->write_single_value("%", (*(Kano_Bool *)data) ? "true" : "false"); break;
+			case TYPE_OP_SIZED_INTEGER: json->write_single_value("%", code_type_sized_integer_value(op->type->runtime_size, ((Code_Type_Sized_Integer *)op->type)->is_signed, data)); break;
+			case TYPE_OP_SIZED_REAL: json->write_single_value("%", (Kano_Real) *(float *)data); break;
+			case TYPE_OP_PROCEDURE: json->write_single_value("%", (void *)data); break;
+			case TYPE_OP_POINTER: json_write_pointer(json, interp, (Code_Type_Pointer *)op->type, data); break;
+			case TYPE_OP_ARRAY_VIEW: json_write_array_view(json, interp, (Code_Type_Array_View *)op->type, data); break;
+
+			case TYPE_OP_STRUCT: {
+				json->begin_array();
+				json_write_ops(json, interp, op + 1, op->count, data, memory);
+				json->end_array();
+				index += op->count;
+			} break;
+
+			case TYPE_OP_MEMBER: {
+				json->begin_object();
+				json->write_key_value_formatted("name", "%", op->name);
+				json->write_key_value_formatted("type", "%", type_name(op->type));
+				json->write_key_value_formatted("address", "0x%", (void *)data);
+				json->write_key_value_formatted("memory", "%", memory_type_string(memory));
+				json->write_key("value");
+				json_write_ops(json, interp, op + 1, op->count, data, memory);
+				json->end_object();
+				index += op->count;
+			} break;
+
+			case TYPE_OP_ARRAY: {
+				json->begin_array();
+				for (uint32_t element = 0; element < op->repeat; ++element)
+				{
+					json_write_ops(json, interp, op + 1, op->count, data + element * op->stride, memory);
+				}
+				json->end_array();
+				index += op->count;
+			} break;
+
+			case TYPE_OP_SOA_ARRAY: {
+				auto element = ((Code_Type_Static_Array *)op->type)->element_type;
+				json_write_soa(json, interp, (Code_Type_Struct *)element, data, op->repeat, memory);
+			} break;
+		}
+	}
+}
+
+static void json_write_value(Json_Writer *json, Interpreter *interp, Code_Type *type, void *data, Memory_Type memory)
 {
 	if (!data)
 	{
@@ -158,282 +238,834 @@ static void json_write_value(Json_Writer *json, Interpreter *interp, Code_Type *
 		return;
 	}
 
-	switch (type->kind)
+	auto ops = &type_info(type)->ops;
+	json_write_ops(json, interp, ops->data, ops->count, (uint8_t *)data, memory);
+}
+
+static void json_write_symbol(Json_Writer *json, Interpreter *interp, String name, Code_Type *type, void *data)
+{
+	json->begin_object();
+	json->write_key_value_formatted("name", "%", name);
+	json->write_key_value_formatted("type", "%", type_name(type));
+
+	auto mem_type = interp_get_memory_type(interp, data);
+	json->write_key_value_formatted("address", "0x%", data);
+	json->write_key_value_formatted("memory", "%", memory_type_string(mem_type));
+	
+	json->write_key("value");
+	json_write_value(json, interp, type, data, mem_type);
+	
+	json->end_object();
+}
+
+static bool symbol_data(Interpreter *interp, Symbol *symbol, uint64_t stack_top, uint64_t skip_stack_offset, void **data)
+{
+	if ((symbol->flags & SYMBOL_BIT_TYPE))
+		return false;
+
+	if (symbol->type->kind == CODE_TYPE_PROCEDURE && (symbol->flags & SYMBOL_BIT_CONSTANT))
+		return false;
+
+	if (symbol->address.kind == Symbol_Address::CCALL)
+		return false;
+
+	if (symbol->address.kind == Symbol_Address::STACK)
 	{
-		case CODE_TYPE_NULL: json->write_single_value("(null)"); return;
-		case CODE_TYPE_CHARACTER: json->write_single_value("%", (int) *(Kano_Char *)data); return;
-		case CODE_TYPE_INTEGER: json->write_single_value("%", *(Kano_Int *)data); return;
-		case CODE_TYPE_REAL: json->write_single_value("%", *(Kano_Real *)data); return;
-		case CODE_TYPE_BOOL: json->write_single_value("%", (*(Kano_Bool *)data) ? "true" : "false"); return;
-		case CODE_TYPE_PROCEDURE: json->write_single_value("%", data); return;
+		auto offset = stack_top + symbol->address.offset;
+		if (offset > skip_stack_offset) return false;
+		*data = interp->stack + offset;
+	}
+	else if (symbol->address.kind == Symbol_Address::GLOBAL)
+		*data = interp->global + symbol->address.offset;
+	else if (symbol->address.kind == Symbol_Address::CODE)
+		*data = symbol->address.code;
+	else
+		Unreachable();
 
-		case CODE_TYPE_POINTER: {
-			auto pointer_type = (Code_Type_Pointer *)type;
-			void *raw_ptr = *(void **)data;
+	return true;
+}
 
-			json->begin_object();
+static void json_write_symbols(Interpreter *interp, Json_Writer *json, Symbol_Table *symbols, uint64_t stack_top, uint64_t skip_stack_offset)
+{
+	for (auto &pair : symbols->map)
+	{
+		auto symbol = pair.value;
 
-			if (raw_ptr)
-				json->write_key_value_formatted("raw", "0x%", raw_ptr);
-			else
-				json->write_key_value_formatted("raw", "%", "null");
+		void *data = nullptr;
+		if (!symbol_data(interp, symbol, stack_top, skip_stack_offset, &data))
+			continue;
 
-			json->write_key("base_type");
-			json->begin_string_value();
-			json_write_type_name(json, pointer_type->base_type);
-			json->end_string_value();
+		json_write_symbol(json, interp, symbol->name, symbol->type, data);
+	}
+}
 
-			auto mem_type = interp_get_memory_type(interp, raw_ptr);
+static void json_write_table_symbols(Interpreter *interp, Json_Writer *json, Symbol_Table *symbol_table, uint64_t stack_top, uint64_t skip_stack_offset)
+{
+	for (auto symbols = symbol_table; symbols != interp->global_symbol_table; symbols = symbols->parent)
+	{
+		json_write_symbols(interp, json, symbols, stack_top, skip_stack_offset);
+	}
+}
 
-			json->write_key_value_formatted("memory", "%", memory_type_string(mem_type));
+static void json_write_procedure_symbols(Interpreter *interp, Json_Writer *json, String procedure_name, Symbol_Table *symbol_table, uint64_t stack_top, uint64_t skip_stack_offset)
+{
+	json->begin_object();
 
-			json->write_key("value");
-			if (mem_type != Memory_Type_INVALID)
-			{
-				json_write_value(json, interp, pointer_type->base_type, raw_ptr);
-			}
-			else
+	json->write_key_value_formatted("procedure", "%", procedure_name);
+	json->write_key("variables");
+	json->begin_array();
+	json_write_table_symbols(interp, json, symbol_table, stack_top, skip_stack_offset);
+	json->end_array();
+	
+	json->end_object();
+}
+
+static void json_write_state(Json_Writer *json, Interpreter *interp, Interp_User_Context *context, Intercept_Kind intercept, Code_Node *node)
+{
+	json->write_key("globals");
+	json->begin_array();
+	json_write_symbols(interp, json, interp->global_symbol_table, 0, 0);
+	json->end_array();
+
+	json->write_key("callstack");
+	json->begin_array();
+
+	if (intercept == INTERCEPT_STATEMENT)
+	{
+		auto statement = (Code_Node_Statement *)node;
+
+		// Don't print the last added calstack before we are already printing it
+		for (int64_t index = 0; index < context->callstack.count - 1; ++index)
+		{
+			auto call = &context->callstack[index];
+			json_write_procedure_symbols(interp, json, call->procedure_name, call->symbols, call->stack_top, interp->stack_top);
+		}
+
+		json_write_procedure_symbols(interp, json, interp->current_procedure->name, statement->symbol_table, interp->stack_top, UINT64_MAX);
+	}
+	else
+	{
+		for (int64_t index = 0; index < context->callstack.count; ++index)
+		{
+			auto call = &context->callstack[index];
+			json_write_procedure_symbols(interp, json, call->procedure_name, call->symbols, call->stack_top, interp->stack_top);
+		}
+	}
+
+	json->end_array();
+
+	json->write_key("console_out");
+	json->begin_string_value();
+	json->append_builder(&context->console_out);
+	json->end_string_value();
+
+	json->write_key_value_formatted("console_in", "%", context->console_in);
+}
+
+//
+//
+//
+
+static void trace_capture_symbols(Interpreter *interp, Trace_State *trace, Trace_Snapshot *snapshot, Symbol_Table *symbols, uint64_t stack_top, uint64_t skip_stack_offset)
+{
+	for (auto &pair : symbols->map)
+	{
+		auto symbol = pair.value;
+
+		void *data = nullptr;
+		if (!symbol_data(interp, symbol, stack_top, skip_stack_offset, &data))
+			continue;
+
+		Trace_Variable *var = snapshot->variables.Add();
+		var->name    = symbol->name;
+		var->type    = symbol->type;
+		var->address = data;
+		var->offset  = snapshot->bytes.count;
+
+		if (type_info(symbol->type)->indirection)
+		{
+			auto json = &trace->scratch_json;
+			json->builder     = &trace->scratch;
+			json->index       = 0;
+			json->elements[0] = false;
+
+			ResetBuilder(&trace->scratch);
+			json_write_value(json, interp, symbol->type, data, interp_get_memory_type(interp, data));
+
+			for (auto buk = &trace->scratch.head; buk; buk = buk->next)
 			{
-				json->write_single_value("%", raw_ptr ? String("(garbage)") : String("(invalid)"));
+				snapshot->bytes.Copy(Array_View<uint8_t>(buk->data, buk->written));
 			}
+		}
+		else
+		{
+			snapshot->bytes.Copy(Array_View<uint8_t>((uint8_t *)data, symbol->type->runtime_size));
+		}
+
+		var->length = snapshot->bytes.count - var->offset;
+	}
+}
+
+static void trace_capture_frame(Interpreter *interp, Trace_State *trace, Trace_Snapshot *snapshot, String procedure_name, Symbol_Table *symbol_table, uint64_t stack_top, uint64_t skip_stack_offset)
+{
+	Trace_Frame *frame = snapshot->frames.Add();
+	frame->procedure_name = procedure_name;
+	frame->stack_top      = stack_top;
+	frame->first_variable = snapshot->variables.count;
+
+	if (symbol_table == interp->global_symbol_table)
+	{
+		trace_capture_symbols(interp, trace, snapshot, symbol_table, stack_top, skip_stack_offset);
+	}
+	else
+	{
+		for (auto symbols = symbol_table; symbols != interp->global_symbol_table; symbols = symbols->parent)
+		{
+			trace_capture_symbols(interp, trace, snapshot, symbols, stack_top, skip_stack_offset);
+		}
+	}
+
+	frame->variable_count = snapshot->variables.count - frame->first_variable;
+}
+
+static void trace_capture(Interpreter *interp, Interp_User_Context *context, Intercept_Kind intercept, Code_Node *node, Trace_Snapshot *snapshot)
+{
+	auto trace = &context->trace;
+
+	snapshot->frames.Reset();
+	snapshot->variables.Reset();
+	snapshot->bytes.Reset();
+
+	trace_capture_frame(interp, trace, snapshot, "", interp->global_symbol_table, 0, 0);
 
+	if (intercept == INTERCEPT_STATEMENT)
+	{
+		auto statement = (Code_Node_Statement *)node;
+
+		for (int64_t index = 0; index < context->callstack.count - 1; ++index)
+		{
+			auto call = &context->callstack[index];
+			trace_capture_frame(interp, trace, snapshot, call->procedure_name, call->symbols, call->stack_top, interp->stack_top);
+		}
+
+		trace_capture_frame(interp, trace, snapshot, interp->current_procedure->name, statement->symbol_table, interp->stack_top, UINT64_MAX);
+	}
+	else
+	{
+		for (int64_t index = 0; index < context->callstack.count; ++index)
+		{
+			auto call = &context->callstack[index];
+			trace_capture_frame(interp, trace, snapshot, call->procedure_name, call->symbols, call->stack_top, interp->stack_top);
+		}
+	}
+}
+
+static Trace_Variable *trace_find_variable(Trace_Snapshot *snapshot, Trace_Frame *frame, Trace_Variable *var, int64_t hint)
+{
+	if (hint < frame->variable_count)
+	{
+		auto prev = &snapshot->variables[frame->first_variable + hint];
+		if (prev->address == var->address && StrMatch(prev->name, var->name))
+			return prev;
+	}
+
+	for (int64_t index = 0; index < frame->variable_count; ++index)
+	{
+		auto prev = &snapshot->variables[frame->first_variable + index];
+		if (prev->address == var->address && StrMatch(prev->name, var->name))
+			return prev;
+	}
+
+	return nullptr;
+}
+
+static bool trace_variable_changed(Trace_Snapshot *prev_snapshot, Trace_Variable *prev, Trace_Snapshot *next_snapshot, Trace_Variable *next)
+{
+	if (!prev || prev->type != next->type || prev->length != next->length)
+		return true;
+	return memcmp(prev_snapshot->bytes.data + prev->offset, next_snapshot->bytes.data + next->offset, next->length) != 0;
+}
+
+// Writes the variables of the frame that are new or whose value changed since the
+// previous step, followed by the variables that went out of the scope.
+// When the frame does not exist in the previous step all the variables are written.
+static void json_write_frame_delta(Json_Writer *json, Interpreter *interp, Trace_Snapshot *prev_snapshot, Trace_Frame *prev, Trace_Snapshot *next_snapshot, Trace_Frame *next)
+{
+	json->write_key("variables");
+	json->begin_array();
+	for (int64_t index = 0; index < next->variable_count; ++index)
+	{
+		auto var      = &next_snapshot->variables[next->first_variable + index];
+		auto prev_var = prev ? trace_find_variable(prev_snapshot, prev, var, index) : nullptr;
+
+		if (trace_variable_changed(prev_snapshot, prev_var, next_snapshot, var))
+			json_write_symbol(json, interp, var->name, var->type, var->address);
+	}
+	json->end_array();
+
+	json->write_key("removed");
+	json->begin_array();
+	if (prev)
+	{
+		for (int64_t index = 0; index < prev->variable_count; ++index)
+		{
+			auto var = &prev_snapshot->variables[prev->first_variable + index];
+			if (trace_find_variable(next_snapshot, next, var, index))
+				continue;
+
+			json->begin_object();
+			json->write_key_value_formatted("name", "%", var->name);
+			json->write_key_value_formatted("address", "0x%", var->address);
 			json->end_object();
-			return;
 		}
+	}
+	json->end_array();
+}
+
+static bool trace_frame_changed(Trace_Snapshot *prev_snapshot, Trace_Frame *prev, Trace_Snapshot *next_snapshot, Trace_Frame *next)
+{
+	if (prev->variable_count != next->variable_count)
+		return true;
+
+	for (int64_t index = 0; index < next->variable_count; ++index)
+	{
+		auto var      = &next_snapshot->variables[next->first_variable + index];
+		auto prev_var = &prev_snapshot->variables[prev->first_variable + index];
+
+		if (prev_var->address != var->address || !StrMatch(prev_var->name, var->name))
+			return true;
+
+		if (trace_variable_changed(prev_snapshot, prev_var, next_snapshot, var))
+			return true;
+	}
+
+	return false;
+}
+
+static void json_write_delta(Json_Writer *json, Interpreter *interp, Interp_User_Context *context, Trace_Snapshot *prev, Trace_Snapshot *next)
+{
+	auto trace = &context->trace;
+
+	json->write_key("globals");
+	json->begin_object();
+	json_write_frame_delta(json, interp, prev, &prev->frames[0], next, &next->frames[0]);
+	json->end_object();
+
+	json->write_key_value("callstack_depth", next->frames.count - 1);
+
+	json->write_key("callstack");
+	json->begin_array();
+	for (int64_t index = 1; index < next->frames.count; ++index)
+	{
+		auto frame      = &next->frames[index];
+		auto prev_frame = index < prev->frames.count ? &prev->frames[index] : nullptr;
+
+		if (prev_frame && (prev_frame->stack_top != frame->stack_top || !StrMatch(prev_frame->procedure_name, frame->procedure_name)))
+			prev_frame = nullptr;
+
+		if (prev_frame && !trace_frame_changed(prev, prev_frame, next, frame))
+			continue;
+
+		json->begin_object();
+		json->write_key_value("index", index - 1);
+		json->write_key_value_formatted("procedure", "%", frame->procedure_name);
+		json->write_key_value("reset", prev_frame == nullptr);
+		json_write_frame_delta(json, interp, prev, prev_frame, next, frame);
+		json->end_object();
+	}
+	json->end_array();
+
+	json->write_key("console_out_append");
+	json->begin_string_value();
+	int64_t skip = trace->console_out_written;
+	for (auto buk = &context->console_out.head; buk; buk = buk->next)
+	{
+		if (skip >= buk->written)
+		{
+			skip -= buk->written;
+			continue;
+		}
+		WriteBuffer(json->builder, buk->data + skip, buk->written - skip);
+		skip = 0;
+	}
+	json->end_string_value();
+
+	if (trace->console_in.data != context->console_in.data || trace->console_in.length != context->console_in.length)
+	{
+		json->write_key_value_formatted("console_in", "%", context->console_in);
+	}
+}
+
+//
+//
+//
+
+static uint64_t binary_string_id(Trace_State *trace, String_Builder *builder, String string)
+{
+	auto id = trace->binary_strings.Find(string);
+	if (id) return *id;
+
+	uint64_t new_id = trace->binary_strings.ElementCount() + 1;
+	trace->binary_strings.Put(string, new_id);
+
+	trace_write_raw(builder, TRACE_RECORD_STRING);
+	trace_write_varint(builder, new_id);
+	trace_write_varint(builder, string.length);
+	WriteBuffer(builder, string.data, string.length);
+
+	return new_id;
+}
+
+static uint64_t binary_type_id(Trace_State *trace, String_Builder *builder, Code_Type *type)
+{
+	if (!type) return 0;
+
+	auto id = trace->binary_types.Find((uint64_t)type);
+	if (id) return *id;
+
+	// Registered before the dependencies so that the self referencing types terminate
+	uint64_t new_id = trace->binary_types.ElementCount() + 1;
+	trace->binary_types.Put((uint64_t)type, new_id);
+
+	uint64_t name = binary_string_id(trace, builder, type_name(type));
+
+	switch (type->kind)
+	{
+		case CODE_TYPE_POINTER: {
+			auto pointer_type = (Code_Type_Pointer *)type;
+			uint64_t base = binary_type_id(trace, builder, pointer_type->base_type);
+
+			trace_write_raw(builder, TRACE_RECORD_TYPE);
+			trace_write_varint(builder, new_id);
+			trace_write_raw(builder, (uint8_t)type->kind);
+			trace_write_varint(builder, type->runtime_size);
+			trace_write_varint(builder, name);
+			trace_write_raw(builder, (uint8_t)true);
+			trace_write_varint(builder, base);
+		} break;
 
 		case CODE_TYPE_STRUCT: {
 			auto _struct = (Code_Type_Struct *)type;
 
-			json->begin_array();
-
+			Array<uint64_t> members;
+			members.Reserve(_struct->member_count * 2);
 			for (int64_t index = 0; index < _struct->member_count; ++index)
 			{
 				auto member = &_struct->members[index];
+				members.Add(binary_string_id(trace, builder, member->name));
+				members.Add(binary_type_id(trace, builder, member->type));
+			}
 
-				json_write_symbol(json, interp, member->name, member->type, (uint8_t *)data + member->offset);
+			trace_write_raw(builder, TRACE_RECORD_TYPE);
+			trace_write_varint(builder, new_id);
+			trace_write_raw(builder, (uint8_t)type->kind);
+			trace_write_varint(builder, type->runtime_size);
+			trace_write_varint(builder, name);
+			trace_write_raw(builder, (uint8_t)type_info(type)->indirection);
+			trace_write_varint(builder, _struct->member_count);
+			for (int64_t index = 0; index < _struct->member_count; ++index)
+			{
+				trace_write_varint(builder, members[index * 2 + 0]);
+				trace_write_varint(builder, members[index * 2 + 1]);
+				trace_write_varint(builder, _struct->members[index].offset);
 			}
 
-			json->end_array();
-			return;
+			Free(&members);
+		} break;
+
+		case CODE_TYPE_ARRAY_VIEW: {
+			auto arr = (Code_Type_Array_View *)type;
+			uint64_t element = binary_type_id(trace, builder, arr->element_type);
+
+			trace_write_raw(builder, TRACE_RECORD_TYPE);
+			trace_write_varint(builder, new_id);
+			trace_write_raw(builder, (uint8_t)type->kind);
+			trace_write_varint(builder, type->runtime_size);
+			trace_write_varint(builder, name);
+			trace_write_raw(builder, (uint8_t)true);
+			trace_write_varint(builder, element);
+			trace_write_raw(builder, (uint8_t)arr->soa);
+		} break;
+
+		case CODE_TYPE_STATIC_ARRAY: {
+			auto arr = (Code_Type_Static_Array *)type;
+			uint64_t element = binary_type_id(trace, builder, arr->element_type);
+
+			trace_write_raw(builder, TRACE_RECORD_TYPE);
+			trace_write_varint(builder, new_id);
+			trace_write_raw(builder, (uint8_t)type->kind);
+			trace_write_varint(builder, type->runtime_size);
+			trace_write_varint(builder, name);
+			trace_write_raw(builder, (uint8_t)type_info(type)->indirection);
+			trace_write_varint(builder, arr->element_count);
+			trace_write_varint(builder, element);
+			trace_write_raw(builder, (uint8_t)arr->soa);
+		} break;
+
+		case CODE_TYPE_SIZED_INTEGER: {
+			trace_write_raw(builder, TRACE_RECORD_TYPE);
+			trace_write_varint(builder, new_id);
+			trace_write_raw(builder, (uint8_t)type->kind);
+			trace_write_varint(builder, type->runtime_size);
+			trace_write_varint(builder, name);
+			trace_write_raw(builder, (uint8_t)false);
+			trace_write_raw(builder, (uint8_t)((Code_Type_Sized_Integer *)type)->is_signed);
+		} break;
+
+		default: {
+			trace_write_raw(builder, TRACE_RECORD_TYPE);
+			trace_write_varint(builder, new_id);
+			trace_write_raw(builder, (uint8_t)type->kind);
+			trace_write_varint(builder, type->runtime_size);
+			trace_write_varint(builder, name);
+			trace_write_raw(builder, (uint8_t)false);
+		} break;
+	}
+
+	return new_id;
+}
+
+static uint64_t binary_symbol_id(Trace_State *trace, String_Builder *builder, Symbol *symbol)
+{
+	auto id = trace->binary_symbols.Find((uint64_t)symbol);
+	if (id) return *id;
+
+	uint64_t new_id = trace->binary_symbols.ElementCount() + 1;
+	trace->binary_symbols.Put((uint64_t)symbol, new_id);
+
+	uint64_t name = binary_string_id(trace, builder, symbol->name);
+	uint64_t type = binary_type_id(trace, builder, symbol->type);
+
+	trace_write_raw(builder, TRACE_RECORD_SYMBOL);
+	trace_write_varint(builder, new_id);
+	trace_write_varint(builder, name);
+	trace_write_varint(builder, type);
+
+	return new_id;
+}
+
+static void binary_write_value(Interpreter *interp, String_Builder *record, Code_Type *type, void *data);
+
+// The #soa elements are gathered first, so that they are written the same as the elements of the other arrays
+static void binary_write_soa(Interpreter *interp, String_Builder *record, Code_Type_Struct *_struct, uint8_t *data, int64_t count)
+{
+	Array<uint8_t> element;
+	element.Resize(_struct->runtime_size);
+	memset(element.data, 0, element.count);
+
+	for (int64_t index = 0; index < count; ++index)
+	{
+		for (int64_t member_index = 0; member_index < _struct->member_count; ++member_index)
+		{
+			auto member = &_struct->members[member_index];
+			auto size   = member->type->runtime_size;
+			memcpy(element.data + member->offset, data + count * member->offset + index * size, size);
 		}
+		binary_write_value(interp, record, _struct, element.data);
+	}
+
+	Free(&element);
+}
+
+static void binary_write_value(Interpreter *interp, String_Builder *record, Code_Type *type, void *data)
+{
+	if (type->kind == CODE_TYPE_STATIC_ARRAY && ((Code_Type_Static_Array *)type)->soa)
+	{
+		auto arr_type = (Code_Type_Static_Array *)type;
+		binary_write_soa(interp, record, (Code_Type_Struct *)arr_type->element_type, (uint8_t *)data, arr_type->element_count);
+		return;
+	}
+
+	if (!type_info(type)->indirection)
+	{
+		WriteBuffer(record, data, type->runtime_size);
+		return;
+	}
+
+	switch (type->kind)
+	{
+		case CODE_TYPE_POINTER: {
+			auto pointer_type = (Code_Type_Pointer *)type;
+			void *raw_ptr = *(void **)data;
+
+			auto mem_type = interp_get_memory_type(interp, raw_ptr);
+			trace_write_raw(record, (uint64_t)raw_ptr);
+			trace_write_raw(record, (uint8_t)mem_type);
+
+			if (mem_type != Memory_Type_INVALID && pointer_type->base_type)
+				binary_write_value(interp, record, pointer_type->base_type, raw_ptr);
+		} break;
+
+		case CODE_TYPE_STRUCT: {
+			auto _struct = (Code_Type_Struct *)type;
+			for (int64_t index = 0; index < _struct->member_count; ++index)
+			{
+				auto member = &_struct->members[index];
+				binary_write_value(interp, record, member->type, (uint8_t *)data + member->offset);
+			}
+		} break;
 
 		case CODE_TYPE_ARRAY_VIEW: {
 			auto arr_type = (Code_Type_Array_View *)type;
-			
+
 			Kano_Int *ptr = (Kano_Int *)data;
 
 			auto arr_count = ptr[0];
 			auto arr_data  = reinterpret_cast<uint8_t *>(*(size_t *)(ptr + 1));
 
-			json->begin_array();
+			if (!interp_array_view_readable(interp, arr_data, arr_count, arr_type->element_type->runtime_size))
+				arr_count = 0;
+
+			trace_write_raw(record, (int64_t)arr_count);
+			trace_write_raw(record, (uint64_t)arr_data);
+			trace_write_raw(record, (uint8_t)interp_get_memory_type(interp, arr_data));
+
+			if (arr_type->soa)
+			{
+				binary_write_soa(interp, record, (Code_Type_Struct *)arr_type->element_type, arr_data, arr_count);
+				break;
+			}
+
 			for (int64_t index = 0; index < arr_count; ++index)
 			{
-				json_write_value(json, interp, arr_type->element_type, arr_data + index * arr_type->element_type->runtime_size);
+				binary_write_value(interp, record, arr_type->element_type, arr_data + index * arr_type->element_type->runtime_size);
 			}
-			json->end_array();
-
-			return;
-		}
+		} break;
 
 		case CODE_TYPE_STATIC_ARRAY: {
 			auto arr_type = (Code_Type_Static_Array *)type;
-
 			auto arr_data = (uint8_t *)data;
-
-			json->begin_array();
 			for (int64_t index = 0; index < arr_type->element_count; ++index)
 			{
-				json_write_value(json, interp, arr_type->element_type, arr_data + index * arr_type->element_type->runtime_size);
+				binary_write_value(interp, record, arr_type->element_type, arr_data + index * arr_type->element_type->runtime_size);
 			}
-			json->end_array();
+		} break;
 
-			return;
-		}
+		NoDefaultCase();
 	}
 }
 
-static void json_write_symbol(Json_Writer *json, Interpreter *interp, String name, Code_Type *type, void *data)
+static void binary_write_symbols(Interpreter *interp, Trace_State *trace, String_Builder *builder, Symbol_Table *symbols, uint64_t stack_top, uint64_t skip_stack_offset)
 {
-	json->begin_object();
-	json->write_key_value_formatted("name", "%", name);
-	
-	json->write_key("type");
-	json->begin_string_value();
-	json_write_type_name(json, type);
-	json->end_string_value();
-	
-	auto mem_type = interp_get_memory_type(interp, data);
-	json->write_key_value_formatted("address", "0x%", data);
-	json->write_key_value_formatted("memory", "%", memory_type_string(mem_type));
-	
-	json->write_key("value");
-	json_write_value(json, interp, type, data);
-	
-	json->end_object();
-}
+	auto record = &trace->binary_record;
 
-static void json_write_symbols(Interpreter *interp, Json_Writer *json, Symbol_Table *symbols, uint64_t stack_top, uint64_t skip_stack_offset)
-{
 	for (auto &pair : symbols->map)
 	{
 		auto symbol = pair.value;
 
-		if ((symbol->flags & SYMBOL_BIT_TYPE))
-			continue;
-		
-		if (symbol->type->kind == CODE_TYPE_PROCEDURE && (symbol->flags & SYMBOL_BIT_CONSTANT))
-			continue;
-		
-		if (symbol->address.kind == Symbol_Address::CCALL)
-			continue;
-		
 		void *data = nullptr;
-		
-		if (symbol->address.kind == Symbol_Address::STACK)
-		{
-			auto offset = stack_top + symbol->address.offset;
-			if (offset > skip_stack_offset) continue;
-			data = interp->stack + offset;
-		}
-		else if (symbol->address.kind == Symbol_Address::GLOBAL)
-			data = interp->global + symbol->address.offset;
-		else if (symbol->address.kind == Symbol_Address::CODE)
-			data = symbol->address.code;
-		else if (symbol->address.kind == Symbol_Address::CCALL)
-			data = (void *)symbol->address.ccall;
-		else
-			Unreachable();
+		if (!symbol_data(interp, symbol, stack_top, skip_stack_offset, &data))
+			continue;
 
-		json_write_symbol(json, interp, symbol->name, symbol->type, data);
+		trace_write_varint(record, binary_symbol_id(trace, builder, symbol));
+		trace_write_raw(record, (uint64_t)data);
+		trace_write_raw(record, (uint8_t)interp_get_memory_type(interp, data));
+		binary_write_value(interp, record, symbol->type, data);
 	}
 }
 
-static void json_write_table_symbols(Interpreter *interp, Json_Writer *json, Symbol_Table *symbol_table, uint64_t stack_top, uint64_t skip_stack_offset)
+static void binary_write_frame(Interpreter *interp, Trace_State *trace, String_Builder *builder, String procedure_name, Symbol_Table *symbol_table, uint64_t stack_top, uint64_t skip_stack_offset)
 {
+	trace_write_varint(&trace->binary_record, binary_string_id(trace, builder, procedure_name));
+
 	for (auto symbols = symbol_table; symbols != interp->global_symbol_table; symbols = symbols->parent)
 	{
-		json_write_symbols(interp, json, symbols, stack_top, skip_stack_offset);
+		binary_write_symbols(interp, trace, builder, symbols, stack_top, skip_stack_offset);
 	}
-}
-
-static void json_write_procedure_symbols(Interpreter *interp, Json_Writer *json, String procedure_name, Symbol_Table *symbol_table, uint64_t stack_top, uint64_t skip_stack_offset)
-{
-	json->begin_object();
 
-	json->write_key_value_formatted("procedure", "%", procedure_name);
-	json->write_key("variables");
-	json->begin_array();
-	json_write_table_symbols(interp, json, symbol_table, stack_top, skip_stack_offset);
-	json->end_array();
-	
-	json->end_object();
+	trace_write_varint(&trace->binary_record, 0);
 }
 
-static void intercept(Interpreter *interp, Intercept_Kind intercept, Code_Node *node)
+// The step is written to a separate record so that the strings, types and symbols
+// it uses are defined in the stream before the step itself
+static void binary_write_step(Interpreter *interp, Interp_User_Context *context, Intercept_Kind intercept, Code_Node *node, uint64_t line_number, float exe_dt, float exe_time)
 {
-	auto context = (Interp_User_Context *)interp->user_context;
-
-	auto json = &context->json;
-
-	if (intercept == INTERCEPT_PROCEDURE_CALL || intercept == INTERCEPT_PROCEDURE_RETURN)
-	{
-		auto proc = (Code_Node_Block *)node;
-		auto procedure_type = interp->current_procedure;
+	auto trace   = &context->trace;
+	auto builder = context->json.builder;
+	auto record  = &trace->binary_record;
 
-		const char *intercept_type = (intercept == INTERCEPT_PROCEDURE_CALL) ? "call" : "return";
+	ResetBuilder(record);
 
-		json->begin_object();
+	trace_write_raw(record, TRACE_RECORD_STEP);
+	trace_write_raw(record, (uint8_t)intercept);
+	trace_write_varint(record, line_number);
+	trace_write_raw(record, exe_dt);
+	trace_write_raw(record, exe_time);
 
-		json->write_key_value_formatted("intercept", "procedure_%", intercept_type);
-		json->write_key_value("line_number", proc->procedure_source_row);
+	binary_write_symbols(interp, trace, builder, interp->global_symbol_table, 0, 0);
+	trace_write_varint(record, 0);
 
-		clock_t count = clock();
-		float ms = ((count - context->prev_count) * 1000.0f) / (float)CLOCKS_PER_SEC;
-		json->write_key_value("exe_dt", ms);
-		ms = ((count - context->first_count) * 1000.0f) / (float)CLOCKS_PER_SEC;
-		json->write_key_value("exe_time", ms);
-		context->prev_count = count;
+	if (intercept == INTERCEPT_STATEMENT)
+	{
+		auto statement = (Code_Node_Statement *)node;
 
-		json->write_key("globals");
-		json->begin_array();
-		json_write_symbols(interp, json, interp->global_symbol_table, 0, 0);
-		json->end_array();
+		for (int64_t index = 0; index < context->callstack.count - 1; ++index)
+		{
+			auto call = &context->callstack[index];
+			binary_write_frame(interp, trace, builder, call->procedure_name, call->symbols, call->stack_top, interp->stack_top);
+		}
 
-		json->write_key("callstack");
-		json->begin_array();
-		
-		// Don't print the last added calstack before we are already printing it
+		binary_write_frame(interp, trace, builder, interp->current_procedure->name, statement->symbol_table, interp->stack_top, UINT64_MAX);
+	}
+	else
+	{
 		for (int64_t index = 0; index < context->callstack.count; ++index)
 		{
 			auto call = &context->callstack[index];
-			json_write_procedure_symbols(interp, json, call->procedure_name, call->symbols, call->stack_top, interp->stack_top);
+			binary_write_frame(interp, trace, builder, call->procedure_name, call->symbols, call->stack_top, interp->stack_top);
 		}
+	}
 
-		json->end_array();
+	trace_write_varint(record, 0);
 
-		json->write_key("console_out");
-		json->begin_string_value();
-		json->append_builder(&context->console_out);
-		json->end_string_value();
+	trace_write_varint(record, context->console_out.written - trace->console_out_written);
+	int64_t skip = trace->console_out_written;
+	for (auto buk = &context->console_out.head; buk; buk = buk->next)
+	{
+		if (skip >= buk->written)
+		{
+			skip -= buk->written;
+			continue;
+		}
+		WriteBuffer(record, buk->data + skip, buk->written - skip);
+		skip = 0;
+	}
+	trace->console_out_written = context->console_out.written;
 
-		json->write_key_value_formatted("console_in", "%", context->console_in);
+	if (trace->console_in.data != context->console_in.data || trace->console_in.length != context->console_in.length)
+	{
+		trace_write_raw(record, (uint8_t)true);
+		trace_write_varint(record, context->console_in.length);
+		WriteBuffer(record, context->console_in.data, context->console_in.length);
+		trace->console_in = context->console_in;
+	}
+	else
+	{
+		trace_write_raw(record, (uint8_t)false);
+	}
 
-		json->end_object();
+	for (auto buk = &record->head; buk; buk = buk->next)
+	{
+		WriteBuffer(builder, buk->data, buk->written);
+	}
+}
+
+static void trace_step(Interpreter *interp, Intercept_Kind intercept, Code_Node *node)
+{
+	auto context = (Interp_User_Context *)interp->user_context;
+
+	auto json  = &context->json;
+	auto trace = &context->trace;
+
+	if (interp->halt)
+		return;
+
+	uint64_t step = trace->step_count;
+	trace->step_count += 1;
 
+	if (step > trace->step_last)
+	{
+		// The step that halted the execution is not part of the program's reported steps
+		trace->step_count = step;
+		interp->halt = true;
+		return;
+	}
+
+	if (step < trace->step_first)
+	{
 		if (intercept == INTERCEPT_PROCEDURE_CALL)
 		{
-			context->callstack.Add(make_procedure_call(procedure_type->name, interp->stack_top, &proc->symbols));
+			auto proc = (Code_Node_Block *)node;
+			context->callstack.Add(make_procedure_call(interp->current_procedure->name, interp->stack_top, &proc->symbols));
 		}
-		else
+		else if (intercept == INTERCEPT_PROCEDURE_RETURN)
 		{
-			Assert(intercept == INTERCEPT_PROCEDURE_RETURN);
 			context->callstack.RemoveLast();
 		}
+		return;
 	}
-	else if (intercept == INTERCEPT_STATEMENT)
+
+	clock_t count = clock();
+	float exe_dt = ((count - context->prev_count) * 1000.0f) / (float)CLOCKS_PER_SEC;
+	float exe_time = ((count - context->first_count) * 1000.0f) / (float)CLOCKS_PER_SEC;
+	context->prev_count = count;
+
+	if (trace->format == TRACE_FORMAT_BINARY)
 	{
-		auto statement = (Code_Node_Statement *)node;
+		uint64_t line_number;
+		if (intercept == INTERCEPT_STATEMENT)
+			line_number = ((Code_Node_Statement *)node)->source_row;
+		else
+			line_number = (uint64_t)((Code_Node_Block *)node)->procedure_source_row;
 
+		binary_write_step(interp, context, intercept, node, line_number, exe_dt, exe_time);
+	}
+	else
+	{
 		json->begin_object();
-		
-		json->write_key_value_formatted("intercept", "statement");
-		json->write_key_value("line_number", statement->source_row);
-
-		clock_t count = clock();
-		float ms = ((count - context->prev_count) * 1000.0f) / (float)CLOCKS_PER_SEC;
-		json->write_key_value("exe_dt", ms);
-		ms = ((count - context->first_count) * 1000.0f) / (float)CLOCKS_PER_SEC;
-		json->write_key_value("exe_time", ms);
-		context->prev_count = count;
 
-		json->write_key("globals");
-		json->begin_array();
-		json_write_symbols(interp, json, interp->global_symbol_table, 0, 0);
-		json->end_array();
+		if (intercept == INTERCEPT_PROCEDURE_CALL || intercept == INTERCEPT_PROCEDURE_RETURN)
+		{
+			auto proc = (Code_Node_Block *)node;
+			const char *intercept_type = (intercept == INTERCEPT_PROCEDURE_CALL) ? "call" : "return";
+			json->write_key_value_formatted("intercept", "procedure_%", intercept_type);
+			json->write_key_value("line_number", proc->procedure_source_row);
+		}
+		else if (intercept == INTERCEPT_STATEMENT)
+		{
+			auto statement = (Code_Node_Statement *)node;
+			json->write_key_value_formatted("intercept", "statement");
+			json->write_key_value("line_number", statement->source_row);
+		}
 
-		json->write_key("callstack");
-		json->begin_array();
+		json->write_key_value("exe_dt", exe_dt);
+		json->write_key_value("exe_time", exe_time);
 
-		// Don't print the last added calstack before we are already printing it
-		for (int64_t index = 0; index < context->callstack.count - 1; ++index)
+		if (trace->format == TRACE_FORMAT_DELTA)
 		{
-			auto call = &context->callstack[index];
-			json_write_procedure_symbols(interp, json, call->procedure_name, call->symbols, call->stack_top, interp->stack_top);
-		}
+			auto prev = &trace->snapshots[trace->current];
+			trace->current ^= 1;
+			auto next = &trace->snapshots[trace->current];
 
-		json_write_procedure_symbols(interp, json, interp->current_procedure->name, statement->symbol_table, interp->stack_top, UINT64_MAX);
+			trace_capture(interp, context, intercept, node, next);
 
-		json->end_array();
+			bool keyframe = ((step - trace->step_first) % TRACE_KEYFRAME_INTERVAL) == 0;
+			json->write_key_value("keyframe", keyframe);
 
-		json->write_key("console_out");
-		json->begin_string_value();
-		json->append_builder(&context->console_out);
-		json->end_string_value();
+			if (keyframe)
+				json_write_state(json, interp, context, intercept, node);
+			else
+				json_write_delta(json, interp, context, prev, next);
 
-		json->write_key_value_formatted("console_in", "%", context->console_in);
+			trace->console_out_written = context->console_out.written;
+			trace->console_in = context->console_in;
+		}
+		else
+		{
+			json_write_state(json, interp, context, intercept, node);
+		}
 
 		json->end_object();
 	}
+
+	if (intercept == INTERCEPT_PROCEDURE_CALL)
+	{
+		auto proc = (Code_Node_Block *)node;
+		context->callstack.Add(make_procedure_call(interp->current_procedure->name, interp->stack_top, &proc->symbols));
+	}
+	else if (intercept == INTERCEPT_PROCEDURE_RETURN)
+	{
+		context->callstack.RemoveLast();
+	}
+}
+
+static void intercept(Interpreter *interp, Intercept_Kind intercept, Code_Node *node)
+{
+	auto context = (Interp_User_Context *)interp->user_context;
+
+	double start = metrics_seconds();
+	trace_step(interp, intercept, node);
+	context->trace.intercept_seconds += metrics_seconds() - start;
 }
 
 void json_write_syntax_node(Json_Writer *json, Syntax_Node *root)
@@ -442,7 +1074,7 @@ void json_write_syntax_node(Json_Writer *json, Syntax_Node *root)
 		"null", "literal", "identifier", "unary_operator", "binary_operator",
 		"procedure_prototype_argument", "procedure_prototype", "type", "size_of", "type_of", "type_cast",
 		"return", "break", "continue", "assignment", "expression", "procedure_parameter", "procedure_call",
-		"subscript", "if", "for", "while", "do", "procedure_argument", "procedure", "declaration",
+		"subscript", "if", "for", "while", "do", "spawn", "procedure_argument", "procedure", "declaration",
 		"struct", "array_view", "static_array", "statement", "block", "global_scope"
 	};
 
@@ -668,6 +1300,12 @@ void json_write_syntax_node(Json_Writer *json, Syntax_Node *root)
 			json->write_key("condition"); json_write_syntax_node(json, node->condition);
 		} break;
 
+		case SYNTAX_NODE_SPAWN:
+		{
+			auto node = (Syntax_Node_Spawn *)root;
+			json->write_key("call"); json_write_syntax_node(json, node->call);
+		} break;
+
 		case SYNTAX_NODE_PROCEDURE_ARGUMENT:
 		{
 			auto node = (Syntax_Node_Procedure_Argument *)root;
@@ -839,10 +1477,7 @@ static void json_write_symbol_table(Json_Writer *json, const Array_View<Key_Valu
 
 		json->begin_object();
 		json->write_key_value_formatted("name", "%", sym.key);
-		json->write_key("type");
-		json->begin_string_value();
-		json_write_type_name(json, sym.value->type);
-		json->end_string_value();
+		json->write_key_value_formatted("type", "%", type_name(sym.value->type));
 
 		size_t line = sym.value->location.start_row;
 		json->write_key_value("line", line);
@@ -873,15 +1508,38 @@ static void json_write_symbol_table(Json_Writer *json, const Array_View<Key_Valu
 	json->end_array();
 }
 
-bool GenerateDebugCodeInfo(String code, String input, Memory_Arena *arena, String_Builder *builder)
+// The intercept time is the trace serialization, it is not part of the execution time
+static void run_stats_finish(Run_Stats *stats, double start, Interpreter *interp, Interp_User_Context *context, Heap_Allocator *heap)
+{
+	double elapsed = metrics_seconds() - start;
+
+	stats->trace           = context->trace.intercept_seconds;
+	stats->execute         = elapsed - stats->trace;
+	stats->steps           = context->trace.step_count;
+	stats->ticks           = interp->ticks;
+	stats->heap_allocated  = heap->total_allocated;
+	stats->budget_exceeded = interp->budget_exceeded;
+}
+
+bool GenerateDebugCodeInfo(String code, String input, Trace_Options options, Interp_Budget budget, Memory_Arena *arena, String_Builder *builder, Run_Stats *stats)
 {
 	Interp_User_Context context;
 	context.json.builder = builder;
 
+	auto format = options.format;
+
 	context.console_in = input;
+	context.trace.format = format;
+	context.trace.step_first = options.step_first;
+	context.trace.step_last = options.step_last;
 
 	context.json.begin_object();
 
+	context.json.write_key_value("trace_version", TRACE_FORMAT_VERSION);
+	context.json.write_key_value_formatted("trace_format", "%", trace_format_string(format));
+	if (format == TRACE_FORMAT_DELTA)
+		context.json.write_key_value("keyframe_interval", TRACE_KEYFRAME_INTERVAL);
+
 	auto prev_allocator = ThreadContext.allocator;
 	Defer{ ThreadContext.allocator = prev_allocator; };
 	
@@ -890,6 +1548,22 @@ bool GenerateDebugCodeInfo(String code, String input, Memory_Arena *arena, Strin
 	auto temp = BeginTemporaryMemory(arena);
 	Defer{ EndTemporaryMemory(&temp); };
 
+	Defer{
+		for (auto &snapshot : context.trace.snapshots)
+		{
+			Free(&snapshot.frames);
+			Free(&snapshot.variables);
+			Free(&snapshot.bytes);
+		}
+		FreeBuilder(&context.trace.scratch);
+		FreeBuilder(&context.trace.binary_record);
+		Free(&context.trace.binary_strings);
+		Free(&context.trace.binary_types);
+		Free(&context.trace.binary_symbols);
+	};
+
+	double start = metrics_seconds();
+
 	Parser parser;
 	parser_init(&parser, code, context.json.builder);
 
@@ -898,18 +1572,24 @@ bool GenerateDebugCodeInfo(String code, String input, Memory_Arena *arena, Strin
 
 	auto node = parse_global_scope(&parser);
 
+	stats->parse = metrics_seconds() - start;
+
 	if (parser.error_count) {
 		context.json.end_string_value();
 		context.json.end_object();
 		return false;
 	}
 
+	start = metrics_seconds();
+
 	auto resolver = code_type_resolver_create(context.json.builder);
 
 	include_basic(resolver);
 
 	auto exprs = code_type_resolve(resolver, node);
 
+	stats->resolve = metrics_seconds() - start;
+
 	if (code_type_resolver_error_count(resolver)) {
 		context.json.end_string_value();
 		context.json.end_object();
@@ -925,8 +1605,11 @@ bool GenerateDebugCodeInfo(String code, String input, Memory_Arena *arena, Strin
 	interp.user_context = &context;
 	interp.global_symbol_table = code_type_resolver_global_symbol_table(resolver);
 	interp.heap = &heap_allocator;
+	interp.budget = budget;
 	interp_init(&interp, resolver, stack_size, code_type_resolver_bss_allocated(resolver));
 
+	start = metrics_seconds();
+
 	interp_eval_globals(&interp, exprs);
 	auto main_proc = interp_find_main(&interp);
 
@@ -936,6 +1619,49 @@ bool GenerateDebugCodeInfo(String code, String input, Memory_Arena *arena, Strin
 		return false;
 	}
 
+	if (format == TRACE_FORMAT_BINARY)
+	{
+		// The compile errors are reported as json, the binary stream only starts
+		// once the program is ready to run
+		ResetBuilder(builder);
+		WriteBuffer(builder, (void *)TRACE_BINARY_MAGIC, sizeof(TRACE_BINARY_MAGIC));
+		trace_write_raw(builder, (uint8_t)TRACE_FORMAT_VERSION);
+
+		clock_t count = clock();
+		context.prev_count = count;
+		context.first_count = count;
+
+		interp_evaluate_procedure(&interp, main_proc);
+		run_stats_finish(stats, start, &interp, &context, &heap_allocator);
+
+		count = clock();
+		float ms = ((count - context.first_count) * 1000.0f) / (float)CLOCKS_PER_SEC;
+
+		String_Builder map;
+		Json_Writer map_json;
+		map_json.builder = &map;
+		json_write_symbol_table(&map_json, interp.global_symbol_table->map.storage);
+
+		trace_write_raw(builder, TRACE_RECORD_END);
+		trace_write_raw(builder, ms);
+		trace_write_varint(builder, code_type_resolver_bss_allocated(resolver));
+		trace_write_varint(builder, stack_size);
+		trace_write_varint(builder, heap_allocator.total_allocated);
+		trace_write_varint(builder, heap_allocator.total_freed);
+		trace_write_varint(builder, context.trace.step_count);
+		trace_write_raw(builder, (uint8_t)!interp.halt);
+		trace_write_raw(builder, (uint8_t)interp.budget_exceeded);
+		trace_write_varint(builder, map.written);
+		for (auto buk = &map.head; buk; buk = buk->next)
+		{
+			WriteBuffer(builder, buk->data, buk->written);
+		}
+
+		FreeBuilder(&map);
+
+		return true;
+	}
+
 	context.json.end_string_value();
 
 	context.json.write_key("runtime");
@@ -946,6 +1672,7 @@ bool GenerateDebugCodeInfo(String code, String input, Memory_Arena *arena, Strin
 	context.first_count = count;
 
 	interp_evaluate_procedure(&interp, main_proc);
+	run_stats_finish(stats, start, &interp, &context, &heap_allocator);
 
 	count = clock();
 	float ms = ((count - context.first_count) * 1000.0f) / (float)CLOCKS_PER_SEC;
@@ -955,9 +1682,12 @@ bool GenerateDebugCodeInfo(String code, String input, Memory_Arena *arena, Strin
 	context.json.write_key_value("exe_time", ms);
 	context.json.write_key_value("bss_size", code_type_resolver_bss_allocated(resolver));
 	context.json.write_key_value("stack_size", stack_size);
-	context.json.write_key_value("heap_allocated", heap_allocator.total_allocated);
-	context.json.write_key_value("heap_freed", heap_allocator.total_freed);
-	context.json.write_key_value("heap_leaked", heap_allocator.total_allocated - heap_allocator.total_freed);
+	context.json.write_key_value("heap_allocated", heap_allocator.total_allocated.load());
+	context.json.write_key_value("heap_freed", heap_allocator.total_freed.load());
+	context.json.write_key_value("heap_leaked", heap_allocator.total_allocated.load() - heap_allocator.total_freed.load());
+	context.json.write_key_value("step_count", context.trace.step_count);
+	context.json.write_key_value("complete", !interp.halt);
+	context.json.write_key_value("budget_exceeded", interp.budget_exceeded);
 
 	context.json.write_key("map");
 	json_write_symbol_table(&context.json, interp.global_symbol_table->map.storage);
@@ -969,3 +1699,106 @@ bool GenerateDebugCodeInfo(String code, String input, Memory_Arena *arena, Strin
 
 	return true;
 }
+
+bool RunCode(String code, String input, Interp_Budget budget, Memory_Arena *arena, String_Builder *builder, Run_Stats *stats)
+{
+	Interp_User_Context context;
+	context.json.builder = builder;
+	context.console_in = input;
+
+	context.json.begin_object();
+
+	auto prev_allocator = ThreadContext.allocator;
+	Defer{ ThreadContext.allocator = prev_allocator; };
+
+	ThreadContext.allocator = MemoryArenaAllocator(arena);
+
+	auto temp = BeginTemporaryMemory(arena);
+	Defer{ EndTemporaryMemory(&temp); };
+
+	double start = metrics_seconds();
+
+	Parser parser;
+	parser_init(&parser, code, context.json.builder);
+
+	context.json.write_key("error");
+	context.json.begin_string_value();
+
+	auto node = parse_global_scope(&parser);
+
+	stats->parse = metrics_seconds() - start;
+
+	if (parser.error_count) {
+		context.json.end_string_value();
+		context.json.end_object();
+		return false;
+	}
+
+	start = metrics_seconds();
+
+	auto resolver = code_type_resolver_create(context.json.builder);
+
+	include_basic(resolver);
+
+	auto exprs = code_type_resolve(resolver, node);
+
+	stats->resolve = metrics_seconds() - start;
+
+	if (code_type_resolver_error_count(resolver)) {
+		context.json.end_string_value();
+		context.json.end_object();
+		return false;
+	}
+
+	Heap_Allocator heap_allocator;
+
+	const uint32_t stack_size = 1024 * 1024 * 4;
+
+	// Without the intercept the interpreter runs the variant with no tracing hooks
+	Interpreter interp;
+	interp.user_context = &context;
+	interp.global_symbol_table = code_type_resolver_global_symbol_table(resolver);
+	interp.heap = &heap_allocator;
+	interp.budget = budget;
+	interp_init(&interp, resolver, stack_size, code_type_resolver_bss_allocated(resolver));
+
+	start = metrics_seconds();
+
+	interp_eval_globals(&interp, exprs);
+	auto main_proc = interp_find_main(&interp);
+
+	if (!main_proc) {
+		context.json.end_string_value();
+		context.json.end_object();
+		return false;
+	}
+
+	context.json.end_string_value();
+
+	clock_t count = clock();
+
+	interp_evaluate_procedure(&interp, main_proc);
+	run_stats_finish(stats, start, &interp, &context, &heap_allocator);
+
+	float ms = ((clock() - count) * 1000.0f) / (float)CLOCKS_PER_SEC;
+
+	context.json.write_key("console_out");
+	context.json.begin_string_value();
+	context.json.append_builder(&context.console_out);
+	context.json.end_string_value();
+
+	context.json.write_key_value("exe_time", ms);
+	context.json.write_key_value("bss_size", code_type_resolver_bss_allocated(resolver));
+	context.json.write_key_value("stack_size", stack_size);
+	context.json.write_key_value("heap_allocated", heap_allocator.total_allocated.load());
+	context.json.write_key_value("heap_freed", heap_allocator.total_freed.load());
+	context.json.write_key_value("heap_leaked", heap_allocator.total_allocated.load() - heap_allocator.total_freed.load());
+	context.json.write_key_value("complete", !interp.halt);
+	context.json.write_key_value("budget_exceeded", interp.budget_exceeded);
+
+	context.json.end_object();
+
+	FreeBuilder(&context.console_out);
+
+	return true;
+}
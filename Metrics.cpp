@@ -0,0 +1,148 @@
+#include "Metrics.h"
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+
+// Upper bounds of the histogram buckets in seconds, the last bucket is +Inf
+static const double MetricsBucketBounds[] = {
+	0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10
+};
+
+static const char *MetricsBucketLabels[] = {
+	"0.0001", "0.00025", "0.0005", "0.001", "0.0025", "0.005", "0.01", "0.025", "0.05", "0.1", "0.25", "0.5", "1", "2.5", "5", "10", "+Inf"
+};
+
+constexpr int MetricsBucketCount = ArrayCount(MetricsBucketBounds) + 1;
+static_assert(ArrayCount(MetricsBucketLabels) == MetricsBucketCount, "Missing bucket label");
+
+// Threads beyond the limit share the last shard, which is still correct since
+// the shards are only updated with atomic adds
+constexpr int METRICS_MAX_SHARDS = 64;
+
+static const char *MetricsPhaseNames[] = { "parse", "resolve", "execute", "trace", "send", "total" };
+static_assert(ArrayCount(MetricsPhaseNames) == METRICS_PHASE_COUNT, "Missing phase name");
+
+struct Metrics_Counter_Info
+{
+	const char *name;
+	const char *help;
+};
+
+static const Metrics_Counter_Info MetricsCounterInfos[] = {
+	{ "kano_requests_total{mode=\"trace\"}", nullptr },
+	{ "kano_requests_total{mode=\"run\"}", nullptr },
+	{ "kano_failed_requests_total", "Requests that failed to execute" },
+	{ "kano_budget_exceeded_total", "Executions stopped by the step or time budget" },
+	{ "kano_steps_total", "Traced statement steps" },
+	{ "kano_ticks_total", "Loop iterations and procedure calls executed" },
+	{ "kano_heap_bytes_total", "Bytes allocated on the heap by the programs" },
+	{ "kano_response_bytes_total", "Bytes of the responses, including the traces" },
+};
+static_assert(ArrayCount(MetricsCounterInfos) == METRICS_COUNTER_COUNT, "Missing counter name");
+
+struct Metrics_Histogram
+{
+	std::atomic<uint64_t> buckets[MetricsBucketCount];
+	std::atomic<uint64_t> sum_ns;
+};
+
+struct Metrics_Shard
+{
+	Metrics_Histogram     phases[METRICS_PHASE_COUNT];
+	std::atomic<uint64_t> counters[METRICS_COUNTER_COUNT];
+};
+
+static Metrics_Shard    MetricsShards[METRICS_MAX_SHARDS];
+static std::atomic<int> MetricsShardCount;
+
+static thread_local Metrics_Shard *MetricsThreadShard;
+
+static Metrics_Shard *metrics_shard()
+{
+	if (!MetricsThreadShard)
+	{
+		int index = MetricsShardCount.fetch_add(1, std::memory_order_relaxed);
+		MetricsThreadShard = &MetricsShards[Minimum(index, METRICS_MAX_SHARDS - 1)];
+	}
+	return MetricsThreadShard;
+}
+
+double metrics_seconds()
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+void metrics_observe(Metrics_Phase phase, double seconds)
+{
+	auto histogram = &metrics_shard()->phases[phase];
+
+	int bucket = 0;
+	while (bucket < MetricsBucketCount - 1 && seconds > MetricsBucketBounds[bucket])
+		bucket += 1;
+
+	histogram->buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	histogram->sum_ns.fetch_add((uint64_t)(seconds * 1e9), std::memory_order_relaxed);
+}
+
+void metrics_count(Metrics_Counter counter, uint64_t value)
+{
+	metrics_shard()->counters[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+void metrics_write(String_Builder *builder)
+{
+	int shard_count = Minimum(MetricsShardCount.load(std::memory_order_relaxed), METRICS_MAX_SHARDS);
+
+	Write(builder, "# HELP kano_phase_seconds Time spent in each phase of a request\n");
+	Write(builder, "# TYPE kano_phase_seconds histogram\n");
+
+	for (int phase = 0; phase < METRICS_PHASE_COUNT; ++phase)
+	{
+		uint64_t buckets[MetricsBucketCount] = {};
+		uint64_t sum_ns = 0;
+
+		for (int shard = 0; shard < shard_count; ++shard)
+		{
+			auto histogram = &MetricsShards[shard].phases[phase];
+			for (int bucket = 0; bucket < MetricsBucketCount; ++bucket)
+				buckets[bucket] += histogram->buckets[bucket].load(std::memory_order_relaxed);
+			sum_ns += histogram->sum_ns.load(std::memory_order_relaxed);
+		}
+
+		auto name = MetricsPhaseNames[phase];
+
+		uint64_t cumulative = 0;
+		for (int bucket = 0; bucket < MetricsBucketCount; ++bucket)
+		{
+			cumulative += buckets[bucket];
+			WriteFormatted(builder, "kano_phase_seconds_bucket{phase=\"%\",le=\"%\"} %\n", name, MetricsBucketLabels[bucket], cumulative);
+		}
+
+		// Written with the full precision, Write(double) only keeps two decimals
+		char sum[64];
+		snprintf(sum, sizeof(sum), "%.9f", (double)sum_ns / 1e9);
+
+		WriteFormatted(builder, "kano_phase_seconds_sum{phase=\"%\"} %\n", name, sum);
+		WriteFormatted(builder, "kano_phase_seconds_count{phase=\"%\"} %\n", name, cumulative);
+	}
+
+	Write(builder, "# HELP kano_requests_total Requests by mode\n");
+	Write(builder, "# TYPE kano_requests_total counter\n");
+
+	for (int counter = 0; counter < METRICS_COUNTER_COUNT; ++counter)
+	{
+		uint64_t value = 0;
+		for (int shard = 0; shard < shard_count; ++shard)
+			value += MetricsShards[shard].counters[counter].load(std::memory_order_relaxed);
+
+		auto info = &MetricsCounterInfos[counter];
+		if (info->help)
+		{
+			WriteFormatted(builder, "# HELP % %\n", info->name, info->help);
+			WriteFormatted(builder, "# TYPE % counter\n", info->name);
+		}
+		WriteFormatted(builder, "% %\n", info->name, value);
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "StringBuilder.h"
+
+//
+// Server metrics in the Prometheus text exposition format.
+// Every thread records into its own shard with relaxed atomics, the shards are
+// only summed when the metrics are written, so recording never takes a lock.
+//
+
+enum Metrics_Phase
+{
+	METRICS_PHASE_PARSE,
+	METRICS_PHASE_RESOLVE,
+	METRICS_PHASE_EXECUTE,
+	METRICS_PHASE_TRACE,
+	METRICS_PHASE_SEND,
+	METRICS_PHASE_TOTAL,
+
+	METRICS_PHASE_COUNT
+};
+
+enum Metrics_Counter
+{
+	METRICS_COUNTER_TRACE_REQUESTS,
+	METRICS_COUNTER_RUN_REQUESTS,
+	METRICS_COUNTER_FAILED_REQUESTS,
+	METRICS_COUNTER_BUDGET_EXCEEDED,
+	METRICS_COUNTER_STEPS,
+	METRICS_COUNTER_TICKS,
+	METRICS_COUNTER_HEAP_BYTES,
+	METRICS_COUNTER_RESPONSE_BYTES,
+
+	METRICS_COUNTER_COUNT
+};
+
+// Monotonic time in seconds
+double metrics_seconds();
+
+void metrics_observe(Metrics_Phase phase, double seconds);
+void metrics_count(Metrics_Counter counter, uint64_t value = 1);
+
+void metrics_write(String_Builder *builder);
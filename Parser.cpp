@@ -3,8 +3,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-static bool     ParseTableInitialize = false;
-
 static uint32_t UnaryOperatorPrecedence[_TOKEN_KIND_COUNT];
 static uint32_t BinaryOperatorPrecedence[_TOKEN_KIND_COUNT];
 
@@ -552,7 +550,18 @@ Syntax_Node_Expression *parse_root_expression(Parser *parser)
 
 Syntax_Node_Procedure_Prototype_Argument *parse_procedure_prototype_argument(Parser *parser)
 {
-	auto arg  = parser_new_syntax_node<Syntax_Node_Procedure_Prototype_Argument>(parser);
+	auto arg   = parser_new_syntax_node<Syntax_Node_Procedure_Prototype_Argument>(parser);
+	auto token = lexer_current_token(&parser->lexer);
+
+	// The 'ref' and 'in' of the arguments are part of the procedure type as well
+	if (token->kind == TOKEN_KIND_IDENTIFIER && (token->content == "ref" || token->content == "in"))
+	{
+		arg->flags = SYMBOL_BIT_REFERENCE;
+		if (token->content == "in")
+			arg->flags |= SYMBOL_BIT_READ_ONLY;
+		parser_accept_token(parser, TOKEN_KIND_IDENTIFIER);
+	}
+
 	arg->type = parse_type(parser);
 	parser_finish_syntax_node(parser, arg);
 	return arg;
@@ -611,7 +620,18 @@ Syntax_Node_Procedure_Argument *parse_procedure_argument(Parser *parser)
 	auto arg         = parser_new_syntax_node<Syntax_Node_Procedure_Argument>(parser);
 
 	auto token       = lexer_current_token(&parser->lexer);
-	arg->declaration = parse_declaration(parser);
+
+	// 'ref' and 'in' are only keywords in the place of 'var' of the arguments
+	uint32_t argument_flags = 0;
+	if (token->kind == TOKEN_KIND_IDENTIFIER && (token->content == "ref" || token->content == "in"))
+	{
+		argument_flags = SYMBOL_BIT_REFERENCE;
+		if (token->content == "in")
+			argument_flags |= SYMBOL_BIT_READ_ONLY;
+		parser_accept_token(parser, TOKEN_KIND_IDENTIFIER);
+	}
+
+	arg->declaration = parse_declaration(parser, argument_flags);
 
 	if (arg->declaration->flags & SYMBOL_BIT_CONSTANT)
 	{
@@ -741,6 +761,13 @@ Syntax_Node_Type *parse_type(Parser *parser)
 {
 	auto type = parser_new_syntax_node<Syntax_Node_Type>(parser);
 
+	bool soa = parser_accept_token(parser, TOKEN_KIND_SOA);
+	if (soa && !parser_peek_token(parser, TOKEN_KIND_OPEN_SQUARE_BRACKET))
+	{
+		auto token = lexer_current_token(&parser->lexer);
+		parser_error(parser, token, "Expected array type after #soa, got: %", token_kind_string(token->kind));
+	}
+
 	if (parser_accept_token(parser, TOKEN_KIND_BYTE))
 	{
 		type->id       = Syntax_Node_Type::BYTE;
@@ -824,6 +851,7 @@ Syntax_Node_Type *parse_type(Parser *parser)
 
 			auto node          = parser_new_syntax_node<Syntax_Node_Array_View>(parser);
 			node->location     = type->location;
+			node->soa          = soa;
 
 			node->element_type = parse_type(parser);
 
@@ -837,6 +865,7 @@ Syntax_Node_Type *parse_type(Parser *parser)
 
 			auto node        = parser_new_syntax_node<Syntax_Node_Static_Array>(parser);
 			node->location   = type->location;
+			node->soa        = soa;
 			node->expression = parse_root_expression(parser);
 			parser_expect_token(parser, TOKEN_KIND_CLOSE_SQUARE_BRACKET);
 
@@ -857,18 +886,22 @@ Syntax_Node_Type *parse_type(Parser *parser)
 	return type;
 }
 
-Syntax_Node_Declaration *parse_declaration(Parser *parser)
+Syntax_Node_Declaration *parse_declaration(Parser *parser, uint32_t argument_flags)
 {
-	uint32_t flags = 0;
-	if (parser_accept_token(parser, TOKEN_KIND_CONST))
-	{
-		flags |= SYMBOL_BIT_CONSTANT;
-	}
-	else if (!parser_accept_token(parser, TOKEN_KIND_VAR))
+	// The 'ref' and 'in' of the arguments are accepted by the caller
+	uint32_t flags = argument_flags;
+	if (!argument_flags)
 	{
-		auto token = lexer_current_token(&parser->lexer);
-		parser_error(parser, token, "Expected declaration 'var' or 'const'");
-		parser->parsing = false;
+		if (parser_accept_token(parser, TOKEN_KIND_CONST))
+		{
+			flags |= SYMBOL_BIT_CONSTANT;
+		}
+		else if (!parser_accept_token(parser, TOKEN_KIND_VAR))
+		{
+			auto token = lexer_current_token(&parser->lexer);
+			parser_error(parser, token, "Expected declaration 'var' or 'const'");
+			parser->parsing = false;
+		}
 	}
 
 	auto declaration   = parser_new_syntax_node<Syntax_Node_Declaration>(parser);
@@ -983,10 +1016,18 @@ Syntax_Node_Statement *parse_statement(Parser *parser)
 		statement->node = if_statement;
 	}
 
-	// for
-	else if (parser_accept_token(parser, TOKEN_KIND_FOR))
+	// for, parallel for
+	else if (parser_peek_token(parser, TOKEN_KIND_FOR) || parser_peek_token(parser, TOKEN_KIND_PARALLEL))
 	{
+		bool parallel = parser_accept_token(parser, TOKEN_KIND_PARALLEL);
+		if (!parallel)
+			parser_accept_token(parser, TOKEN_KIND_FOR);
+
 		auto for_statement            = parser_new_syntax_node<Syntax_Node_For>(parser);
+		for_statement->parallel       = parallel;
+
+		if (parallel)
+			parser_expect_token(parser, TOKEN_KIND_FOR);
 
 		for_statement->initialization = parse_statement(parser);
 
@@ -1046,6 +1087,19 @@ Syntax_Node_Statement *parse_statement(Parser *parser)
 		statement->node = do_statement;
 	}
 
+	// spawn
+	else if (parser_accept_token(parser, TOKEN_KIND_SPAWN))
+	{
+		auto spawn_statement  = parser_new_syntax_node<Syntax_Node_Spawn>(parser);
+
+		spawn_statement->call = parse_root_expression(parser);
+		parser_expect_token(parser, TOKEN_KIND_SEMICOLON);
+
+		parser_finish_syntax_node(parser, spawn_statement);
+
+		statement->node = spawn_statement;
+	}
+
 	// block
 	else if (parser_peek_token(parser, TOKEN_KIND_OPEN_CURLY_BRACKET))
 	{
@@ -1153,11 +1207,9 @@ void parser_init(Parser *parser, String content, String_Builder *error)
 
 	parser->parsing             = true;
 
-	if (!ParseTableInitialize)
-	{
-		parser_init_precedence();
-		ParseTableInitialize = true;
-	}
+	// Initialized once even when several threads parse at the same time
+	static const bool precedence_initialized = (parser_init_precedence(), true);
+	(void)precedence_initialized;
 
 	lexer_next(&parser->lexer);
 }
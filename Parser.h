@@ -22,7 +22,7 @@ Syntax_Node *             parse_expression(Parser *parser, uint32_t prec);
 
 Syntax_Node_Expression *  parse_root_expression(Parser *parser);
 Syntax_Node_Type *        parse_type(Parser *parser);
-Syntax_Node_Declaration * parse_declaration(Parser *parser);
+Syntax_Node_Declaration * parse_declaration(Parser *parser, uint32_t argument_flags = 0);
 Syntax_Node_Statement *   parse_statement(Parser *parser);
 Syntax_Node_Block *       parse_block(Parser *parser);
 Syntax_Node_Global_Scope *parse_global_scope(Parser *parser);
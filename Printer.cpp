@@ -94,7 +94,10 @@ void print_syntax(Syntax_Node *root, FILE *fp, int child_indent, const char *tit
 
 	case SYNTAX_NODE_PROCEDURE_PROTOTYPE_ARGUMENT: {
 		auto node = (Syntax_Node_Procedure_Prototype_Argument *)root;
-		fprintf(fp, "Argument-Type()\n");
+		if (node->flags & SYMBOL_BIT_REFERENCE)
+			fprintf(fp, "Argument-Type(%s)\n", (node->flags & SYMBOL_BIT_READ_ONLY) ? "in" : "ref");
+		else
+			fprintf(fp, "Argument-Type()\n");
 		print_syntax(node->type, fp, child_indent);
 	}
 	break;
@@ -215,7 +218,7 @@ void print_syntax(Syntax_Node *root, FILE *fp, int child_indent, const char *tit
 
 	case SYNTAX_NODE_FOR: {
 		auto node = (Syntax_Node_For *)root;
-		fprintf(fp, "For()\n");
+		fprintf(fp, node->parallel ? "Parallel-For()\n" : "For()\n");
 		print_syntax(node->initialization, fp, child_indent, "Initialization");
 		print_syntax(node->condition, fp, child_indent, "Condition");
 		print_syntax(node->increment, fp, child_indent, "Increment");
@@ -239,6 +242,13 @@ void print_syntax(Syntax_Node *root, FILE *fp, int child_indent, const char *tit
 	}
 	break;
 
+	case SYNTAX_NODE_SPAWN: {
+		auto node = (Syntax_Node_Spawn *)root;
+		fprintf(fp, "Spawn()\n");
+		print_syntax(node->call, fp, child_indent, "Call");
+	}
+	break;
+
 	case SYNTAX_NODE_PROCEDURE_ARGUMENT: {
 		auto node = (Syntax_Node_Procedure_Argument *)root;
 		fprintf(fp, "Arg()\n");
@@ -276,14 +286,14 @@ void print_syntax(Syntax_Node *root, FILE *fp, int child_indent, const char *tit
 
 	case SYNTAX_NODE_ARRAY_VIEW: {
 		auto node = (Syntax_Node_Array_View *)root;
-		fprintf(fp, "Array-View()\n");
+		fprintf(fp, "Array-View(%s)\n", node->soa ? "#soa" : "");
 		print_syntax(node->element_type, fp, child_indent, "Type");
 	}
 	break;
 
 	case SYNTAX_NODE_STATIC_ARRAY: {
 		auto node = (Syntax_Node_Static_Array *)root;
-		fprintf(fp, "Static-Array()\n");
+		fprintf(fp, "Static-Array(%s)\n", node->soa ? "#soa" : "");
 		print_syntax(node->expression, fp, child_indent, "Count");
 		print_syntax(node->element_type, fp, child_indent, "Type");
 	}
@@ -359,6 +369,8 @@ static void print_type(FILE *fp, Code_Type *type) {
 	case CODE_TYPE_INTEGER: fprintf(fp, "int"); return;
 	case CODE_TYPE_REAL: fprintf(fp, "float"); return;
 	case CODE_TYPE_BOOL: fprintf(fp, "bool"); return;
+	case CODE_TYPE_SIZED_INTEGER: fprintf(fp, "%s%u", ((Code_Type_Sized_Integer *)type)->is_signed ? "i" : "u", type->runtime_size * 8); return;
+	case CODE_TYPE_SIZED_REAL: fprintf(fp, "f32"); return;
 
 	case CODE_TYPE_POINTER: {
 		fprintf(fp, "*");
@@ -370,7 +382,13 @@ static void print_type(FILE *fp, Code_Type *type) {
 		auto proc = (Code_Type_Procedure *)type;
 		fprintf(fp, "proc (");
 		for (int64_t index = 0; index < proc->argument_count; ++index) {
-			print_type(fp, proc->arguments[index]);
+			auto flags = code_type_argument_flags(proc, index);
+			if (flags & SYMBOL_BIT_REFERENCE) {
+				fprintf(fp, (flags & SYMBOL_BIT_READ_ONLY) ? "in " : "ref ");
+				print_type(fp, ((Code_Type_Pointer *)proc->arguments[index])->base_type);
+			} else {
+				print_type(fp, proc->arguments[index]);
+			}
 			if (index < proc->argument_count - 1) fprintf(fp, ", ");
 		}
 		fprintf(fp, ")");
@@ -390,14 +408,14 @@ static void print_type(FILE *fp, Code_Type *type) {
 
 	case CODE_TYPE_ARRAY_VIEW: {
 		auto arr = (Code_Type_Array_View *)type;
-		fprintf(fp, "[] ");
+		fprintf(fp, arr->soa ? "#soa [] " : "[] ");
 		print_type(fp, arr->element_type);
 		return;
 	}
 
 	case CODE_TYPE_STATIC_ARRAY: {
 		auto arr = (Code_Type_Static_Array *)type;
-		fprintf(fp, "[%u] ", arr->element_count);
+		fprintf(fp, arr->soa ? "#soa [%u] " : "[%u] ", arr->element_count);
 		print_type(fp, arr->element_type);
 		return;
 	}
@@ -514,6 +532,26 @@ void print_code(Code_Node *root, FILE *fp, int child_indent, const char *title)
 	}
 	break;
 
+	case CODE_NODE_ARRAY_OPERATOR: {
+		auto node = (Code_Node_Array_Operator *)root;
+		fprintf(fp, "Array Operator(%s)", binary_operator_kind_string(node->op_kind).data);
+		print_code_type(root, child_indent, fp);
+		print_code(node->left, fp, child_indent);
+		print_code(node->right, fp, child_indent);
+	}
+	break;
+
+	case CODE_NODE_VECTOR: {
+		auto node = (Code_Node_Vector *)root;
+		const char *VectorIntrinsicNames[] = { "length", "normalize", "cross", "swizzle" };
+		fprintf(fp, "Vector(%s)", VectorIntrinsicNames[node->intrinsic]);
+		print_code_type(root, child_indent, fp);
+		print_code(node->arguments[0], fp, child_indent);
+		if (node->arguments[1])
+			print_code(node->arguments[1], fp, child_indent);
+	}
+	break;
+
 	case CODE_NODE_EXPRESSION: {
 		auto node = (Code_Node_Expression *)root;
 		fprintf(fp, "Expression()");
@@ -555,7 +593,10 @@ void print_code(Code_Node *root, FILE *fp, int child_indent, const char *title)
 
 	case CODE_NODE_SUBSCRIPT: {
 		auto node = (Code_Node_Subscript *)root;
-		fprintf(fp, "Subscript()");
+		if (node->soa)
+			fprintf(fp, "Subscript(#soa +0x%zx)", node->soa_offset);
+		else
+			fprintf(fp, "Subscript()");
 		print_code_type(root, child_indent, fp);
 		print_code(node->expression, fp, child_indent, "Expression");
 		print_code(node->subscript, fp, child_indent, "Subscript");
@@ -578,7 +619,7 @@ void print_code(Code_Node *root, FILE *fp, int child_indent, const char *title)
 
 	case CODE_NODE_FOR: {
 		auto node = (Code_Node_For *)root;
-		fprintf(fp, "For()");
+		fprintf(fp, node->parallel ? "Parallel-For()" : "For()");
 		print_code_type(root, child_indent, fp);
 		print_code(node->initialization, fp, child_indent, "Initialization");
 		print_code(node->condition, fp, child_indent, "Condition");
@@ -605,6 +646,14 @@ void print_code(Code_Node *root, FILE *fp, int child_indent, const char *title)
 	}
 	break;
 
+	case CODE_NODE_SPAWN: {
+		auto node = (Code_Node_Spawn *)root;
+		fprintf(fp, "Spawn()");
+		print_code_type(root, child_indent, fp);
+		print_code(node->call, fp, child_indent, "Call");
+	}
+	break;
+
 	case CODE_NODE_BLOCK: {
 		auto node = (Code_Node_Block *)root;
 		fprintf(fp, "Block()");
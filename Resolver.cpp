@@ -15,6 +15,8 @@ int Write(String_Builder *builder, Code_Type *type) {
 	case CODE_TYPE_INTEGER: return Write(builder, "int");
 	case CODE_TYPE_REAL: return Write(builder, "float");
 	case CODE_TYPE_BOOL: return Write(builder, "bool");
+	case CODE_TYPE_SIZED_INTEGER: return WriteFormatted(builder, "%%", ((Code_Type_Sized_Integer *)type)->is_signed ? "i" : "u", type->runtime_size * 8);
+	case CODE_TYPE_SIZED_REAL: return Write(builder, "f32");
 
 	case CODE_TYPE_POINTER: {
 		int count = Write(builder, "*");
@@ -25,7 +27,13 @@ int Write(String_Builder *builder, Code_Type *type) {
 		auto proc = (Code_Type_Procedure *)type;
 		int count = Write(builder, "proc (");
 		for (int64_t index = 0; index < proc->argument_count; ++index) {
-			count += Write(builder, proc->arguments[index]);
+			auto flags = code_type_argument_flags(proc, index);
+			if (flags & SYMBOL_BIT_REFERENCE) {
+				count += Write(builder, (flags & SYMBOL_BIT_READ_ONLY) ? "in " : "ref ");
+				count += Write(builder, ((Code_Type_Pointer *)proc->arguments[index])->base_type);
+			} else {
+				count += Write(builder, proc->arguments[index]);
+			}
 			if (index < proc->argument_count - 1) 
 				count += Write(builder, ", ");
 		}
@@ -46,13 +54,13 @@ int Write(String_Builder *builder, Code_Type *type) {
 
 	case CODE_TYPE_ARRAY_VIEW: {
 		auto arr = (Code_Type_Array_View *)type;
-		int count = Write(builder, "[] ");
+		int count = Write(builder, arr->soa ? "#soa [] " : "[] ");
 		return Write(builder, arr->element_type);
 	}
 
 	case CODE_TYPE_STATIC_ARRAY: {
 		auto arr = (Code_Type_Static_Array *)type;
-		int count = WriteFormatted(builder, "[%] ", arr->element_count);
+		int count = WriteFormatted(builder, arr->soa ? "#soa [%] " : "[%] ", arr->element_count);
 		return Write(builder, arr->element_type);
 	}
 	}
@@ -240,6 +248,8 @@ struct Code_Type_Resolver
 	
 	Array<Code_Type *>               return_stack;
 	uint64_t                         loop = 0;
+	uint64_t                         parallel_loop = 0;
+	Array<const Symbol_Address *>    parallel_fixed;
 	
 	Bucket_Array<Symbol, 64>         symbols_allocator;
 	Bucket_Array<Unary_Operator, 8>  unary_operators[_UNARY_OPERATOR_COUNT];
@@ -286,25 +296,27 @@ static Code_Node_Type_Cast *code_type_cast(Code_Node *node, Code_Type *to_type,
 
 			if (!cast_success && explicit_cast)
 			{
-				cast_success = (from_type == CODE_TYPE_REAL || from_type == CODE_TYPE_INTEGER);
+				cast_success = (from_type == CODE_TYPE_REAL || from_type == CODE_TYPE_INTEGER ||
+					from_type == CODE_TYPE_SIZED_INTEGER || from_type == CODE_TYPE_SIZED_REAL);
 			}
 		}
 		break;
 
 		case CODE_TYPE_INTEGER: {
 			auto from_type = node->type->kind;
-			cast_success   = (from_type == CODE_TYPE_BOOL || from_type == CODE_TYPE_CHARACTER);
+			cast_success   = (from_type == CODE_TYPE_BOOL || from_type == CODE_TYPE_CHARACTER || from_type == CODE_TYPE_SIZED_INTEGER);
 			
 			if (!cast_success && explicit_cast)
 			{
-				cast_success = (from_type == CODE_TYPE_REAL);
+				cast_success = (from_type == CODE_TYPE_REAL || from_type == CODE_TYPE_SIZED_REAL);
 			}
 		}
 		break;
 		
 		case CODE_TYPE_REAL: {
 			auto from_type = node->type->kind;
-			cast_success   = (from_type == CODE_TYPE_INTEGER || from_type == CODE_TYPE_CHARACTER);
+			cast_success   = (from_type == CODE_TYPE_INTEGER || from_type == CODE_TYPE_CHARACTER ||
+				from_type == CODE_TYPE_SIZED_INTEGER || from_type == CODE_TYPE_SIZED_REAL);
 			
 			if (!cast_success && explicit_cast)
 			{
@@ -315,7 +327,34 @@ static Code_Node_Type_Cast *code_type_cast(Code_Node *node, Code_Type *to_type,
 		
 		case CODE_TYPE_BOOL: {
 			auto from_type = node->type->kind;
-			cast_success   = (from_type == CODE_TYPE_CHARACTER || from_type == CODE_TYPE_INTEGER || from_type == CODE_TYPE_REAL);
+			cast_success   = (from_type == CODE_TYPE_CHARACTER || from_type == CODE_TYPE_INTEGER || from_type == CODE_TYPE_REAL ||
+				from_type == CODE_TYPE_SIZED_INTEGER || from_type == CODE_TYPE_SIZED_REAL);
+		}
+		break;
+
+		// Narrowing into the sized types is implicit like in C, only the conversions between
+		// integers and reals need to be explicit
+		case CODE_TYPE_SIZED_INTEGER: {
+			auto from_type = node->type->kind;
+			cast_success   = (from_type == CODE_TYPE_BOOL || from_type == CODE_TYPE_CHARACTER ||
+				from_type == CODE_TYPE_INTEGER || from_type == CODE_TYPE_SIZED_INTEGER);
+
+			if (!cast_success && explicit_cast)
+			{
+				cast_success = (from_type == CODE_TYPE_REAL || from_type == CODE_TYPE_SIZED_REAL);
+			}
+		}
+		break;
+
+		case CODE_TYPE_SIZED_REAL: {
+			auto from_type = node->type->kind;
+			cast_success   = (from_type == CODE_TYPE_CHARACTER || from_type == CODE_TYPE_INTEGER ||
+				from_type == CODE_TYPE_REAL || from_type == CODE_TYPE_SIZED_INTEGER);
+
+			if (!cast_success && explicit_cast)
+			{
+				cast_success = (from_type == CODE_TYPE_BOOL);
+			}
 		}
 		break;
 		
@@ -336,7 +375,7 @@ static Code_Node_Type_Cast *code_type_cast(Code_Node *node, Code_Type *to_type,
 			{
 				auto to_view  = (Code_Type_Array_View *)to_type;
 				auto from_arr = (Code_Type_Static_Array *)from_type;
-				cast_success  = code_type_are_same(to_view->element_type, from_arr->element_type);
+				cast_success  = to_view->soa == from_arr->soa && code_type_are_same(to_view->element_type, from_arr->element_type);
 			}
 		}
 		break;
@@ -424,6 +463,8 @@ static bool code_type_are_same(Code_Type *a, Code_Type *b, bool recurse_pointer_
 				{
 					if (!code_type_are_same(a_args[arg_index], b_args[arg_index], recurse_pointer_type))
 						return false;
+					if (code_type_argument_flags(a_proc, arg_index) != code_type_argument_flags(b_proc, arg_index))
+						return false;
 				}
 				
 				return true;
@@ -437,6 +478,26 @@ static bool code_type_are_same(Code_Type *a, Code_Type *b, bool recurse_pointer_
 				return a_struct->id == b_struct->id;
 			}
 			break;
+
+			case CODE_TYPE_SIZED_INTEGER: {
+				return ((Code_Type_Sized_Integer *)a)->is_signed == ((Code_Type_Sized_Integer *)b)->is_signed;
+			}
+			break;
+
+			case CODE_TYPE_SIZED_REAL: {
+				return true;
+			}
+			break;
+
+			case CODE_TYPE_ARRAY_VIEW: {
+				return ((Code_Type_Array_View *)a)->soa == ((Code_Type_Array_View *)b)->soa;
+			}
+			break;
+
+			case CODE_TYPE_STATIC_ARRAY: {
+				return ((Code_Type_Static_Array *)a)->soa == ((Code_Type_Static_Array *)b)->soa;
+			}
+			break;
 		}
 		return true;
 	}
@@ -445,7 +506,7 @@ static bool code_type_are_same(Code_Type *a, Code_Type *b, bool recurse_pointer_
 }
 
 static Code_Node_Literal *code_resolve_literal(Code_Type_Resolver *resolver, Symbol_Table *symbols, Syntax_Node_Literal *root);
-static Code_Node_Address *code_resolve_identifier(Code_Type_Resolver *resolver, Symbol_Table *symbols, Syntax_Node_Identifier *root);
+static Code_Node *code_resolve_identifier(Code_Type_Resolver *resolver, Symbol_Table *symbols, Syntax_Node_Identifier *root);
 static Code_Node *        code_resolve_expression(Code_Type_Resolver *resolver, Symbol_Table *symbols, Syntax_Node *root);
 static Code_Node_Unary_Operator *code_resolve_unary_operator(Code_Type_Resolver *resolver, Symbol_Table *symbols, Syntax_Node_Unary_Operator *root);
 static Code_Node *               code_resolve_binary_operator(Code_Type_Resolver *resolver, Symbol_Table *symbols, Syntax_Node_Binary_Operator *root);
@@ -455,6 +516,7 @@ static Code_Type *               code_resolve_type(Code_Type_Resolver *resolver,
 static Code_Node_Assignment *    code_resolve_declaration(Code_Type_Resolver *resolver, Symbol_Table *symbols, Syntax_Node_Declaration *root, Code_Type **out_type = nullptr);
 static Code_Node_Statement *     code_resolve_statement(Code_Type_Resolver *resolver, Symbol_Table *symbols, Syntax_Node_Statement *root);
 static Code_Node_Block *         code_resolve_block(Code_Type_Resolver *resolver, Symbol_Table *parent_symbols, int64_t procedure_source_row, Syntax_Node_Block *root);
+static void                      code_check_parallel_write(Code_Type_Resolver *resolver, Syntax_Node *root, Code_Node *destination);
 
 //
 //
@@ -527,11 +589,17 @@ static Code_Node_Literal *code_resolve_literal(Code_Type_Resolver *resolver, Sym
 	return node;
 }
 
-static Code_Node_Address *code_resolve_identifier(Code_Type_Resolver *resolver, Symbol_Table *symbols,
+static Code_Node *code_resolve_identifier(Code_Type_Resolver *resolver, Symbol_Table *symbols,
 	Syntax_Node_Identifier *root)
 {
 	auto symbol = symbol_table_find(symbols, root->name);
 	
+	if (symbol && (symbol->flags & SYMBOL_BIT_INTRINSIC))
+	{
+		report_error(resolver, root, "% can only be called", root->name);
+		return nullptr;
+	}
+
 	if (symbol)
 	{
 		auto address     = new Code_Node_Address;
@@ -543,6 +611,18 @@ static Code_Node_Address *code_resolve_identifier(Code_Type_Resolver *resolver,
 			address->flags |= SYMBOL_BIT_LVALUE;
 		
 		address->type = symbol->type;
+
+		// The arguments passed by reference hold the pointer to the value
+		if (symbol->flags & SYMBOL_BIT_REFERENCE)
+		{
+			auto node     = new Code_Node_Unary_Operator;
+			node->type    = ((Code_Type_Pointer *)symbol->type)->base_type;
+			node->child   = address;
+			node->op_kind = UNARY_OPERATOR_DEREFERENCE;
+			node->flags   = (symbol->flags & SYMBOL_BIT_READ_ONLY) ? SYMBOL_BIT_READ_ONLY : SYMBOL_BIT_LVALUE;
+			return node;
+		}
+
 		return address;
 	}
 
@@ -558,6 +638,10 @@ static Code_Node_Break *code_resolve_break(Code_Type_Resolver *resolver, Symbol_
 	{
 		report_error(resolver, root, "Invalid break statement, break statement are only allowed with loops(for, while, do)");
 	}
+	else if (resolver->loop == resolver->parallel_loop)
+	{
+		report_error(resolver, root, "Invalid break statement, the iterations of a parallel for are independent");
+	}
 	return node;
 }
 
@@ -574,6 +658,11 @@ static Code_Node_Continue *code_resolve_continue(Code_Type_Resolver *resolver, S
 static Code_Node_Return *code_resolve_return(Code_Type_Resolver *resolver, Symbol_Table *symbols, Syntax_Node_Return *root)
 {
 	auto node = new Code_Node_Return;
+
+	if (resolver->parallel_loop)
+	{
+		report_error(resolver, root, "Invalid return statement, the iterations of a parallel for are independent");
+	}
 	
 	if (root->expression)
 	{
@@ -622,9 +711,68 @@ static Code_Node_Return *code_resolve_return(Code_Type_Resolver *resolver, Symbo
 	return node;
 }
 
-static Code_Node_Procedure_Call *code_resolve_procedure_call(Code_Type_Resolver *resolver, Symbol_Table *symbols,
+static Code_Node *code_resolve_vector_intrinsic(Code_Type_Resolver *resolver, Symbol_Table *symbols,
+	Syntax_Node_Procedure_Call *root, const Symbol *symbol);
+
+// The address of the argument is passed for the parameters passed by reference,
+// the references and the dereferenced pointers pass on their pointer
+static void code_resolve_reference_argument(Code_Type_Resolver *resolver, Syntax_Node *param, Code_Type_Procedure *proc,
+	Code_Node_Expression *code_param, int64_t param_index)
+{
+	auto pointer_type = (Code_Type_Pointer *)proc->arguments[param_index];
+	auto read_only    = (proc->argument_flags[param_index] & SYMBOL_BIT_READ_ONLY) != 0;
+	auto child        = code_param->child;
+
+	if (!read_only)
+		code_check_parallel_write(resolver, param, child);
+
+	if (!read_only && (child->flags & SYMBOL_BIT_READ_ONLY))
+	{
+		report_error(resolver, param, "On procedure: '%', the 'in' arguments can not be passed to the 'ref' % parameter",
+			proc->name, param_index + 1);
+		return;
+	}
+
+	if (child->kind == CODE_NODE_UNARY_OPERATOR && ((Code_Node_Unary_Operator *)child)->op_kind == UNARY_OPERATOR_DEREFERENCE &&
+		(read_only || (child->flags & SYMBOL_BIT_LVALUE)))
+	{
+		code_param->child = ((Code_Node_Unary_Operator *)child)->child;
+	}
+	else if ((child->flags & SYMBOL_BIT_LVALUE) || (read_only && (child->flags & SYMBOL_BIT_READ_ONLY)))
+	{
+		auto pointer_to     = new Code_Node_Unary_Operator;
+		pointer_to->type    = pointer_type;
+		pointer_to->child   = child;
+		pointer_to->op_kind = UNARY_OPERATOR_POINTER_TO;
+		code_param->child   = pointer_to;
+	}
+	else
+	{
+		report_error(resolver, param, "On procedure: '%', expected l-value on % parameter, it is passed by reference",
+			proc->name, param_index + 1);
+	}
+
+	if (!code_type_are_same(pointer_type->base_type, code_param->type))
+	{
+		report_error(resolver, param, "On procedure: '%', expected type '%' but got '%' on % parameter",
+			proc->name, pointer_type->base_type, code_param->type, param_index + 1);
+	}
+
+	code_param->flags = code_param->child->flags;
+	code_param->type  = pointer_type;
+}
+
+static Code_Node *code_resolve_procedure_call(Code_Type_Resolver *resolver, Symbol_Table *symbols,
 	Syntax_Node_Procedure_Call *root)
 {
+	if (root->procedure->child->kind == SYNTAX_NODE_IDENTIFIER)
+	{
+		auto iden   = (Syntax_Node_Identifier *)root->procedure->child;
+		auto symbol = symbol_table_find(symbols, iden->name);
+		if (symbol && (symbol->flags & SYMBOL_BIT_INTRINSIC))
+			return code_resolve_vector_intrinsic(resolver, symbols, root, symbol);
+	}
+
 	auto procedure = code_resolve_root_expression(resolver, symbols, root->procedure);
 	
 	if (procedure->type->kind == CODE_TYPE_PROCEDURE)
@@ -660,7 +808,11 @@ static Code_Node_Procedure_Call *code_resolve_procedure_call(Code_Type_Resolver
 						"Type mismatch, expected argument of type % but got void", proc->arguments[param_index]);
 				}
 
-				if (!code_type_are_same(proc->arguments[param_index], code_param->type))
+				if (code_type_argument_flags(proc, param_index) & SYMBOL_BIT_REFERENCE)
+				{
+					code_resolve_reference_argument(resolver, param, proc, code_param, param_index);
+				}
+				else if (!code_type_are_same(proc->arguments[param_index], code_param->type))
 				{
 					auto cast = code_type_cast(code_param->child, proc->arguments[param_index]);
 					
@@ -698,51 +850,13 @@ static Code_Node_Procedure_Call *code_resolve_procedure_call(Code_Type_Resolver
 			auto stack_top = resolver->virtual_address[Symbol_Address::STACK];
 			node->stack_top = stack_top;
 
-			if (proc->return_type)
-			{
-				resolver->virtual_address[Symbol_Address::STACK] += proc->return_type->runtime_size;
-			}
-			
-			uint32_t param_index  = 0;
-			auto     param        = root->parameters;
-			for (; param_index < proc->argument_count - 1; param = param->next, ++param_index)
-			{
-				auto code_param = code_resolve_root_expression(resolver, symbols, param->expression);
-
-				if (!code_param->type)
-				{
-					report_error(resolver, param,
-						"Type mismatch, expected argument of type % but got void", proc->arguments[param_index]);
-				}
-				
-				if (!code_type_are_same(proc->arguments[param_index], code_param->type))
-				{
-					auto cast = code_type_cast(code_param->child, proc->arguments[param_index]);
-					
-					if (cast)
-					{
-						code_param->child = cast;
-						code_param->type = cast->type;
-					}
-					else
-					{
-						report_error(resolver, param, 
-							"Type mismatch, expected argument of type % but got %",
-							proc->arguments[param_index], code_param->type);
-					}
-				}
-
-				resolver->virtual_address[Symbol_Address::STACK] += proc->arguments[param_index]->runtime_size;
-				
-				node->parameters[param_index] = code_param;
-			}
+			auto variadic_param = root->parameters;
+			for (uint32_t index = 0; index < proc->argument_count - 1; ++index)
+				variadic_param = variadic_param->next;
 
-			resolver->virtual_address[Symbol_Address::STACK] = stack_top;
-			if (proc->return_type)
-			{
-				resolver->virtual_address[Symbol_Address::STACK] += proc->return_type->runtime_size;
-			}
-			
+			// The variadics are placed first, each after the pointer to its type, followed by the return
+			// value and the arguments. They are evaluated in order, so the calls in every variadic and
+			// argument are placed above the values before them.
 			Code_Node *child = nullptr;
 			
 			if (root->parameter_count >= proc->argument_count)
@@ -764,23 +878,27 @@ static Code_Node_Procedure_Call *code_resolve_procedure_call(Code_Type_Resolver
 				node->variadics      = new Code_Node_Expression *[va_arg_count];
 				
 				int64_t index       = 0;
-				for (; param; param = param->next, ++index)
+				for (auto param = variadic_param; param; param = param->next, ++index)
 				{
 					Assert(index < va_arg_count);
+
+					resolver->virtual_address[Symbol_Address::STACK] += sizeof(Code_Type *);
+
 					auto code_param        = code_resolve_root_expression(resolver, symbols, param->expression);
 
 					if (!code_param->type)
 					{
 						report_error(resolver, param,
-							"Type mismatch, expected argument of type % but got void", proc->arguments[param_index]);
+							"Type mismatch, expected argument of type % but got void", proc->arguments[proc->argument_count - 1]);
 					}
 
-					if (code_param->child->type->kind == CODE_TYPE_CHARACTER)
+					auto param_kind = code_param->child->type->kind;
+					if (param_kind == CODE_TYPE_CHARACTER || param_kind == CODE_TYPE_SIZED_INTEGER || param_kind == CODE_TYPE_SIZED_REAL)
 					{
-						auto int_type = symbol_table_find(&resolver->symbols, "int")->type;
-						auto cast = code_type_cast(code_param->child, int_type);
+						auto wide_type = symbol_table_find(&resolver->symbols, param_kind == CODE_TYPE_SIZED_REAL ? String("float") : String("int"))->type;
+						auto cast = code_type_cast(code_param->child, wide_type);
 						code_param->child = cast;
-						code_param->type  = int_type;
+						code_param->type  = wide_type;
 					}
 
 					resolver->virtual_address[Symbol_Address::STACK] += code_param->type->runtime_size;
@@ -796,6 +914,55 @@ static Code_Node_Procedure_Call *code_resolve_procedure_call(Code_Type_Resolver
 				child                        = null_ptr;
 			}
 
+			auto args_top = (uint64_t)resolver->virtual_address[Symbol_Address::STACK];
+			if (proc->return_type)
+			{
+				args_top = AlignPower2Up(args_top, (uint64_t)proc->return_type->alignment) + proc->return_type->runtime_size;
+			}
+			else if (proc->argument_count)
+			{
+				args_top = AlignPower2Up(args_top, (uint64_t)proc->arguments[0]->alignment);
+			}
+			resolver->virtual_address[Symbol_Address::STACK] = (uint32_t)args_top;
+			
+			uint32_t param_index  = 0;
+			auto     param        = root->parameters;
+			for (; param_index < proc->argument_count - 1; param = param->next, ++param_index)
+			{
+				auto code_param = code_resolve_root_expression(resolver, symbols, param->expression);
+
+				if (!code_param->type)
+				{
+					report_error(resolver, param,
+						"Type mismatch, expected argument of type % but got void", proc->arguments[param_index]);
+				}
+				
+				if (code_type_argument_flags(proc, param_index) & SYMBOL_BIT_REFERENCE)
+				{
+					code_resolve_reference_argument(resolver, param, proc, code_param, param_index);
+				}
+				else if (!code_type_are_same(proc->arguments[param_index], code_param->type))
+				{
+					auto cast = code_type_cast(code_param->child, proc->arguments[param_index]);
+					
+					if (cast)
+					{
+						code_param->child = cast;
+						code_param->type = cast->type;
+					}
+					else
+					{
+						report_error(resolver, param, 
+							"Type mismatch, expected argument of type % but got %",
+							proc->arguments[param_index], code_param->type);
+					}
+				}
+
+				resolver->virtual_address[Symbol_Address::STACK] += proc->arguments[param_index]->runtime_size;
+				
+				node->parameters[param_index] = code_param;
+			}
+
 			resolver->virtual_address[Symbol_Address::STACK] = stack_top;
 			
 			auto va_arg                                = new Code_Node_Expression;
@@ -824,6 +991,13 @@ static Code_Node_Address *code_resolve_subscript(Code_Type_Resolver *resolver, S
 	auto expression = code_resolve_root_expression(resolver, symbols, root->expression);
 	auto subscript  = code_resolve_root_expression(resolver, symbols, root->subscript);
 
+	if (subscript->type->kind == CODE_TYPE_SIZED_INTEGER)
+	{
+		auto cast = code_type_cast(subscript->child, symbol_table_find(&resolver->symbols, "int")->type);
+		subscript->child = cast;
+		subscript->type  = cast->type;
+	}
+
 	bool expr_type_is_string = false;
 
 	if (expression->type->kind == CODE_TYPE_STRUCT)
@@ -843,6 +1017,12 @@ static Code_Node_Address *code_resolve_subscript(Code_Type_Resolver *resolver, S
 			node->subscript  = subscript;
 			
 			node->flags      = expression->flags | SYMBOL_BIT_LVALUE;
+
+			// The elements of the views are not part of the read only view
+			if (expression->type->kind != CODE_TYPE_STATIC_ARRAY)
+				node->flags &= ~SYMBOL_BIT_READ_ONLY;
+			else if (expression->flags & SYMBOL_BIT_READ_ONLY)
+				node->flags &= ~SYMBOL_BIT_LVALUE;
 			
 			if (expression->type->kind == CODE_TYPE_ARRAY_VIEW)
 			{
@@ -864,6 +1044,16 @@ static Code_Node_Address *code_resolve_subscript(Code_Type_Resolver *resolver, S
 			address->type  = node->type;
 			address->flags = node->flags;
 			address->subscript = node;
+
+			bool soa = false;
+			if (expression->type->kind == CODE_TYPE_ARRAY_VIEW)
+				soa = ((Code_Type_Array_View *)expression->type)->soa;
+			else if (expression->type->kind == CODE_TYPE_STATIC_ARRAY)
+				soa = ((Code_Type_Static_Array *)expression->type)->soa;
+
+			// Cleared once a member of the element is addressed
+			if (soa)
+				address->flags |= SYMBOL_BIT_SOA_ELEMENT;
 			
 			return address;
 		}
@@ -909,6 +1099,22 @@ static Code_Node_Literal *code_resolve_size_of(Code_Type_Resolver *resolver, Sym
 	return node;
 }
 
+static void code_resolve_argument_flags(Code_Type_Resolver *resolver, Code_Type_Procedure *proc_type, Syntax_Node *arg, Syntax_Node_Type *arg_type, uint32_t flags, uint64_t arg_index)
+{
+	flags &= (SYMBOL_BIT_REFERENCE | SYMBOL_BIT_READ_ONLY);
+	if (!flags)
+		return;
+
+	if (arg_type->id == Syntax_Node_Type::VARIADIC_ARGUMENT)
+	{
+		report_error(resolver, arg, "Variadic argument can not be passed by reference");
+	}
+
+	if (!proc_type->argument_flags)
+		proc_type->argument_flags = new uint32_t[proc_type->argument_count]();
+	proc_type->argument_flags[arg_index] = flags;
+}
+
 static Code_Node_Block *code_resolve_procedure(Code_Type_Resolver *resolver, Syntax_Node_Procedure *proc, Code_Type_Procedure **type)
 {
 	auto proc_type = new Code_Type_Procedure;
@@ -943,6 +1149,8 @@ static Code_Node_Block *code_resolve_procedure(Code_Type_Resolver *resolver, Syn
 											   &proc_type->arguments[arg_index]);
 		Assert(assign == nullptr);
 
+		code_resolve_argument_flags(resolver, proc_type, arg->declaration, arg->declaration->type, arg->declaration->flags, arg_index);
+
 		auto decl_type = arg->declaration->type;
 		if (arg_index == last_index)
 		{
@@ -954,10 +1162,15 @@ static Code_Node_Block *code_resolve_procedure(Code_Type_Resolver *resolver, Syn
 		}
 	}
 
+	auto parallel_loop = resolver->parallel_loop;
+	resolver->parallel_loop = 0;
+
 	resolver->return_stack.Add(proc_type->return_type);
 	auto procedure_body = code_resolve_block(resolver, proc_symbols, (int64_t)proc->location.start_row, proc->body);
 	resolver->return_stack.count -= 1;
 
+	resolver->parallel_loop = parallel_loop;
+
 	resolver->virtual_address[Symbol_Address::STACK] = stack_top;
 	resolver->address_kind = address_kind;
 
@@ -1012,8 +1225,12 @@ static Code_Node *code_resolve_expression(Code_Type_Resolver *resolver, Symbol_T
 		case SYNTAX_NODE_PROCEDURE_CALL:
 			return code_resolve_procedure_call(resolver, symbols, (Syntax_Node_Procedure_Call *)root);
 			
-		case SYNTAX_NODE_SUBSCRIPT:
-			return code_resolve_subscript(resolver, symbols, (Syntax_Node_Subscript *)root);
+		case SYNTAX_NODE_SUBSCRIPT: {
+			auto node = code_resolve_subscript(resolver, symbols, (Syntax_Node_Subscript *)root);
+			if (node->flags & SYMBOL_BIT_SOA_ELEMENT)
+				report_error(resolver, root, "The elements of #soa arrays are only accessible through their members");
+			return node;
+		}
 			
 		case SYNTAX_NODE_SIZE_OF:
 			return code_resolve_size_of(resolver, symbols, (Syntax_Node_Size_Of *)root);
@@ -1072,8 +1289,17 @@ static Code_Node_Unary_Operator *code_resolve_unary_operator(Code_Type_Resolver
 		}
 	}
 	
+	// A pointer to an 'in' argument would let the value be changed through it
+	if (op_kind == UNARY_OPERATOR_POINTER_TO && (child->flags & SYMBOL_BIT_READ_ONLY))
+	{
+		report_error(resolver, root->child, "Address of read only value of type %, the 'in' arguments can not be changed", child->type);
+		return nullptr;
+	}
+
 	if (op_kind == UNARY_OPERATOR_POINTER_TO && (child->flags & SYMBOL_BIT_LVALUE))
 	{
+		code_check_parallel_write(resolver, root, child);
+
 		auto node       = new Code_Node_Unary_Operator;
 		auto type       = new Code_Type_Pointer;
 		
@@ -1095,39 +1321,325 @@ static Code_Node_Unary_Operator *code_resolve_unary_operator(Code_Type_Resolver
 		{
 			auto pointer_type = (Code_Type_Pointer *)child->type;
 
-			if (pointer_type->base_type->kind != CODE_TYPE_NULL) {
-				auto node = new Code_Node_Unary_Operator;
-				auto type = ((Code_Type_Pointer *)child->type)->base_type;
+			if (pointer_type->base_type->kind != CODE_TYPE_NULL) {
+				auto node = new Code_Node_Unary_Operator;
+				auto type = ((Code_Type_Pointer *)child->type)->base_type;
+
+				node->type = type;
+				node->child = child;
+				node->op_kind = op_kind;
+
+				if (child->flags & SYMBOL_BIT_CONST_EXPR)
+					node->flags |= SYMBOL_BIT_CONST_EXPR;
+				else
+					node->flags |= SYMBOL_BIT_LVALUE;
+
+				return node;
+			}
+
+			report_error(resolver, root->child, "Dereferencing of *void");
+		}
+		else
+		{
+			report_error(resolver, root->child, "Dereferencing of non pointer type %", child->type);
+		}
+	}
+	
+	report_error(resolver, root->child, "Invalid operation on type %", child->type);
+	
+	return nullptr;
+}
+
+// Nested static arrays are flattened, count is the number of int or float elements of the array
+// or of each element of the array view. Returns null when the elements are not numbers or narrow
+// numbers other than the 32 bit ones
+static Code_Type *code_array_element_type(Code_Type *type, uint64_t *count)
+{
+	*count = 1;
+
+	if (type->kind == CODE_TYPE_ARRAY_VIEW)
+		type = ((Code_Type_Array_View *)type)->element_type;
+
+	while (type->kind == CODE_TYPE_STATIC_ARRAY)
+	{
+		auto array = (Code_Type_Static_Array *)type;
+		*count *= array->element_count;
+		type = array->element_type;
+	}
+
+	if (type->kind == CODE_TYPE_INTEGER || type->kind == CODE_TYPE_REAL || type->kind == CODE_TYPE_SIZED_REAL)
+		return type;
+	if (type->kind == CODE_TYPE_SIZED_INTEGER && type->runtime_size == 4)
+		return type;
+	return nullptr;
+}
+
+static Code_Node *code_resolve_array_operator(Code_Type_Resolver *resolver, Syntax_Node_Binary_Operator *root,
+	Binary_Operator_Kind op_kind, Code_Node *left, Code_Node *right, uint64_t stack_top)
+{
+	if (!left->type || !right->type)
+		return nullptr;
+
+	bool compound = op_kind >= BINARY_OPERATOR_COMPOUND_ADDITION && op_kind <= BINARY_OPERATOR_COMPOUND_DIVISION;
+	if (!compound && !(op_kind >= BINARY_OPERATOR_ADDITION && op_kind <= BINARY_OPERATOR_DIVISION))
+		return nullptr;
+
+	bool left_array  = left->type->kind == CODE_TYPE_STATIC_ARRAY || left->type->kind == CODE_TYPE_ARRAY_VIEW;
+	bool right_array = right->type->kind == CODE_TYPE_STATIC_ARRAY || right->type->kind == CODE_TYPE_ARRAY_VIEW;
+
+	if (!left_array && !right_array)
+		return nullptr;
+
+	if (compound && !left_array)
+		return nullptr;
+
+	uint64_t   left_count    = 0;
+	uint64_t   right_count   = 0;
+	Code_Type *left_element  = left_array ? code_array_element_type(left->type, &left_count) : nullptr;
+	Code_Type *right_element = right_array ? code_array_element_type(right->type, &right_count) : nullptr;
+
+	if ((left_array && !left_element) || (right_array && !right_element))
+	{
+		report_error(resolver, root, "Array arithmetic is only supported on the arrays of int, float, i32, u32 and f32");
+		return nullptr;
+	}
+
+	auto element_type = left_element ? left_element : right_element;
+
+	if (left_array && right_array)
+	{
+		if (!code_type_are_same(left_element, right_element))
+		{
+			report_error(resolver, root, "Mismatch element types of the array operands, % and %", left_element, right_element);
+			return nullptr;
+		}
+
+		bool left_static  = left->type->kind == CODE_TYPE_STATIC_ARRAY;
+		bool right_static = right->type->kind == CODE_TYPE_STATIC_ARRAY;
+
+		if (left_static && right_static && left_count != right_count)
+		{
+			report_error(resolver, root, "Mismatch lengths of the array operands, % and %", left_count, right_count);
+			return nullptr;
+		}
+
+		if (!compound && !left_static && !right_static)
+		{
+			report_error(resolver, root, "The result of array views needs a destination, use the compound operator");
+			return nullptr;
+		}
+	}
+	else if (left_array)
+	{
+		if (!code_type_are_same(element_type, right->type))
+		{
+			auto cast = code_type_cast(right, element_type);
+			if (!cast)
+			{
+				report_error(resolver, root, "Expected scalar of type % for the array operand, but got %", element_type, right->type);
+				return nullptr;
+			}
+			right = cast;
+		}
+	}
+	else
+	{
+		if (right->type->kind == CODE_TYPE_ARRAY_VIEW)
+		{
+			report_error(resolver, root, "The result of array views needs a destination, use the compound operator");
+			return nullptr;
+		}
+
+		if (!code_type_are_same(element_type, left->type))
+		{
+			auto cast = code_type_cast(left, element_type);
+			if (!cast)
+			{
+				report_error(resolver, root, "Expected scalar of type % for the array operand, but got %", element_type, left->type);
+				return nullptr;
+			}
+			left = cast;
+		}
+	}
+
+	if (compound && left->kind == CODE_NODE_VECTOR && ((Code_Node_Vector *)left)->intrinsic == VECTOR_INTRINSIC_SWIZZLE)
+	{
+		report_error(resolver, root, "Compound operator on a swizzle is not supported, the swizzles are only assignable with =");
+		return nullptr;
+	}
+
+	if (compound && !(left->flags & SYMBOL_BIT_LVALUE))
+	{
+		report_error(resolver, root, "Expected l-value on the left of compound operator");
+		return nullptr;
+	}
+
+	if (compound)
+		code_check_parallel_write(resolver, root, left);
+
+	auto node          = new Code_Node_Array_Operator;
+	node->op_kind      = op_kind;
+	node->left         = left;
+	node->right        = right;
+	node->element_type = element_type;
+	node->flags        = left->flags & right->flags;
+
+	if (compound)
+	{
+		node->type = left->type;
+	}
+	else
+	{
+		node->type      = (left->type->kind == CODE_TYPE_STATIC_ARRAY) ? left->type : right->type;
+		node->stack_top = AlignPower2Up(stack_top, (uint64_t)node->type->alignment);
+		node->flags &= ~SYMBOL_BIT_LVALUE;
+	}
+
+	return node;
+}
+
+// The vector with the name of its count of elements, null when the array is not a vector
+static Code_Type_Static_Array *code_vector_type(Code_Type_Resolver *resolver, Code_Type *element_type, uint32_t count)
+{
+	if (count < 2 || count > 4)
+		return nullptr;
+
+	String FloatVectors[] = { "vec2", "vec3", "vec4" };
+	String IntVectors[]   = { "ivec2", "ivec3", "ivec4" };
+
+	if (element_type->kind == CODE_TYPE_REAL)
+		return (Code_Type_Static_Array *)symbol_table_find(&resolver->symbols, FloatVectors[count - 2])->type;
+	if (element_type->kind == CODE_TYPE_INTEGER)
+		return (Code_Type_Static_Array *)symbol_table_find(&resolver->symbols, IntVectors[count - 2])->type;
+	return nullptr;
+}
+
+// Components of the vectors are named by xyzw or rgba. A single component is addressed in place, the
+// others are gathered in a new vector. Returns null when the name is not a swizzle of the array
+static Code_Node *code_resolve_swizzle(Code_Type_Resolver *resolver, Code_Node *left, String name)
+{
+	auto array = (Code_Type_Static_Array *)left->type;
+	if (!code_vector_type(resolver, array->element_type, array->element_count) || name.length > 4)
+		return nullptr;
+
+	uint8_t swizzle[4];
+	for (int64_t index = 0; index < name.length; ++index)
+	{
+		int component = -1;
+		switch (name[index])
+		{
+			case 'x': case 'r': component = 0; break;
+			case 'y': case 'g': component = 1; break;
+			case 'z': case 'b': component = 2; break;
+			case 'w': case 'a': component = 3; break;
+		}
+
+		if (component < 0 || component >= (int)array->element_count)
+			return nullptr;
+		swizzle[index] = (uint8_t)component;
+	}
+
+	if (name.length == 1)
+	{
+		auto node    = new Code_Node_Offset;
+		node->type   = array->element_type;
+		node->offset = swizzle[0] * array->element_type->runtime_size;
+		return node;
+	}
+
+	auto node          = new Code_Node_Vector;
+	node->intrinsic    = VECTOR_INTRINSIC_SWIZZLE;
+	node->type         = code_vector_type(resolver, array->element_type, (uint32_t)name.length);
+	node->arguments[0] = left;
+	node->stack_top    = AlignPower2Up((uint64_t)resolver->virtual_address[Symbol_Address::STACK], (uint64_t)node->type->alignment);
+	memcpy(node->swizzle, swizzle, name.length);
+	return node;
+}
+
+static Code_Node *code_resolve_vector_intrinsic(Code_Type_Resolver *resolver, Symbol_Table *symbols,
+	Syntax_Node_Procedure_Call *root, const Symbol *symbol)
+{
+	auto proc = (Code_Type_Procedure *)symbol->type;
+
+	if (proc->argument_count != root->parameter_count)
+	{
+		report_error(resolver, root, "Mismatch number of arguments, expected % but % arguments",
+			proc->argument_count, root->parameter_count);
+		return nullptr;
+	}
+
+	auto node = new Code_Node_Vector;
 
-				node->type = type;
-				node->child = child;
-				node->op_kind = op_kind;
+	if (symbol->name == "length")
+		node->intrinsic = VECTOR_INTRINSIC_LENGTH;
+	else if (symbol->name == "normalize")
+		node->intrinsic = VECTOR_INTRINSIC_NORMALIZE;
+	else
+		node->intrinsic = VECTOR_INTRINSIC_CROSS;
 
-				if (child->flags & SYMBOL_BIT_CONST_EXPR)
-					node->flags |= SYMBOL_BIT_CONST_EXPR;
-				else
-					node->flags |= SYMBOL_BIT_LVALUE;
+	auto stack_top = resolver->virtual_address[Symbol_Address::STACK];
 
-				return node;
-			}
+	// Each argument is kept in the frame while the next one is computed
+	uint64_t top       = stack_top;
+	int64_t  arg_index = 0;
+	for (auto param = root->parameters; param; param = param->next, ++arg_index)
+	{
+		resolver->virtual_address[Symbol_Address::STACK] = (uint32_t)top;
+		auto arg = code_resolve_root_expression(resolver, symbols, param->expression);
 
-			report_error(resolver, root->child, "Dereferencing of *void");
+		auto array = (Code_Type_Static_Array *)arg->type;
+		if (!arg->type || arg->type->kind != CODE_TYPE_STATIC_ARRAY || !code_vector_type(resolver, array->element_type, array->element_count))
+		{
+			report_error(resolver, param, "On procedure: '%', expected a vector but got '%' on % parameter", proc->name, arg->type, arg_index + 1);
+			return nullptr;
 		}
-		else
+
+		if (node->intrinsic != VECTOR_INTRINSIC_CROSS && array->element_type->kind != CODE_TYPE_REAL)
 		{
-			report_error(resolver, root->child, "Dereferencing of non pointer type %", child->type);
+			report_error(resolver, param, "On procedure: '%', expected a vector of float but got '%'", proc->name, arg->type);
+			return nullptr;
+		}
+
+		if (node->intrinsic == VECTOR_INTRINSIC_CROSS && array->element_count != 3)
+		{
+			report_error(resolver, param, "On procedure: '%', expected a vector of 3 elements but got '%'", proc->name, arg->type);
+			return nullptr;
+		}
+
+		if (arg_index && !code_type_are_same(node->arguments[0]->type, arg->type))
+		{
+			report_error(resolver, param, "On procedure: '%', expected type '%' but got '%' on % parameter",
+				proc->name, node->arguments[0]->type, arg->type, arg_index + 1);
+			return nullptr;
 		}
+
+		node->arguments[arg_index] = arg->child;
+		top = AlignPower2Up(top, (uint64_t)arg->type->alignment) + arg->type->runtime_size;
 	}
-	
-	report_error(resolver, root->child, "Invalid operation on type %", child->type);
-	
-	return nullptr;
+
+	resolver->virtual_address[Symbol_Address::STACK] = stack_top;
+
+	if (node->intrinsic == VECTOR_INTRINSIC_LENGTH)
+	{
+		node->type = symbol_table_find(&resolver->symbols, "float")->type;
+	}
+	else
+	{
+		node->type      = node->arguments[0]->type;
+		node->stack_top = AlignPower2Up((uint64_t)stack_top, (uint64_t)node->type->alignment);
+	}
+
+	return node;
 }
 
 static Code_Node *code_resolve_binary_operator(Code_Type_Resolver *resolver, Symbol_Table *symbols,
 	Syntax_Node_Binary_Operator *root)
 {
-	auto left = code_resolve_expression(resolver, symbols, root->left);
+	Code_Node *left = nullptr;
+	if (root->op == TOKEN_KIND_PERIOD && root->left->kind == SYNTAX_NODE_SUBSCRIPT)
+		left = code_resolve_subscript(resolver, symbols, (Syntax_Node_Subscript *)root->left);
+	else
+		left = code_resolve_expression(resolver, symbols, root->left);
 	
 	if (root->op == TOKEN_KIND_PERIOD)
 	{
@@ -1146,6 +1658,11 @@ static Code_Node *code_resolve_binary_operator(Code_Type_Resolver *resolver, Sym
 			node->op_kind = UNARY_OPERATOR_DEREFERENCE;
 			node->flags   = left->flags;
 
+			// As with the dereference operator, the value behind a read only pointer is not read only,
+			// the 'in' only protects the pointer itself and no pointer to an 'in' value can be taken
+			if (left->flags & SYMBOL_BIT_READ_ONLY)
+				node->flags = SYMBOL_BIT_LVALUE;
+
 			left = node;
 		}
 
@@ -1171,6 +1688,19 @@ static Code_Node *code_resolve_binary_operator(Code_Type_Resolver *resolver, Sym
 
 				offset_type = member->type;
 				offset_value = member->address.offset;
+
+				// The members of #soa elements are addressed in the block of the member
+				if (left->flags & SYMBOL_BIT_SOA_ELEMENT)
+				{
+					Assert(left->kind == CODE_NODE_ADDRESS);
+
+					auto address = (Code_Node_Address *)left;
+					address->subscript->soa        = true;
+					address->subscript->soa_offset = offset_value;
+					address->type                  = offset_type;
+					address->flags                &= ~SYMBOL_BIT_SOA_ELEMENT;
+					return address;
+				}
 			}
 			else
 			{
@@ -1187,6 +1717,8 @@ static Code_Node *code_resolve_binary_operator(Code_Type_Resolver *resolver, Sym
 			else if (iden->name == "data")
 			{
 				auto type = (Code_Type_Array_View *)left->type;
+				if (type->soa)
+					report_error(resolver, root->left, "data is not the member of #soa array view");
 				offset_type = type->element_type;
 				offset_value = sizeof(int64_t);
 			}
@@ -1200,6 +1732,8 @@ static Code_Node *code_resolve_binary_operator(Code_Type_Resolver *resolver, Sym
 			if (iden->name == "data")
 			{
 				auto type = (Code_Type_Static_Array *)left->type;
+				if (type->soa)
+					report_error(resolver, root->left, "data is not the member of #soa static array");
 				auto ptr_type = new Code_Type_Pointer;
 				ptr_type->base_type = type->element_type;
 				offset_type = ptr_type;
@@ -1213,6 +1747,15 @@ static Code_Node *code_resolve_binary_operator(Code_Type_Resolver *resolver, Sym
 				node->data.integer.value = type->element_count;
 				return node;
 			}
+			else if (auto swizzle = code_resolve_swizzle(resolver, left, iden->name))
+			{
+				if (swizzle->kind == CODE_NODE_VECTOR)
+					return swizzle;
+
+				auto offset  = (Code_Node_Offset *)swizzle;
+				offset_type  = offset->type;
+				offset_value = offset->offset;
+			}
 			else
 			{
 				report_error(resolver, root->left, "% is not the member of static array", iden->name);
@@ -1241,9 +1784,31 @@ static Code_Node *code_resolve_binary_operator(Code_Type_Resolver *resolver, Sym
 	
 	else
 	{
+		// The array results of the left are kept in the frame while the right is computed
+		auto stack_top = resolver->virtual_address[Symbol_Address::STACK];
+		bool temporary = left->kind == CODE_NODE_PROCEDURE_CALL || left->kind == CODE_NODE_ARRAY_OPERATOR ||
+			left->kind == CODE_NODE_VECTOR;
+		if (temporary && left->type && left->type->kind == CODE_TYPE_STATIC_ARRAY)
+		{
+			auto left_top = AlignPower2Up((uint64_t)stack_top, (uint64_t)left->type->alignment) + left->type->runtime_size;
+			resolver->virtual_address[Symbol_Address::STACK] = (uint32_t)left_top;
+		}
+
 		auto  right     = code_resolve_expression(resolver, symbols, root->right);
+
+		resolver->virtual_address[Symbol_Address::STACK] = stack_top;
 		
 		auto  op_kind   = token_to_binary_operator(root->op);
+
+		if (op_kind >= BINARY_OPERATOR_COMPOUND_ADDITION && op_kind <= BINARY_OPERATOR_COMPOUND_BITWISE_OR &&
+			(left->flags & SYMBOL_BIT_READ_ONLY))
+		{
+			report_error(resolver, root, "Compound assignment on read only value of type %, the 'in' arguments can not be changed", left->type);
+			return nullptr;
+		}
+
+		if (auto array = code_resolve_array_operator(resolver, root, op_kind, left, right, stack_top))
+			return array;
 		
 		auto &operators = resolver->binary_operators[op_kind];
 		
@@ -1254,6 +1819,11 @@ static Code_Node *code_resolve_binary_operator(Code_Type_Resolver *resolver, Sym
 				const auto &op = bucket->data[index];
 				bool left_match  = false;
 				bool right_match = false;
+
+				// The casts are only kept for the operator that matches, a compound operator
+				// tried with a casted left would no longer see the lvalue
+				auto op_left  = left;
+				auto op_right = right;
 				
 				if (code_type_are_same(op.parameters[0], left->type, false))
 				{
@@ -1264,7 +1834,7 @@ static Code_Node *code_resolve_binary_operator(Code_Type_Resolver *resolver, Sym
 					auto cast_left = code_type_cast(left, op.parameters[0]);
 					if (cast_left)
 					{
-						left       = cast_left;
+						op_left    = cast_left;
 						left_match = true;
 					}
 				}
@@ -1278,13 +1848,19 @@ static Code_Node *code_resolve_binary_operator(Code_Type_Resolver *resolver, Sym
 					auto cast_right = code_type_cast(right, op.parameters[1]);
 					if (cast_right)
 					{
-						right       = cast_right;
+						op_right    = cast_right;
 						right_match = true;
 					}
 				}
 				
-				if (left_match && right_match && (!op.compound || (op.compound && (left->flags & SYMBOL_BIT_LVALUE))))
+				if (left_match && right_match && (!op.compound || (op.compound && (op_left->flags & SYMBOL_BIT_LVALUE))))
 				{
+					left  = op_left;
+					right = op_right;
+
+					if (op.compound)
+						code_check_parallel_write(resolver, root, left);
+
 					auto node     = new Code_Node_Binary_Operator;
 
 					auto type = op.output;
@@ -1327,11 +1903,31 @@ static Code_Node_Assignment *code_resolve_assignment(Code_Type_Resolver *resolve
 {
 	auto destination = code_resolve_root_expression(resolver, symbols, root->left);
 	auto value       = code_resolve_root_expression(resolver, symbols, root->right);
+
+	// The swizzles store each of their components into the vector they are taken from
+	auto target = destination->child;
+	if (target->kind == CODE_NODE_VECTOR && ((Code_Node_Vector *)target)->intrinsic == VECTOR_INTRINSIC_SWIZZLE)
+	{
+		auto swizzle = (Code_Node_Vector *)target;
+		auto count   = ((Code_Type_Static_Array *)swizzle->type)->element_count;
+		target       = swizzle->arguments[0];
+
+		for (uint32_t index = 1; index < count; ++index)
+		{
+			if (memchr(swizzle->swizzle, swizzle->swizzle[index], index))
+			{
+				report_error(resolver, root->left, "Swizzle is not assignable, it names a component more than once");
+				return nullptr;
+			}
+		}
+	}
 	
-	if (destination->flags & SYMBOL_BIT_LVALUE)
+	if (target->flags & SYMBOL_BIT_LVALUE)
 	{
-		if (!(destination->flags & SYMBOL_BIT_CONSTANT))
+		if (!(target->flags & SYMBOL_BIT_CONSTANT))
 		{
+			code_check_parallel_write(resolver, root->left, target);
+
 			bool match = false;
 			
 			if (code_type_are_same(destination->type, value->type))
@@ -1360,7 +1956,10 @@ static Code_Node_Assignment *code_resolve_assignment(Code_Type_Resolver *resolve
 		}
 	}
 
-	report_error(resolver, root, "Assignment on invalid types: %, %", destination->type, value->type);
+	if (target->flags & SYMBOL_BIT_READ_ONLY)
+		report_error(resolver, root, "Assignment on read only value of type %, the 'in' arguments can not be changed", destination->type);
+	else
+		report_error(resolver, root, "Assignment on invalid types: %, %", destination->type, value->type);
 
 	return nullptr;
 }
@@ -1440,6 +2039,15 @@ static Code_Type *code_resolve_type(Code_Type_Resolver *resolver, Symbol_Table *
 			for (auto arg = node->arguments_type; arg; arg = arg->next, ++arg_index)
 			{
 				type->arguments[arg_index] = code_resolve_type(resolver, symbols, arg->type);
+
+				// The arguments passed by reference are pointers, the same as in the procedure declarations
+				if (arg->flags & SYMBOL_BIT_REFERENCE)
+				{
+					auto pointer               = new Code_Type_Pointer;
+					pointer->base_type         = type->arguments[arg_index];
+					type->arguments[arg_index] = pointer;
+				}
+				code_resolve_argument_flags(resolver, type, arg, arg->type, arg->flags, arg_index);
 				
 				if (arg_index == last_index)
 				{
@@ -1466,7 +2074,8 @@ static Code_Type *code_resolve_type(Code_Type_Resolver *resolver, Symbol_Table *
 			auto symbol = symbol_table_find(symbols, node->name);
 			if (symbol && symbol->flags & SYMBOL_BIT_TYPE)
 			{
-				Assert(symbol->type->kind == CODE_TYPE_STRUCT && symbol->address.kind == Symbol_Address::CODE);
+				Assert((symbol->type->kind == CODE_TYPE_STRUCT && symbol->address.kind == Symbol_Address::CODE) ||
+					(symbol->flags & SYMBOL_BIT_COMPILER_DEF));
 				return symbol->type;
 			}
 			else
@@ -1488,6 +2097,11 @@ static Code_Type *code_resolve_type(Code_Type_Resolver *resolver, Symbol_Table *
 			
 			auto type          = new Code_Type_Array_View;
 			type->element_type = code_resolve_type(resolver, symbols, node->element_type);
+			type->soa          = node->soa;
+
+			if (type->soa && type->element_type->kind != CODE_TYPE_STRUCT)
+				report_error(resolver, node, "#soa is only supported on the arrays of structs, got %", type->element_type);
+
 			return type;
 		}
 		break;
@@ -1498,6 +2112,10 @@ static Code_Type *code_resolve_type(Code_Type_Resolver *resolver, Symbol_Table *
 			auto type          = new Code_Type_Static_Array;
 			type->element_type = code_resolve_type(resolver, symbols, node->element_type);
 			type->alignment    = type->element_type->alignment;
+			type->soa          = node->soa;
+
+			if (type->soa && type->element_type->kind != CODE_TYPE_STRUCT)
+				report_error(resolver, node, "#soa is only supported on the arrays of structs, got %", type->element_type);
 			
 			auto expr          = code_resolve_root_expression(resolver, symbols, node->expression);
 			
@@ -1545,6 +2163,13 @@ static Code_Node_Assignment *code_resolve_declaration(Code_Type_Resolver *resolv
 		symbol->flags    = root->flags;
 		symbol->location = root->location;
 		symbol_table_put(symbols, symbol);
+
+		if (root->flags & SYMBOL_BIT_REFERENCE)
+		{
+			auto pointer       = new Code_Type_Pointer;
+			pointer->base_type = symbol->type;
+			symbol->type       = pointer;
+		}
 		
 		if (root->flags & SYMBOL_BIT_CONSTANT && !root->initializer)
 		{
@@ -1591,6 +2216,8 @@ static Code_Node_Assignment *code_resolve_declaration(Code_Type_Resolver *resolv
 				auto assign = code_resolve_declaration(resolver, proc_symbols, arg->declaration,
 					&proc_type->arguments[arg_index]);
 				Assert(assign == nullptr);
+
+				code_resolve_argument_flags(resolver, proc_type, arg->declaration, arg->declaration->type, arg->declaration->flags, arg_index);
 				
 				auto decl_type = arg->declaration->type;
 				if (arg_index == last_index)
@@ -1607,9 +2234,14 @@ static Code_Node_Assignment *code_resolve_declaration(Code_Type_Resolver *resolv
 			if (!symbol->type)
 				symbol->type = proc_type;
 			
+			auto parallel_loop = resolver->parallel_loop;
+			resolver->parallel_loop = 0;
+
 			resolver->return_stack.Add(proc_type->return_type);
 			procedure_body = code_resolve_block(resolver, proc_symbols, (int64_t)proc->location.start_row, proc->body);
 			resolver->return_stack.count -= 1;
+
+			resolver->parallel_loop = parallel_loop;
 			
 			resolver->virtual_address[Symbol_Address::STACK] = stack_top;
 			resolver->address_kind                           = address_kind;
@@ -1806,7 +2438,8 @@ static Code_Node_Assignment *code_resolve_declaration(Code_Type_Resolver *resolv
 				
 				resolver->virtual_address[resolver->address_kind] = address_offset;
 
-				if (procedure_body)
+				// The variables are initialized by a procedure literal or by a procedure value
+				if (procedure_body || expression)
 				{
 					auto address                                      = new Code_Node_Address;
 					address->address                                  = &symbol->address;
@@ -1818,19 +2451,23 @@ static Code_Node_Assignment *code_resolve_declaration(Code_Type_Resolver *resolv
 					destination->child      = address;
 					destination->flags      = address->flags;
 					destination->type       = address->type;
+
+					auto value              = expression;
+					if (procedure_body)
+					{
+						auto sym_addr           = new Symbol_Address;
+						*sym_addr               = symbol_address_code(procedure_body);
 				
-					auto sym_addr           = new Symbol_Address;
-					*sym_addr               = symbol_address_code(procedure_body);
-				
-					auto source             = new Code_Node_Address;
-					source->type            = symbol->type;
-					source->flags           = symbol->flags;
-					source->address         = sym_addr;
+						auto source             = new Code_Node_Address;
+						source->type            = symbol->type;
+						source->flags           = symbol->flags;
+						source->address         = sym_addr;
 				
-					auto value              = new Code_Node_Expression;
-					value->flags            = source->flags;
-					value->type             = source->type;
-					value->child            = source;
+						value                   = new Code_Node_Expression;
+						value->flags            = source->flags;
+						value->type             = source->type;
+						value->child            = source;
+					}
 				
 					auto assignment         = new Code_Node_Assignment;
 					assignment->type        = destination->type;
@@ -1851,6 +2488,201 @@ static Code_Node_Assignment *code_resolve_declaration(Code_Type_Resolver *resolv
 	return nullptr;
 }
 
+static bool code_is_symbol_address(Code_Node *node, const Symbol_Address *address)
+{
+	if (node->kind != CODE_NODE_ADDRESS)
+		return false;
+	auto code = (Code_Node_Address *)node;
+	return code->address == address && !code->subscript && code->offset == 0;
+}
+
+// The variable whose storage is written through the destination, the elements of views and
+// the values behind pointers are not tracked
+static const Symbol_Address *code_written_symbol_address(Code_Node *node)
+{
+	while (true)
+	{
+		switch (node->kind)
+		{
+			case CODE_NODE_EXPRESSION: node = ((Code_Node_Expression *)node)->child; break;
+			case CODE_NODE_OFFSET: node = ((Code_Node_Offset *)node)->expression; break;
+
+			case CODE_NODE_ADDRESS: {
+				auto address = (Code_Node_Address *)node;
+				if (!address->subscript)
+					return address->address;
+				if (address->subscript->expression->type->kind != CODE_TYPE_STATIC_ARRAY)
+					return nullptr;
+				node = address->subscript->expression;
+			}
+			break;
+
+			default: return nullptr;
+		}
+	}
+}
+
+static void code_collect_symbol_addresses(Code_Node *node, Array<const Symbol_Address *> *addresses)
+{
+	switch (node->kind)
+	{
+		case CODE_NODE_EXPRESSION: code_collect_symbol_addresses(((Code_Node_Expression *)node)->child, addresses); break;
+		case CODE_NODE_OFFSET: code_collect_symbol_addresses(((Code_Node_Offset *)node)->expression, addresses); break;
+		case CODE_NODE_TYPE_CAST: code_collect_symbol_addresses(((Code_Node_Type_Cast *)node)->child, addresses); break;
+		case CODE_NODE_UNARY_OPERATOR: code_collect_symbol_addresses(((Code_Node_Unary_Operator *)node)->child, addresses); break;
+
+		case CODE_NODE_BINARY_OPERATOR: {
+			auto binary = (Code_Node_Binary_Operator *)node;
+			code_collect_symbol_addresses(binary->left, addresses);
+			code_collect_symbol_addresses(binary->right, addresses);
+		}
+		break;
+
+		case CODE_NODE_ADDRESS: {
+			auto address = (Code_Node_Address *)node;
+			if (address->subscript)
+			{
+				code_collect_symbol_addresses(address->subscript->expression, addresses);
+				code_collect_symbol_addresses(address->subscript->subscript, addresses);
+			}
+			else if (address->address)
+			{
+				addresses->Add(address->address);
+			}
+		}
+		break;
+
+		default: break;
+	}
+}
+
+// The range of a parallel for is computed before its iterations run, so the body must not
+// change the induction variable or the variables the bound is computed from
+static void code_check_parallel_write(Code_Type_Resolver *resolver, Syntax_Node *root, Code_Node *destination)
+{
+	if (!resolver->parallel_fixed.count)
+		return;
+
+	auto address = code_written_symbol_address(destination);
+	if (!address)
+		return;
+
+	for (auto fixed : resolver->parallel_fixed)
+	{
+		if (fixed == address)
+		{
+			report_error(resolver, root, "The induction variable and the variables of the bound of a parallel for can not be changed in its body");
+			return;
+		}
+	}
+}
+
+// The iterations of a parallel for are split across the workers, so the range must be known
+// before the loop starts: an integer induction variable declared by the loop, compared with
+// a bound and moved by a constant step. The bound is evaluated once.
+static void code_resolve_parallel_for(Code_Type_Resolver *resolver, Syntax_Node_For *root, Code_Node_For *node, uint64_t private_offset)
+{
+	node->parallel       = true;
+	node->private_offset = private_offset;
+
+	const Symbol_Address *induction = nullptr;
+
+	auto init = node->initialization;
+	if (init && init->node->kind == CODE_NODE_ASSIGNMENT)
+	{
+		auto destination = ((Code_Node_Assignment *)init->node)->destination->child;
+		if (destination->kind == CODE_NODE_ADDRESS && destination->type->kind == CODE_TYPE_INTEGER)
+		{
+			auto address = ((Code_Node_Address *)destination)->address;
+			if (address && address->kind == Symbol_Address::STACK && address->offset >= private_offset)
+				induction = address;
+		}
+	}
+
+	if (!induction)
+	{
+		report_error(resolver, root->initialization, "Parallel for expects the declaration of an integer induction variable");
+		return;
+	}
+
+	node->induction = induction->offset;
+
+	auto condition = node->condition->node;
+	if (condition->kind == CODE_NODE_EXPRESSION)
+		condition = ((Code_Node_Expression *)condition)->child;
+
+	if (condition->kind == CODE_NODE_BINARY_OPERATOR)
+	{
+		auto compare = (Code_Node_Binary_Operator *)condition;
+		switch (compare->op_kind)
+		{
+			case BINARY_OPERATOR_RELATIONAL_LESS:
+			case BINARY_OPERATOR_RELATIONAL_LESS_EQUAL:
+			case BINARY_OPERATOR_RELATIONAL_GREATER:
+			case BINARY_OPERATOR_RELATIONAL_GREATER_EQUAL:
+				if (code_is_symbol_address(compare->left, induction) && compare->right->type->kind == CODE_TYPE_INTEGER)
+				{
+					node->compare = compare->op_kind;
+					node->bound   = compare->right;
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	if (!node->bound)
+	{
+		report_error(resolver, root->condition, "Parallel for expects the induction variable to be compared with <, <=, > or >= to an integer bound");
+		return;
+	}
+
+	auto increment = node->increment->node;
+	if (increment->kind == CODE_NODE_EXPRESSION)
+		increment = ((Code_Node_Expression *)increment)->child;
+
+	if (increment->kind == CODE_NODE_BINARY_OPERATOR)
+	{
+		auto step = (Code_Node_Binary_Operator *)increment;
+		bool add  = step->op_kind == BINARY_OPERATOR_COMPOUND_ADDITION;
+		bool sub  = step->op_kind == BINARY_OPERATOR_COMPOUND_SUBTRACTION;
+
+		// Small literals are bytes implicitly casted to int
+		Code_Node_Expression expression;
+		expression.child = step->right;
+		expression.flags = step->right->flags;
+		expression.type  = step->right->type;
+
+		auto value = &expression;
+		if (step->right->kind == CODE_NODE_TYPE_CAST)
+			value = ((Code_Node_Type_Cast *)step->right)->child;
+
+		if ((add || sub) && code_is_symbol_address(step->left, induction) && (value->flags & SYMBOL_BIT_CONST_EXPR) &&
+			(value->type->kind == CODE_TYPE_INTEGER || value->type->kind == CODE_TYPE_CHARACTER))
+		{
+			auto amount = interp_evaluate_constant_expression(value);
+			node->step  = add ? amount : -amount;
+		}
+	}
+
+	if (!node->step)
+	{
+		report_error(resolver, root->increment, "Parallel for expects the induction variable to be moved by a non zero constant with += or -=");
+		return;
+	}
+
+	bool upwards = node->compare == BINARY_OPERATOR_RELATIONAL_LESS || node->compare == BINARY_OPERATOR_RELATIONAL_LESS_EQUAL;
+	if (upwards != (node->step > 0))
+	{
+		report_error(resolver, root->increment, "Parallel for step moves the induction variable away from the bound");
+		return;
+	}
+
+	resolver->parallel_fixed.Add(induction);
+	code_collect_symbol_addresses(node->bound, &resolver->parallel_fixed);
+}
+
 static Code_Node_Statement *code_resolve_statement(Code_Type_Resolver *resolver, Symbol_Table *symbols,
 	Syntax_Node_Statement *root)
 {
@@ -1912,6 +2744,11 @@ static Code_Node_Statement *code_resolve_statement(Code_Type_Resolver *resolver,
 			Defer { resolver->loop -= 1; };
 
 			auto for_node            = (Syntax_Node_For *)node;
+
+			auto parallel_loop       = resolver->parallel_loop;
+			if (for_node->parallel)
+				resolver->parallel_loop = resolver->loop;
+			Defer { resolver->parallel_loop = parallel_loop; };
 			
 			auto for_code            = new Code_Node_For;
 			for_code->symbols.parent = symbols;
@@ -1950,7 +2787,14 @@ static Code_Node_Statement *code_resolve_statement(Code_Type_Resolver *resolver,
 			
 			for_code->condition = cond_statement;
 			for_code->increment = incr_statement;
+
+			auto parallel_fixed = resolver->parallel_fixed.count;
+			if (for_node->parallel)
+				code_resolve_parallel_for(resolver, for_node, for_code, stack_top);
+
 			for_code->body      = code_resolve_statement(resolver, &for_code->symbols, for_node->body);
+
+			resolver->parallel_fixed.count = parallel_fixed;
 			
 			resolver->virtual_address[Symbol_Address::STACK] = stack_top;
 			
@@ -2051,6 +2895,32 @@ static Code_Node_Statement *code_resolve_statement(Code_Type_Resolver *resolver,
 		}
 		break;
 		
+		case SYNTAX_NODE_SPAWN: {
+			auto spawn_node = (Syntax_Node_Spawn *)node;
+			auto expression = code_resolve_root_expression(resolver, symbols, spawn_node->call);
+			
+			Code_Node_Statement *statement = new Code_Node_Statement;
+			statement->source_row          = node->location.start_row;
+			statement->node                = expression;
+			statement->symbol_table = symbols;
+			
+			if (expression->child->kind != CODE_NODE_PROCEDURE_CALL)
+			{
+				report_error(resolver, spawn_node->call, "Expected a procedure call after spawn");
+				return statement;
+			}
+			
+			auto call = (Code_Node_Procedure_Call *)expression->child;
+			if (call->variadic_count)
+				report_error(resolver, spawn_node->call, "Variadic procedures can not be spawned");
+			
+			auto spawn_code                = new Code_Node_Spawn;
+			spawn_code->call               = call;
+			statement->node                = spawn_code;
+			return statement;
+		}
+		break;
+		
 		case SYNTAX_NODE_DECLARATION: {
 			auto initialization = code_resolve_declaration(resolver, symbols, (Syntax_Node_Declaration *)node);
 			
@@ -2212,6 +3082,121 @@ Code_Type_Resolver *code_type_resolver_create(String_Builder *error)
 		sym->flags = SYMBOL_BIT_CONSTANT | SYMBOL_BIT_TYPE | SYMBOL_BIT_COMPILER_DEF;
 		symbol_table_put(&resolver->symbols, sym);
 	}
+
+	Code_Type *SizedTypes[6];
+
+	{
+		String   SizedNames[] = { "i8", "i16", "i32", "u16", "u32", "f32" };
+		uint32_t SizedSizes[] = { 1, 2, 4, 2, 4 };
+
+		for (uint32_t index = 0; index < ArrayCount(SizedTypes); ++index)
+		{
+			if (index < ArrayCount(SizedSizes))
+				SizedTypes[index] = new Code_Type_Sized_Integer(SizedSizes[index], index < 3);
+			else
+				SizedTypes[index] = new Code_Type_Sized_Real;
+
+			auto sym   = resolver->symbols_allocator.add();
+			sym->name  = SizedNames[index];
+			sym->type  = SizedTypes[index];
+			sym->flags = SYMBOL_BIT_CONSTANT | SYMBOL_BIT_TYPE | SYMBOL_BIT_COMPILER_DEF;
+			symbol_table_put(&resolver->symbols, sym);
+		}
+	}
+	
+	{
+		auto view_type          = new Code_Type_Array_View;
+		view_type->element_type = CompilerTypes[CODE_TYPE_INTEGER];
+		
+		auto sym                = resolver->symbols_allocator.add();
+		sym->name               = "[]int";
+		sym->type               = view_type;
+		sym->flags              = SYMBOL_BIT_CONSTANT | SYMBOL_BIT_TYPE | SYMBOL_BIT_COMPILER_DEF;
+		symbol_table_put(&resolver->symbols, sym);
+	}
+	
+	{
+		auto view_type          = new Code_Type_Array_View;
+		view_type->element_type = CompilerTypes[CODE_TYPE_REAL];
+		
+		auto sym                = resolver->symbols_allocator.add();
+		sym->name               = "[]float";
+		sym->type               = view_type;
+		sym->flags              = SYMBOL_BIT_CONSTANT | SYMBOL_BIT_TYPE | SYMBOL_BIT_COMPILER_DEF;
+		symbol_table_put(&resolver->symbols, sym);
+	}
+	
+	{
+		auto pointer_type       = new Code_Type_Pointer;
+		pointer_type->base_type = CompilerTypes[CODE_TYPE_INTEGER];
+		
+		auto sym                = resolver->symbols_allocator.add();
+		sym->name               = "*int";
+		sym->type               = pointer_type;
+		sym->flags              = SYMBOL_BIT_CONSTANT | SYMBOL_BIT_TYPE | SYMBOL_BIT_COMPILER_DEF;
+		symbol_table_put(&resolver->symbols, sym);
+	}
+	
+	{
+		auto proc_type            = new Code_Type_Procedure;
+		proc_type->argument_count = 1;
+		proc_type->arguments      = new Code_Type *[1];
+		proc_type->arguments[0]   = CompilerTypes[CODE_TYPE_POINTER];
+		
+		auto sym                  = resolver->symbols_allocator.add();
+		sym->name                 = "proc(*void)";
+		sym->type                 = proc_type;
+		sym->flags                = SYMBOL_BIT_CONSTANT | SYMBOL_BIT_TYPE | SYMBOL_BIT_COMPILER_DEF;
+		symbol_table_put(&resolver->symbols, sym);
+	}
+
+	{
+		String FloatVectors[] = { "vec2", "vec3", "vec4" };
+		String IntVectors[]   = { "ivec2", "ivec3", "ivec4" };
+
+		Code_Type_Kind ElementKinds[] = { CODE_TYPE_REAL, CODE_TYPE_INTEGER };
+
+		for (uint32_t index = 0; index < 3; ++index)
+		{
+			for (auto element_kind : ElementKinds)
+			{
+				auto element_type           = CompilerTypes[element_kind];
+
+				auto array_type             = new Code_Type_Static_Array;
+				array_type->element_type    = element_type;
+				array_type->element_count   = index + 2;
+				array_type->runtime_size    = element_type->runtime_size * array_type->element_count;
+				array_type->alignment       = element_type->alignment;
+
+				auto sym                    = resolver->symbols_allocator.add();
+				sym->name                   = element_kind == CODE_TYPE_REAL ? FloatVectors[index] : IntVectors[index];
+				sym->type                   = array_type;
+				sym->flags                  = SYMBOL_BIT_CONSTANT | SYMBOL_BIT_TYPE | SYMBOL_BIT_COMPILER_DEF;
+				symbol_table_put(&resolver->symbols, sym);
+			}
+		}
+	}
+
+	{
+		// Resolved from the types of their arguments, see code_resolve_vector_intrinsic
+		String  Intrinsics[]     = { "length", "normalize", "cross" };
+		int64_t ArgumentCounts[] = { 1, 1, 2 };
+
+		for (uint32_t index = 0; index < ArrayCount(Intrinsics); ++index)
+		{
+			auto proc_type            = new Code_Type_Procedure;
+			proc_type->name           = Intrinsics[index];
+			proc_type->argument_count = ArgumentCounts[index];
+
+			auto sym                  = resolver->symbols_allocator.add();
+			sym->name                 = Intrinsics[index];
+			sym->type                 = proc_type;
+			sym->address.kind         = Symbol_Address::CCALL;
+			sym->address.ccall        = nullptr;
+			sym->flags                = SYMBOL_BIT_CONSTANT | SYMBOL_BIT_COMPILER_DEF | SYMBOL_BIT_INTRINSIC;
+			symbol_table_put(&resolver->symbols, sym);
+		}
+	}
 	
 	{
 		auto block             = new Code_Node_Block;
@@ -2361,6 +3346,31 @@ Code_Type_Resolver *code_type_resolver_create(String_Builder *error)
 		resolver->binary_operators[BINARY_OPERATOR_COMPOUND_BITWISE_OR].add(binary_operator_int);
 	}
 	
+	// The plain operators promote the sized types through the int and float operators,
+	// the compound ones store the promoted result back in the sized type
+	for (auto sized_type : SizedTypes)
+	{
+		Binary_Operator binary_operator_sized;
+		binary_operator_sized.parameters[0] = sized_type;
+		binary_operator_sized.parameters[1] = sized_type;
+		binary_operator_sized.output        = sized_type;
+		binary_operator_sized.compound      = true;
+		resolver->binary_operators[BINARY_OPERATOR_COMPOUND_ADDITION].add(binary_operator_sized);
+		resolver->binary_operators[BINARY_OPERATOR_COMPOUND_SUBTRACTION].add(binary_operator_sized);
+		resolver->binary_operators[BINARY_OPERATOR_COMPOUND_MULTIPLICATION].add(binary_operator_sized);
+		resolver->binary_operators[BINARY_OPERATOR_COMPOUND_DIVISION].add(binary_operator_sized);
+
+		if (sized_type->kind == CODE_TYPE_SIZED_INTEGER)
+		{
+			resolver->binary_operators[BINARY_OPERATOR_COMPOUND_REMAINDER].add(binary_operator_sized);
+			resolver->binary_operators[BINARY_OPERATOR_COMPOUND_BITWISE_SHIFT_RIGHT].add(binary_operator_sized);
+			resolver->binary_operators[BINARY_OPERATOR_COMPOUND_BITWISE_SHIFT_LEFT].add(binary_operator_sized);
+			resolver->binary_operators[BINARY_OPERATOR_COMPOUND_BITWISE_AND].add(binary_operator_sized);
+			resolver->binary_operators[BINARY_OPERATOR_COMPOUND_BITWISE_XOR].add(binary_operator_sized);
+			resolver->binary_operators[BINARY_OPERATOR_COMPOUND_BITWISE_OR].add(binary_operator_sized);
+		}
+	}
+
 	{
 		Binary_Operator binary_operator_pointer;
 		binary_operator_pointer.parameters[0] = CompilerTypes[CODE_TYPE_POINTER];
@@ -2562,6 +3572,11 @@ void proc_builder_return(Procedure_Builder *builder, String name)
 	builder->return_type = type;
 }
 
+void proc_builder_thread_safe(Procedure_Builder *builder)
+{
+	builder->thread_safe = true;
+}
+
 void proc_builder_register(Procedure_Builder *builder, String name, CCall ccall)
 {
 	auto type = new Code_Type_Procedure;
@@ -2571,6 +3586,7 @@ void proc_builder_register(Procedure_Builder *builder, String name, CCall ccall)
 	memcpy(type->arguments, builder->arguments.data, sizeof(type->arguments[0]) * type->argument_count);
 	type->return_type = builder->return_type;
 	type->is_variadic = builder->is_variadic;
+	type->thread_safe = builder->thread_safe;
 	
 	bool added = code_type_resolver_register_ccall(builder->resolver, name, ccall, type);
 	Assert(added);
@@ -2578,6 +3594,7 @@ void proc_builder_register(Procedure_Builder *builder, String name, CCall ccall)
 	builder->arguments.Reset();
 	builder->return_type = nullptr;
 	builder->is_variadic = false;
+	builder->thread_safe = false;
 }
 
 void proc_builder_free(Procedure_Builder *builder)
@@ -35,6 +35,7 @@ struct Procedure_Builder
 	Array<Code_Type *> arguments;
 	Code_Type *return_type = nullptr;
 	bool is_variadic = false;
+	bool thread_safe = false;
 
 	Procedure_Builder(Code_Type_Resolver *type_resolver = nullptr)
 	{
@@ -45,5 +46,6 @@ struct Procedure_Builder
 void proc_builder_argument(Procedure_Builder *builder, String name);
 void proc_builder_variadic(Procedure_Builder *builder);
 void proc_builder_return(Procedure_Builder *builder, String name);
+void proc_builder_thread_safe(Procedure_Builder *builder);
 void proc_builder_register(Procedure_Builder *builder, String name, CCall ccall);
 void proc_builder_free(Procedure_Builder *builder);
@@ -2,62 +2,199 @@
 #include "Resolver.h"
 #include "Interp.h"
 #include "Kr/KrString.h"
+#include "Trace.h"
+#include "Metrics.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 
-bool GenerateDebugCodeInfo(String code, String input, Memory_Arena *arena, String_Builder *builder);
+// Limits for the execution of every request, the ##BUDGET header can only lower them.
+// The -budget flag changes the deadline.
+constexpr uint64_t SERVER_BUDGET_TICKS        = 100000000;
+constexpr uint64_t SERVER_BUDGET_MILLISECONDS = 10000;
+
+static uint64_t ServerBudgetMilliseconds = SERVER_BUDGET_MILLISECONDS;
 
 struct Request
 {
 	String code;
 	String input;
+	Trace_Options trace;
+	Interp_Budget budget;
+	bool run = false;
 };
 
 struct Code_Execution
 {
 	String code;
 	String input;
+	Trace_Options trace;
+	Interp_Budget budget;
+	bool run;
 	Memory_Arena *arena;
 	String_Builder *builder;
+	Run_Stats stats;
 	bool failed;
 };
 
+// Requests to the "/run" path only run the code and return its output, all the other
+// paths return the debug trace.
+// The request content may start with the header lines:
+// ##INPUT <input for the program>
+// ##TRACE <full|delta|binary>
+// ##STEPS <first> <last>
+// ##BUDGET <ticks> <milliseconds>
 static Request ParseRequest(String content)
 {
 	Request request;
-	String header = "##INPUT ";
-	if (StrStartsWith(content, header))
+	request.input = "";
+	request.code  = content;
+	request.budget.ticks        = SERVER_BUDGET_TICKS;
+	request.budget.milliseconds = ServerBudgetMilliseconds;
+
+	const String input_header = "##INPUT ";
+	const String trace_header = "##TRACE ";
+	const String steps_header = "##STEPS ";
+	const String budget_header = "##BUDGET ";
+
+	while (StrStartsWith(content, "##"))
 	{
+		String line = content;
+
 		auto pos = StrFindCharacter(content, '\n', 0);
 		if (pos >= 0)
 		{
 			content.data[pos] = 0;
-			request.input = SubStr(content, 0, pos);
-			request.input = StrRemovePrefix(request.input, header.length);
-			request.input = StrTrim(request.input);
-			request.code  = SubStr(content, pos + 1, content.length);
-			return request;
+			line    = SubStr(content, 0, pos);
+			content = StrRemovePrefix(content, pos + 1);
 		}
 		else
 		{
-			request.input = content;
-			request.input = StrRemovePrefix(request.input, header.length);
-			request.code  = "";
-			return request;
+			content = "";
+		}
+
+		if (StrStartsWith(line, input_header))
+		{
+			request.input = StrRemovePrefix(line, input_header.length);
+			request.input = StrTrim(request.input);
+		}
+		else if (StrStartsWith(line, trace_header))
+		{
+			auto format = StrTrim(StrRemovePrefix(line, trace_header.length));
+			if (StrMatch(format, "delta"))
+				request.trace.format = TRACE_FORMAT_DELTA;
+			else if (StrMatch(format, "binary"))
+				request.trace.format = TRACE_FORMAT_BINARY;
+			else
+				request.trace.format = TRACE_FORMAT_FULL;
+		}
+		else if (StrStartsWith(line, steps_header))
+		{
+			auto steps = StrTrim(StrRemovePrefix(line, steps_header.length));
+
+			char buffer[64];
+			if (steps.length < (ptrdiff_t)sizeof(buffer))
+			{
+				StrNullTerminated(buffer, steps);
+
+				char *end = nullptr;
+				uint64_t first = strtoull(buffer, &end, 10);
+				uint64_t last  = strtoull(end, &end, 10);
+
+				if (last >= first)
+				{
+					request.trace.step_first = first;
+					request.trace.step_last  = last;
+				}
+			}
+		}
+		else if (StrStartsWith(line, budget_header))
+		{
+			auto budget = StrTrim(StrRemovePrefix(line, budget_header.length));
+
+			char buffer[64];
+			if (budget.length < (ptrdiff_t)sizeof(buffer))
+			{
+				StrNullTerminated(buffer, budget);
+
+				char *end = nullptr;
+				uint64_t ticks        = strtoull(buffer, &end, 10);
+				uint64_t milliseconds = strtoull(end, &end, 10);
+
+				if (ticks)
+					request.budget.ticks = Minimum(ticks, SERVER_BUDGET_TICKS);
+				if (milliseconds)
+					request.budget.milliseconds = Minimum(milliseconds, ServerBudgetMilliseconds);
+			}
 		}
+
+		request.code = content;
 	}
 
-	request.input = "";
-	request.code  = content;
 	return request;
 }
 
+static bool IsRunTarget(String target)
+{
+	auto query = StrFindCharacter(target, '?', 0);
+	if (query >= 0)
+		target = SubStr(target, 0, query);
+	return StrMatch(target, "/run") || StrMatch(target, "/run/");
+}
+
+static bool IsMetricsTarget(String target)
+{
+	auto query = StrFindCharacter(target, '?', 0);
+	if (query >= 0)
+		target = SubStr(target, 0, query);
+	return StrMatch(target, "/metrics");
+}
+
+static void RecordExecutionMetrics(Code_Execution *exe)
+{
+	metrics_count(exe->run ? METRICS_COUNTER_RUN_REQUESTS : METRICS_COUNTER_TRACE_REQUESTS);
+	if (exe->failed)
+		metrics_count(METRICS_COUNTER_FAILED_REQUESTS);
+	if (exe->stats.budget_exceeded)
+		metrics_count(METRICS_COUNTER_BUDGET_EXCEEDED);
+
+	metrics_count(METRICS_COUNTER_STEPS, exe->stats.steps);
+	metrics_count(METRICS_COUNTER_TICKS, exe->stats.ticks);
+	metrics_count(METRICS_COUNTER_HEAP_BYTES, exe->stats.heap_allocated);
+	metrics_count(METRICS_COUNTER_RESPONSE_BYTES, exe->builder->written);
+
+	metrics_observe(METRICS_PHASE_PARSE, exe->stats.parse);
+	metrics_observe(METRICS_PHASE_RESOLVE, exe->stats.resolve);
+	metrics_observe(METRICS_PHASE_EXECUTE, exe->stats.execute);
+	if (!exe->run)
+		metrics_observe(METRICS_PHASE_TRACE, exe->stats.trace);
+}
+
+// Compile errors are reported as json even when the binary trace was requested
+static bool IsBinaryTrace(String_Builder *builder)
+{
+	return builder->head.written >= (int32_t)sizeof(TRACE_BINARY_MAGIC) &&
+		memcmp(builder->head.data, TRACE_BINARY_MAGIC, sizeof(TRACE_BINARY_MAGIC)) == 0;
+}
+
 #if PLATFORM_LINUX
 #define HTTPSERVER_IMPL
 #include "httpserver.h"
 
 #include <pthread.h>
+#include <poll.h>
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/prctl.h>
+
+#include <atomic>
+#include <new>
 
 static void parser_on_error(Parser *parser) {
 	Write(parser->error, "\"}");
@@ -76,7 +213,10 @@ void *ExecuteCodeThreadProc(void *param)
 
 	InitThreadContext(0);
 
-	exe->failed = !GenerateDebugCodeInfo(exe->code, exe->input, exe->arena, exe->builder);
+	if (exe->run)
+		exe->failed = !RunCode(exe->code, exe->input, exe->budget, exe->arena, exe->builder, &exe->stats);
+	else
+		exe->failed = !GenerateDebugCodeInfo(exe->code, exe->input, exe->trace, exe->budget, exe->arena, exe->builder, &exe->stats);
 	if (exe->failed)
 	{
 		return NULL;
@@ -85,62 +225,761 @@ void *ExecuteCodeThreadProc(void *param)
 	return NULL;
 }
 
-void handle_request(struct http_request_s *request)
-{
-	auto code = http_request_body(request);
+//
+// With the sandbox, the requests execute in worker processes so that a crash in the
+// interpreter only loses the request that caused it. A zygote process is forked at
+// startup, warmed up with a small program and then forks one worker per request.
+// The zygotes are forked by a fork server that is started before the server has any
+// thread, so a zygote never starts from the image of a process with other threads
+// that could be holding the locks of the allocators.
+// The requests and the responses are passed through the slots of a shared memory
+// mapping that every process inherits at the same address, so the worker builds the
+// response directly in the slot and the server sends it from there.
+//
 
-	String content;
-	content.data = (uint8_t *)code.buf;
-	content.length = code.len;
+constexpr int     SANDBOX_SLOT_COUNT    = 16;
+constexpr int64_t SANDBOX_REQUEST_SIZE  = MegaBytes(8) + 2;
+constexpr int64_t SANDBOX_RESPONSE_SIZE = MegaBytes(256);
 
-	Request req = ParseRequest(content);
+// Pages of the response area above this are released once the response is sent
+constexpr int64_t SANDBOX_RESPONSE_RESIDENT = MegaBytes(1);
 
-	printf("Requested code::\n%s\nInput::%s\n\n", req.code.data, req.input.data);
+// How long an execution waits for the zygote while it is being restarted
+constexpr int SANDBOX_RESTART_SECONDS = 5;
 
-	auto arena = MemoryArenaAllocate(MegaBytes(128));
+constexpr int SANDBOX_EXIT_RESPONSE_TOO_LARGE = 3;
+
+// Status of the slots whose zygote died before the worker finished
+constexpr int SANDBOX_STATUS_LOST = -1;
+
+static const char SandboxWarmupCode[] =
+	"const square := proc(var n: int) -> int { return n * n; }\n"
+	"const main := proc() { var sum := 0; for var i := 0; i < 16; i += 1 { sum += square(i); } }\n";
 
+struct Sandbox_Slot
+{
+	// Written by the server
+	Trace_Options trace;
+	Interp_Budget budget;
+	bool          run;
+	int64_t       code_length;
+	int64_t       input_length;
+
+	// Written by the worker
+	Run_Stats      stats;
+	bool           failed;
 	String_Builder builder;
+	int64_t        response_used;
+
+	// Written by the zygote once the worker exits, or by the server when the zygote died
+	std::atomic<bool> done;
+	int               status;
+
+	int      event;
+	uint8_t *request;
+	uint8_t *response;
+};
+
+// Sent by the fork server when a zygote started, with its control socket, or exited, and by the
+// supervisor when the fork server itself exited, the zygote is 0 then
+struct Sandbox_Zygote_Event
+{
+	pid_t fork_server;
+	pid_t zygote;
+	bool  started;
+	int   status;
+};
+
+struct Sandbox
+{
+	Sandbox_Slot *  slots;
+	pid_t           zygote;
+	int             control;
+	int             fork_server;
+	pid_t           fork_server_process;
+	bool            exited;
+	pthread_mutex_t lock;
+	pthread_cond_t  slot_freed;
+	pthread_cond_t  zygote_started;
+	int             free_slots[SANDBOX_SLOT_COUNT];
+	int             free_count;
+	bool            pending[SANDBOX_SLOT_COUNT];
+};
+
+static Sandbox *ServerSandbox;
+
+static void *SandboxResponseAllocatorProc(Allocation_Kind kind, void *mem, size_t prev_size, size_t new_size, void *context)
+{
+	auto slot = (Sandbox_Slot *)context;
+
+	// The slot is reset for every request, so nothing is freed
+	if (kind == ALLOCATION_KIND_FREE)
+		return nullptr;
+
+	new_size = AlignPower2Up(new_size, 16);
+	if (slot->response_used + (int64_t)new_size > SANDBOX_RESPONSE_SIZE)
+	{
+		fflush(stdout);
+		_exit(SANDBOX_EXIT_RESPONSE_TOO_LARGE);
+	}
+
+	auto ptr = slot->response + slot->response_used;
+	slot->response_used += new_size;
+
+	if (kind == ALLOCATION_KIND_REALLOC && mem)
+		memcpy(ptr, mem, Minimum(prev_size, new_size));
+
+	return ptr;
+}
+
+static void SandboxWorker(Sandbox_Slot *slot, Memory_Arena *arena)
+{
+	slot->response_used = 0;
+
+	new (&slot->builder) String_Builder;
+	slot->builder.allocator.proc    = SandboxResponseAllocatorProc;
+	slot->builder.allocator.context = slot;
 
 	Code_Execution exe;
 	exe.arena   = arena;
-	exe.builder = &builder;
-	exe.code    = req.code;
-	exe.input   = req.input;
+	exe.builder = &slot->builder;
+	exe.code    = String(slot->request, slot->code_length);
+	exe.input   = String(slot->request + slot->code_length + 1, slot->input_length);
+	exe.trace   = slot->trace;
+	exe.budget  = slot->budget;
+	exe.run     = slot->run;
 	exe.failed  = false;
 
+	// Compile errors exit the execution thread, not the worker
 	pthread_t thread;
-	int result = pthread_create(&thread, NULL, ExecuteCodeThreadProc, &exe);
-	if (result != 0)
+	if (pthread_create(&thread, NULL, ExecuteCodeThreadProc, &exe) != 0)
+		_exit(1);
+	pthread_join(thread, NULL);
+
+	slot->stats  = exe.stats;
+	slot->failed = exe.failed;
+
+	fflush(stdout);
+	_exit(0);
+}
+
+static void SandboxFinish(Sandbox_Slot *slot, int status)
+{
+	slot->status = status;
+	slot->done.store(true, std::memory_order_release);
+
+	uint64_t signal = 1;
+	write(slot->event, &signal, sizeof(signal));
+}
+
+// The zygote only keeps its control socket and the events of the slots
+static void SandboxCloseInheritedFiles(Sandbox *sandbox, int control)
+{
+	DIR *dir = opendir("/proc/self/fd");
+	if (!dir)
+		return;
+
+	Array<int> files;
+	while (auto entry = readdir(dir))
+	{
+		int fd = atoi(entry->d_name);
+		if (fd > 2 && fd != control && fd != dirfd(dir))
+			files.Add(fd);
+	}
+	closedir(dir);
+
+	for (auto fd : files)
+	{
+		bool keep = false;
+		for (int index = 0; index < SANDBOX_SLOT_COUNT; ++index)
+			keep = keep || sandbox->slots[index].event == fd;
+		if (!keep)
+			close(fd);
+	}
+
+	Free(&files);
+}
+
+static void SandboxZygote(Sandbox *sandbox, int control)
+{
+	InitThreadContext(0);
+
+	SandboxCloseInheritedFiles(sandbox, control);
+
+	auto arena = MemoryArenaAllocate(MegaBytes(128));
+
+	// The workers start with the code and the data that the first execution touched
 	{
-		MemoryArenaFree(arena);
+		Code_Execution exe;
+		String_Builder builder;
+		exe.arena   = arena;
+		exe.builder = &builder;
+		exe.code    = String((uint8_t *)SandboxWarmupCode, sizeof(SandboxWarmupCode) - 1);
+		exe.input   = "";
+		exe.budget  = Interp_Budget();
+		exe.run     = true;
+		exe.failed  = false;
+
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, ExecuteCodeThreadProc, &exe) == 0)
+			pthread_join(thread, NULL);
+
 		FreeBuilder(&builder);
-		return;
+
+		// The workers would copy every page the warm up wrote, fresh pages are cheaper
+		madvise((uint8_t *)arena + 4096, MegaBytes(128) - 4096, MADV_DONTNEED);
 	}
 
-	pthread_join(thread, NULL);
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &mask, NULL);
+	int child_exits = signalfd(-1, &mask, SFD_CLOEXEC);
+
+	pid_t workers[SANDBOX_SLOT_COUNT] = {};
+
+	while (true)
+	{
+		struct pollfd fds[2] = {};
+		fds[0].fd     = control;
+		fds[0].events = POLLIN;
+		fds[1].fd     = child_exits;
+		fds[1].events = POLLIN;
+
+		if (poll(fds, 2, -1) < 0)
+			continue;
+
+		if (fds[0].revents & POLLIN)
+		{
+			int index = -1;
+			auto received = recv(control, &index, sizeof(index), 0);
+
+			// The server exited
+			if (received <= 0)
+				_exit(0);
+
+			if (index >= 0 && index < SANDBOX_SLOT_COUNT)
+			{
+				auto slot = &sandbox->slots[index];
+
+				pid_t pid = fork();
+				if (pid == 0)
+				{
+					close(control);
+					close(child_exits);
+					sigprocmask(SIG_UNBLOCK, &mask, NULL);
+					SandboxWorker(slot, arena);
+				}
+
+				if (pid < 0)
+					SandboxFinish(slot, SANDBOX_STATUS_LOST);
+				else
+					workers[index] = pid;
+			}
+		}
+		else if (fds[0].revents & (POLLHUP | POLLERR))
+		{
+			_exit(0);
+		}
 
-	int length = 0;
-	for (auto buk = &builder.head; buk; buk = buk->next)
-		length += buk->written;
+		if (fds[1].revents & POLLIN)
+		{
+			struct signalfd_siginfo info;
+			read(child_exits, &info, sizeof(info));
+
+			int status = 0;
+			pid_t pid;
+			while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+			{
+				for (int index = 0; index < SANDBOX_SLOT_COUNT; ++index)
+				{
+					if (workers[index] == pid)
+					{
+						workers[index] = 0;
+						SandboxFinish(&sandbox->slots[index], status);
+						break;
+					}
+				}
+			}
+		}
+	}
+}
+
+static bool SandboxSendZygoteEvent(int fork_server, Sandbox_Zygote_Event event, int control)
+{
+	struct iovec data = {};
+	data.iov_base = &event;
+	data.iov_len  = sizeof(event);
+
+	union {
+		char           buffer[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} rights = {};
 
-	uint8_t *body = PushArray(arena, uint8_t, length + 1);
+	struct msghdr message = {};
+	message.msg_iov    = &data;
+	message.msg_iovlen = 1;
 
-	int written = 0;
-	for (auto buk = &builder.head; buk; buk = buk->next)
+	if (control >= 0)
 	{
-		memcpy(body + written, buk->data, buk->written);
-		written += buk->written;
+		message.msg_control    = rights.buffer;
+		message.msg_controllen = sizeof(rights.buffer);
+
+		auto header        = CMSG_FIRSTHDR(&message);
+		header->cmsg_level = SOL_SOCKET;
+		header->cmsg_type  = SCM_RIGHTS;
+		header->cmsg_len   = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(header), &control, sizeof(int));
 	}
-	Assert(written == length);
 
-	body[length] = 0;
+	return sendmsg(fork_server, &message, MSG_NOSIGNAL) == sizeof(event);
+}
+
+// Returns false once the fork server exited, the control socket is -1 unless the zygote started
+static bool SandboxReceiveZygoteEvent(int fork_server, Sandbox_Zygote_Event *event, int *control)
+{
+	struct iovec data = {};
+	data.iov_base = event;
+	data.iov_len  = sizeof(*event);
+
+	union {
+		char           buffer[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} rights = {};
+
+	struct msghdr message = {};
+	message.msg_iov        = &data;
+	message.msg_iovlen     = 1;
+	message.msg_control    = rights.buffer;
+	message.msg_controllen = sizeof(rights.buffer);
+
+	ssize_t received;
+	do
+	{
+		received = recvmsg(fork_server, &message, MSG_CMSG_CLOEXEC);
+	} while (received < 0 && errno == EINTR);
+
+	if (received != sizeof(*event))
+		return false;
 
-	const char *content_type = exe.failed ? "text/plain" : "application/json";
+	*control    = -1;
+	auto header = CMSG_FIRSTHDR(&message);
+	if (header && header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS)
+		memcpy(control, CMSG_DATA(header), sizeof(int));
 
-	if (exe.failed)
+	return true;
+}
+
+static pid_t SandboxSpawnZygote(Sandbox *sandbox, int *control)
+{
+	int channel[2];
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, channel) != 0)
+		return -1;
+
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		close(channel[0]);
+		close(sandbox->fork_server);
+		SandboxZygote(sandbox, channel[1]);
+	}
+
+	close(channel[1]);
+
+	if (pid < 0)
+		close(channel[0]);
+	else
+		*control = channel[0];
+
+	return pid;
+}
+
+// The fork server is single threaded, it starts a zygote, hands its control socket to the
+// server and starts the next one when it exits. It exits with the server.
+static void SandboxForkServer(Sandbox *sandbox)
+{
+	while (true)
+	{
+		int control = -1;
+		pid_t zygote = SandboxSpawnZygote(sandbox, &control);
+		if (zygote < 0)
+		{
+			sleep(1);
+			continue;
+		}
+
+		Sandbox_Zygote_Event event = {};
+		event.fork_server = getpid();
+		event.zygote      = zygote;
+		event.started     = true;
+
+		bool sent = SandboxSendZygoteEvent(sandbox->fork_server, event, control);
+		close(control);
+
+		// Without the server, the zygote exits once its control socket is closed
+		int status = 0;
+		while (waitpid(zygote, &status, 0) < 0 && errno == EINTR);
+
+		event.started = false;
+		event.status  = status;
+		if (!sent || !SandboxSendZygoteEvent(sandbox->fork_server, event, -1))
+			_exit(0);
+	}
+}
+
+// The supervisor restarts the fork server the same way the fork server restarts the zygotes. The
+// zygotes of a fork server that died are reparented to it, they are reaped once their control
+// socket is closed by the server.
+static void SandboxSupervisor(Sandbox *sandbox)
+{
+	prctl(PR_SET_CHILD_SUBREAPER, 1);
+
+	while (true)
+	{
+		pid_t fork_server = fork();
+		if (fork_server == 0)
+			SandboxForkServer(sandbox);
+
+		if (fork_server < 0)
+		{
+			sleep(1);
+			continue;
+		}
+
+		int   status = 0;
+		pid_t pid;
+		do
+		{
+			pid = waitpid(-1, &status, 0);
+		} while (pid != fork_server && (pid > 0 || errno == EINTR));
+
+		Sandbox_Zygote_Event event = {};
+		event.fork_server = fork_server;
+		event.status      = status;
+		if (!SandboxSendZygoteEvent(sandbox->fork_server, event, -1))
+			_exit(0);
+	}
+}
+
+// Fails the executions of a zygote that died and takes the control of the next one
+static void *SandboxMonitorThreadProc(void *param)
+{
+	auto sandbox = (Sandbox *)param;
+
+	while (true)
+	{
+		Sandbox_Zygote_Event event;
+		int control = -1;
+		bool received = SandboxReceiveZygoteEvent(sandbox->fork_server, &event, &control);
+
+		pthread_mutex_lock(&sandbox->lock);
+
+		if (received && event.started)
+		{
+			sandbox->zygote              = event.zygote;
+			sandbox->control             = control;
+			sandbox->fork_server_process = event.fork_server;
+			pthread_cond_broadcast(&sandbox->zygote_started);
+			pthread_mutex_unlock(&sandbox->lock);
+			continue;
+		}
+
+		for (int index = 0; index < SANDBOX_SLOT_COUNT; ++index)
+		{
+			auto slot = &sandbox->slots[index];
+			if (sandbox->pending[index] && !slot->done.load(std::memory_order_acquire))
+				SandboxFinish(slot, SANDBOX_STATUS_LOST);
+		}
+
+		if (sandbox->control >= 0)
+			close(sandbox->control);
+		sandbox->control = -1;
+
+		if (!received)
+		{
+			sandbox->exited = true;
+			pthread_cond_broadcast(&sandbox->zygote_started);
+		}
+
+		pthread_mutex_unlock(&sandbox->lock);
+
+		if (!received)
+		{
+			fprintf(stderr, "Sandbox supervisor exited, the sandboxed requests fail from now on\n");
+			break;
+		}
+
+		if (event.zygote)
+			fprintf(stderr, "Sandbox zygote exited (status %d), restarting it\n", event.status);
+		else
+			fprintf(stderr, "Sandbox fork server exited (status %d), restarting it\n", event.status);
+	}
+
+	return nullptr;
+}
+
+// Must be called before the server starts any thread
+static bool SandboxStart()
+{
+	size_t slots_size = AlignPower2Up(sizeof(Sandbox_Slot) * SANDBOX_SLOT_COUNT, 4096);
+	size_t size = slots_size + SANDBOX_SLOT_COUNT * (AlignPower2Up(SANDBOX_REQUEST_SIZE, 4096) + SANDBOX_RESPONSE_SIZE);
+
+	auto memory = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (memory == MAP_FAILED)
+		return false;
+
+	auto sandbox = new Sandbox;
+	sandbox->slots = (Sandbox_Slot *)memory;
+	sandbox->free_count = 0;
+	sandbox->exited     = false;
+	pthread_mutex_init(&sandbox->lock, NULL);
+	pthread_cond_init(&sandbox->slot_freed, NULL);
+	pthread_cond_init(&sandbox->zygote_started, NULL);
+
+	auto data = memory + slots_size;
+	for (int index = 0; index < SANDBOX_SLOT_COUNT; ++index)
+	{
+		auto slot = new (&sandbox->slots[index]) Sandbox_Slot;
+		slot->event    = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		slot->request  = data;
+		slot->response = data + AlignPower2Up(SANDBOX_REQUEST_SIZE, 4096);
+		data = slot->response + SANDBOX_RESPONSE_SIZE;
+
+		sandbox->pending[index] = false;
+		sandbox->free_slots[sandbox->free_count++] = index;
+	}
+
+	int channel[2];
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, channel) != 0)
+		return false;
+
+	pid_t pid = fork();
+	if (pid < 0)
+	{
+		close(channel[0]);
+		close(channel[1]);
+		return false;
+	}
+
+	if (pid == 0)
+	{
+		close(channel[0]);
+		sandbox->fork_server = channel[1];
+		SandboxSupervisor(sandbox);
+	}
+
+	close(channel[1]);
+	sandbox->fork_server = channel[0];
+
+	Sandbox_Zygote_Event event;
+	if (!SandboxReceiveZygoteEvent(sandbox->fork_server, &event, &sandbox->control) || !event.started || sandbox->control < 0)
+		return false;
+	sandbox->zygote              = event.zygote;
+	sandbox->fork_server_process = event.fork_server;
+
+	pthread_t monitor;
+	pthread_create(&monitor, NULL, SandboxMonitorThreadProc, sandbox);
+	pthread_detach(monitor);
+
+	ServerSandbox = sandbox;
+	return true;
+}
+
+// The process running the fork server, 0 without the sandbox
+pid_t SandboxForkServerProcess()
+{
+	auto sandbox = ServerSandbox;
+	if (!sandbox)
+		return 0;
+
+	pthread_mutex_lock(&sandbox->lock);
+	pid_t pid = sandbox->fork_server_process;
+	pthread_mutex_unlock(&sandbox->lock);
+	return pid;
+}
+
+static Sandbox_Slot *SandboxAcquireSlot(Sandbox *sandbox)
+{
+	pthread_mutex_lock(&sandbox->lock);
+	while (sandbox->free_count == 0)
+		pthread_cond_wait(&sandbox->slot_freed, &sandbox->lock);
+	int index = sandbox->free_slots[--sandbox->free_count];
+	pthread_mutex_unlock(&sandbox->lock);
+	return &sandbox->slots[index];
+}
+
+static void SandboxReleaseSlot(Sandbox *sandbox, Sandbox_Slot *slot)
+{
+	if (slot->response_used > SANDBOX_RESPONSE_RESIDENT)
+		madvise(slot->response + SANDBOX_RESPONSE_RESIDENT, slot->response_used - SANDBOX_RESPONSE_RESIDENT, MADV_REMOVE);
+
+	pthread_mutex_lock(&sandbox->lock);
+	sandbox->free_slots[sandbox->free_count++] = (int)(slot - sandbox->slots);
+	pthread_cond_signal(&sandbox->slot_freed);
+	pthread_mutex_unlock(&sandbox->lock);
+}
+
+// Executes the request in a worker and returns the exit status of the worker
+static int SandboxExecute(Sandbox *sandbox, Sandbox_Slot *slot, Code_Execution *exe)
+{
+	if (exe->code.length + exe->input.length + 2 > SANDBOX_REQUEST_SIZE)
+		return SANDBOX_STATUS_LOST;
+
+	int index = (int)(slot - sandbox->slots);
+
+	memcpy(slot->request, exe->code.data, exe->code.length);
+	slot->request[exe->code.length] = 0;
+	memcpy(slot->request + exe->code.length + 1, exe->input.data, exe->input.length);
+	slot->request[exe->code.length + 1 + exe->input.length] = 0;
+
+	slot->code_length   = exe->code.length;
+	slot->input_length  = exe->input.length;
+	slot->trace         = exe->trace;
+	slot->budget        = exe->budget;
+	slot->run           = exe->run;
+	slot->failed        = true;
+	slot->stats         = Run_Stats();
+	slot->response_used = 0;
+	slot->done.store(false, std::memory_order_relaxed);
+
+	// A late signal from a zygote that died must not complete this execution
+	uint64_t signal;
+	while (read(slot->event, &signal, sizeof(signal)) > 0);
+
+	pthread_mutex_lock(&sandbox->lock);
+
+	// The executions wait for the zygote while it is being restarted instead of failing
+	if (sandbox->control < 0)
+	{
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += SANDBOX_RESTART_SECONDS;
+		while (sandbox->control < 0 && !sandbox->exited)
+		{
+			if (pthread_cond_timedwait(&sandbox->zygote_started, &sandbox->lock, &deadline) == ETIMEDOUT)
+				break;
+		}
+	}
+
+	sandbox->pending[index] = true;
+	bool sent = send(sandbox->control, &index, sizeof(index), MSG_NOSIGNAL) == sizeof(index);
+	pthread_mutex_unlock(&sandbox->lock);
+
+	while (sent && !slot->done.load(std::memory_order_acquire))
+	{
+		struct pollfd fd = {};
+		fd.fd     = slot->event;
+		fd.events = POLLIN;
+		poll(&fd, 1, -1);
+		read(slot->event, &signal, sizeof(signal));
+	}
+
+	pthread_mutex_lock(&sandbox->lock);
+	sandbox->pending[index] = false;
+	pthread_mutex_unlock(&sandbox->lock);
+
+	return sent ? slot->status : SANDBOX_STATUS_LOST;
+}
+
+static void SandboxWriteFailure(String_Builder *builder, int status)
+{
+	if (status == SANDBOX_STATUS_LOST)
+		Write(builder, "Execution failed: the sandbox could not run the code");
+	else if (WIFSIGNALED(status))
+		WriteFormatted(builder, "Execution crashed: %", strsignal(WTERMSIG(status)));
+	else if (WIFEXITED(status) && WEXITSTATUS(status) == SANDBOX_EXIT_RESPONSE_TOO_LARGE)
+		WriteFormatted(builder, "Execution failed: the response is larger than % MB", SANDBOX_RESPONSE_SIZE / MegaBytes(1));
+	else
+		WriteFormatted(builder, "Execution failed: the worker exited with %", WIFEXITED(status) ? WEXITSTATUS(status) : status);
+}
+
+// Response content with the times to record once it is sent, requests that are
+// not executions (metrics) have no request_start
+struct Response_Body
+{
+	String_Builder builder;
+	double         request_start = 0;
+	double         send_start = 0;
+};
+
+static void http_body_release(void *data)
+{
+	auto body = (Response_Body *)data;
+
+	if (body->request_start)
+	{
+		double now = metrics_seconds();
+		metrics_observe(METRICS_PHASE_SEND, now - body->send_start);
+		metrics_observe(METRICS_PHASE_TOTAL, now - body->request_start);
+	}
+
+	FreeBuilder(&body->builder);
+	delete body;
+}
+
+// Sends the buckets of the builder directly from their storage using scatter-gather
+// writes. The response takes the ownership of the body and frees it once the
+// write completes, so the body must be heap allocated and not used after this call.
+static void http_response_body_builder(struct http_response_s *response, Response_Body *body)
+{
+	Array<struct iovec> iov;
+
+	for (auto buk = &body->builder.head; buk; buk = buk->next)
+	{
+		if (!buk->written)
+			continue;
+
+		struct iovec chunk;
+		chunk.iov_base = buk->data;
+		chunk.iov_len  = buk->written;
+		iov.Add(chunk);
+	}
+
+	body->send_start = metrics_seconds();
+	http_response_body_iov(response, iov.data, (int)iov.count, http_body_release, body);
+
+	Free(&iov);
+}
+
+static void handle_metrics_request(struct http_request_s *request)
+{
+	auto body = new Response_Body;
+	metrics_write(&body->builder);
+
+	struct http_response_s *response = http_response_init();
+	http_response_status(response, 200);
+	http_response_header(response, "Content-Type", "text/plain; version=0.0.4");
+	http_response_body_builder(response, body);
+	http_respond(request, response);
+}
+
+// An execution runs on its own thread so that the reactor keeps serving its other
+// connections, the response is handed back to the reactor once it completes
+struct Server_Execution
+{
+	struct http_request_s *request;
+	Response_Body *        body;
+	Code_Execution         exe;
+};
+
+static void ServerRespond(Server_Execution *execution, void (*respond)(struct http_request_s *, struct http_response_s *))
+{
+	auto exe     = &execution->exe;
+	auto builder = &execution->body->builder;
+
+	RecordExecutionMetrics(exe);
+
+	const char *content_type = exe->failed ? "text/plain" : "application/json";
+	if (!exe->failed && IsBinaryTrace(builder))
+		content_type = "application/octet-stream";
+
+	if (exe->failed)
 	{
 		fprintf(stdout, "Execution Error:\n");
-		fprintf(stdout, "%.*s", length, body);
+		for (auto buk = &builder->head; buk; buk = buk->next)
+		{
+			fprintf(stdout, "%.*s", (int)buk->written, buk->data);
+		}
 		fprintf(stdout, "\n");
 	}
 
@@ -149,24 +988,249 @@ void handle_request(struct http_request_s *request)
 	http_response_header(response, "Content-Type", content_type);
 	http_response_header(response, "Access-Control-Allow-Origin", "*");
 	http_response_header(response, "Access-Control-Allow-Headers", "*");
-	http_response_body(response, (char *)body, length);
-	http_respond(request, response);
+	http_response_body_builder(response, execution->body);
+	respond(execution->request, response);
 
-	MemoryArenaFree(arena);
-	FreeBuilder(&builder);
+	delete execution;
 }
 
-int main()
+static void *ServerExecutionThreadProc(void *param)
+{
+	auto execution = (Server_Execution *)param;
+	auto exe       = &execution->exe;
+	auto builder   = &execution->body->builder;
+
+	InitThreadContext(0);
+
+	if (ServerSandbox)
+	{
+		auto slot = SandboxAcquireSlot(ServerSandbox);
+
+		int status = SandboxExecute(ServerSandbox, slot, exe);
+		if (status == 0)
+		{
+			// Copied out so that the slot is only held during the execution
+			for (auto buk = &slot->builder.head; buk; buk = buk->next)
+				WriteBuffer(builder, buk->data, buk->written);
+			exe->failed = slot->failed;
+			exe->stats  = slot->stats;
+		}
+		else
+		{
+			SandboxWriteFailure(builder, status);
+			exe->failed = true;
+		}
+
+		SandboxReleaseSlot(ServerSandbox, slot);
+	}
+	else
+	{
+		exe->arena = MemoryArenaAllocate(MegaBytes(128));
+
+		// The parser and the resolver exit the thread of the execution on errors
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, ExecuteCodeThreadProc, exe) == 0)
+		{
+			pthread_join(thread, NULL);
+		}
+		else
+		{
+			Write(builder, "Execution failed: the execution thread could not be started");
+			exe->failed = true;
+		}
+
+		MemoryArenaFree(exe->arena);
+	}
+
+	ServerRespond(execution, http_respond_async);
+	return nullptr;
+}
+
+void handle_request(struct http_request_s *request)
+{
+	double request_start = metrics_seconds();
+
+	auto target = http_request_target(request);
+	auto method = http_request_method(request);
+
+	if (StrMatch(String(method.buf, method.len), "GET") && IsMetricsTarget(String(target.buf, target.len)))
+	{
+		handle_metrics_request(request);
+		return;
+	}
+
+	auto code = http_request_body(request);
+
+	String content;
+	content.data = (uint8_t *)code.buf;
+	content.length = code.len;
+
+	Request req = ParseRequest(content);
+
+	req.run = IsRunTarget(String(target.buf, target.len));
+
+	printf("Requested code::\n%s\nInput::%s\n\n", req.code.data, req.input.data);
+
+	auto execution = new Server_Execution;
+	execution->request = request;
+	execution->body    = new Response_Body;
+	execution->body->request_start = request_start;
+
+	// The code and the input point into the buffer of the request, which is kept until the response
+	auto exe = &execution->exe;
+	exe->arena   = nullptr;
+	exe->builder = &execution->body->builder;
+	exe->code    = req.code;
+	exe->input   = req.input;
+	exe->trace   = req.trace;
+	exe->budget  = req.budget;
+	exe->run     = req.run;
+	exe->failed  = false;
+
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	pthread_t thread;
+	int result = pthread_create(&thread, &attr, ServerExecutionThreadProc, execution);
+	pthread_attr_destroy(&attr);
+
+	if (result != 0)
+	{
+		Write(exe->builder, "Execution failed: the execution thread could not be started");
+		exe->failed = true;
+		ServerRespond(execution, http_respond);
+	}
+}
+
+struct Server_Reactor
+{
+	pthread_t thread;
+	int       port;
+	int       cpu;
+};
+
+static void *ServerReactorThreadProc(void *param)
+{
+	auto reactor = (Server_Reactor *)param;
+
+	InitThreadContext(0);
+
+	// The execution threads inherit the affinity of the reactor that creates them
+	if (reactor->cpu >= 0)
+	{
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(reactor->cpu, &cpus);
+		pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+	}
+
+	// Every reactor binds its own SO_REUSEPORT socket with its own event loop,
+	// the kernel spreads the connections between them
+	struct http_server_s *server = http_server_init(reactor->port, handle_request);
+	http_server_listen(server);
+
+	return nullptr;
+}
+
+// Listens on the port and serves the requests, does not return
+// With more than one reactor, each runs on its own thread pinned to a core, 0 uses one reactor per core
+// With the sandbox, the code is executed in worker processes
+void RunServer(int port, int reactors, bool sandbox)
 {
 	InitThreadContext(0);
 
 	parser_register_error_proc(parser_on_error);
 	code_type_resolver_register_error_proc(code_type_resolver_on_error);
 
-	struct http_server_s *server = http_server_init(8000, handle_request);
-	http_server_listen(server);
+	if (sandbox && !SandboxStart())
+	{
+		fprintf(stderr, "Could not start the sandbox\n");
+		exit(1);
+	}
+
+	if (reactors == 1)
+	{
+		struct http_server_s *server = http_server_init(port, handle_request);
+		http_server_listen(server);
+		return;
+	}
+
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	sched_getaffinity(0, sizeof(allowed), &allowed);
+
+	int cpus[CPU_SETSIZE];
+	int cpu_count = 0;
+	for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+	{
+		if (CPU_ISSET(cpu, &allowed))
+			cpus[cpu_count++] = cpu;
+	}
+
+	if (reactors <= 0)
+		reactors = Maximum(cpu_count, 1);
+
+	auto list = new Server_Reactor[reactors];
+
+	for (int index = 0; index < reactors; ++index)
+	{
+		auto reactor  = &list[index];
+		reactor->port = port;
+		reactor->cpu  = cpu_count ? cpus[index % cpu_count] : -1;
+
+		int result = pthread_create(&reactor->thread, NULL, ServerReactorThreadProc, reactor);
+		if (result)
+		{
+			fprintf(stderr, "Could not start the reactor %d\n", index);
+			exit(1);
+		}
+	}
+
+	for (int index = 0; index < reactors; ++index)
+		pthread_join(list[index].thread, NULL);
+}
+
+// The benchmark runs the server in its own process
+#ifndef KANO_BENCH
+int main(int argc, char **argv)
+{
+	int  reactors = 1;
+	bool sandbox  = false;
+
+	for (int index = 1; index < argc; ++index)
+	{
+		if (strcmp(argv[index], "-reactors") == 0 && index + 1 < argc)
+		{
+			reactors = atoi(argv[++index]);
+		}
+		else if (strcmp(argv[index], "-sandbox") == 0)
+		{
+			sandbox = true;
+		}
+		else if (strcmp(argv[index], "-parallel") == 0 && index + 1 < argc)
+		{
+			interp_parallel_threads(atoi(argv[++index]));
+		}
+		else if (strcmp(argv[index], "-budget") == 0 && index + 1 < argc && atoll(argv[index + 1]) > 0)
+		{
+			ServerBudgetMilliseconds = (uint64_t)atoll(argv[++index]);
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [-reactors count] [-sandbox] [-parallel threads] [-budget milliseconds]\n", argv[0]);
+			fprintf(stderr, "\t-reactors: count of 0 runs one reactor per core, the default is 1\n");
+			fprintf(stderr, "\t-sandbox: executes every request in a worker process forked from a zygote\n");
+			fprintf(stderr, "\t-parallel: threads that execute a parallel for, the default of 0 uses one per core\n");
+			fprintf(stderr, "\t-budget: deadline of every execution, the default is %d ms\n\n", (int)SERVER_BUDGET_MILLISECONDS);
+			return 1;
+		}
+	}
+
+	RunServer(8000, reactors, sandbox);
 	return 0;
 }
+#endif
 
 #endif
 
@@ -185,7 +1249,10 @@ DWORD WINAPI ExecuteCodeThreadProc(void *param)
 
 	InitThreadContext(0);
 
-	exe->failed = !GenerateDebugCodeInfo(exe->code, exe->input, exe->arena, exe->builder);
+	if (exe->run)
+		exe->failed = !RunCode(exe->code, exe->input, exe->budget, exe->arena, exe->builder, &exe->stats);
+	else
+		exe->failed = !GenerateDebugCodeInfo(exe->code, exe->input, exe->trace, exe->budget, exe->arena, exe->builder, &exe->stats);
 	if (exe->failed)
 	{
 		return 1;
@@ -256,6 +1323,8 @@ void Listen(HANDLE req_queue)
 			{
 			case HttpVerbPOST:
 			{
+				double request_start = metrics_seconds();
+
 				auto scratch = ThreadScratchpad();
 				auto temp = BeginTemporaryMemory(scratch);
 
@@ -288,6 +1357,9 @@ void Listen(HANDLE req_queue)
 				}
 
 				Request req = ParseRequest(content);
+
+				auto path = request->CookedUrl.pAbsPath;
+				req.run = path && wcsncmp(path, L"/run", 4) == 0 && (path[4] == 0 || path[4] == L'?' || path[4] == L'/');
 				printf("Requested code::\n%s\nInput::%s\n\n", req.code.data, req.input.data);
 
 				String_Builder builder;
@@ -298,12 +1370,17 @@ void Listen(HANDLE req_queue)
 				exe.builder = &builder;
 				exe.code    = req.code;
 				exe.input   = req.input;
+				exe.trace   = req.trace;
+				exe.budget  = req.budget;
+				exe.run     = req.run;
 				exe.failed  = false;
 
 				HANDLE thread = CreateThread(nullptr, 0, ExecuteCodeThreadProc, &exe, 0, nullptr);
 				WaitForSingleObject(thread, INFINITE);
 				CloseHandle(thread);
 
+				RecordExecutionMetrics(&exe);
+
 				if (exe.failed)
 				{
 					fprintf(stdout, "Execution Error:\n");
@@ -336,7 +1413,7 @@ void Listen(HANDLE req_queue)
 				response.pReason = (char *)reason.data;
 				response.ReasonLength = (USHORT)reason.length;
 
-				String content_type = "application/json";
+				String content_type = IsBinaryTrace(&builder) ? "application/octet-stream" : "application/json";
 				response.Headers.KnownHeaders[HttpHeaderContentType].pRawValue = (char *)content_type.data;
 				response.Headers.KnownHeaders[HttpHeaderContentType].RawValueLength = (USHORT)content_type.length;
 
@@ -365,6 +1442,8 @@ void Listen(HANDLE req_queue)
 				response.EntityChunkCount = chunk_count;
 				response.pEntityChunks = data;
 
+				double send_start = metrics_seconds();
+
 				DWORD bytes_sent = 0;
 				result = HttpSendHttpResponse(req_queue, request->RequestId, 0, &response, NULL, &bytes_sent, NULL, 0, NULL, NULL);
 
@@ -373,12 +1452,35 @@ void Listen(HANDLE req_queue)
 					printf("HttpSendHttpResponse failed with %lu \n", result);
 				}
 
+				double now = metrics_seconds();
+				metrics_observe(METRICS_PHASE_SEND, now - send_start);
+				metrics_observe(METRICS_PHASE_TOTAL, now - request_start);
+
 				MemoryArenaFree(arena);
 				FreeBuilder(&builder);
 				EndTemporaryMemory(&temp);
 			}
 			break;
 
+			case HttpVerbGET:
+			{
+				auto path = request->CookedUrl.pAbsPath;
+				if (path && wcsncmp(path, L"/metrics", 8) == 0 && (path[8] == 0 || path[8] == L'?'))
+				{
+					String_Builder builder;
+					metrics_write(&builder);
+					String metrics = BuildString(&builder);
+					result = SendHttpResponse(req_queue, request, 200, "OK", "text/plain; version=0.0.4", metrics);
+					MemoryFree(metrics.data, metrics.length + 1);
+					FreeBuilder(&builder);
+				}
+				else
+				{
+					result = SendHttpResponse(req_queue, request, 503, "Not Implemented", "text/html", "");
+				}
+			}
+			break;
+
 			default:
 			{
 				result = SendHttpResponse(req_queue, request, 503, "Not Implemented", "text/html", "");
@@ -3,6 +3,8 @@
 #include "StringBuilder.h"
 #include "HeapAllocator.h"
 #include "JsonWriter.h"
+#include "Trace.h"
+#include "TypeInfo.h"
 #include "Kr/KrString.h"
 #pragma once
 #include "Resolver.h"
@@ -10,6 +12,11 @@
 #include <math.h>
 #include <stdlib.h>
 #include <time.h>
+#include <atomic>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 struct Call_Info {
 	String procedure_name;
@@ -24,27 +31,15 @@ struct Interp_User_Context {
 	Array<Call_Info> callstack;
 	clock_t          prev_count;
 	clock_t          first_count;
+	Trace_State      trace;
 };
 
-enum Memory_Type {
-	Memory_Type_INVALID,
-	Memory_Type_STACK,
-	Memory_Type_GLOBAL,
-	Memory_Type_HEAP,
-};
-
-static const char *memory_type_string(Memory_Type type) {
-	if (type == Memory_Type_INVALID) return "(invalid)";
-	if (type == Memory_Type_STACK) return "stack";
-	if (type == Memory_Type_GLOBAL) return "global";
-	if (type == Memory_Type_HEAP) return "heap";
-	return "(null)";
-}
-
 static Memory_Type interp_get_memory_type(Interpreter *interp, void *ptr)
 {
 	if (ptr >= interp->stack && ptr < interp->stack + interp->stack_size)
 		return Memory_Type_STACK;
+	if (ptr >= interp->shared_stack && ptr < interp->shared_stack + interp->stack_private)
+		return Memory_Type_STACK;
 	if (ptr >= interp->global && ptr < interp->global + interp->global_size)
 		return Memory_Type_GLOBAL;
 	if (heap_contains_memory(interp->heap, ptr))
@@ -52,6 +47,23 @@ static Memory_Type interp_get_memory_type(Interpreter *interp, void *ptr)
 	return Memory_Type_INVALID;
 }
 
+// The views that are not initialized yet hold the garbage of the stack, their elements are
+// only read when they all lie in the same memory of the interpreter
+static bool interp_array_view_readable(Interpreter *interp, uint8_t *data, int64_t count, uint64_t element_size)
+{
+	if (count == 0)
+		return true;
+	if (count < 0 || !element_size || (uint64_t)count > UINTPTR_MAX / element_size)
+		return false;
+
+	auto memory = interp_get_memory_type(interp, data);
+	if (memory == Memory_Type_INVALID)
+		return false;
+
+	auto last = (uintptr_t)data + (uint64_t)count * element_size - 1;
+	return last >= (uintptr_t)data && interp_get_memory_type(interp, (void *)last) == memory;
+}
+
 struct Interp_Morph {
 	uint8_t *arg;
 	uint64_t offset;
@@ -64,102 +76,36 @@ struct Interp_Morph {
 	void Return(const T &src) { memcpy(arg, &src, sizeof(T)); }
 
 	template <typename T>
-	T Arg(uint64_t alignment = sizeof(T))
+	T Arg(uint64_t alignment = alignof(T))
 	{
-		offset = AlignPower2Up(offset, sizeof(alignment));
+		offset = AlignPower2Up(offset, alignment);
 		auto ptr = arg + offset;
 		offset += sizeof(T);
 		return *(T *)ptr;
 	}
 };
 
-static void stdout_value(Interpreter *interp, String_Builder *sink, Code_Type *type, void *data)
-{
-	if (!data)
-	{
-		if (sink) Write(sink, "(null)"); 
-		printf("(null)");
-		return;
-	}
+static void stdout_value(Interpreter *interp, String_Builder *sink, Code_Type *type, void *data);
 
-	switch (type->kind)
+// The members of the #soa elements are read from the block of each member
+static void stdout_soa(Interpreter *interp, String_Builder *sink, Code_Type_Struct *_struct, uint8_t *data, int64_t count)
+{
+	if (sink) Write(sink, "[ ");
+	printf("[ ");
+	for (int64_t element = 0; element < count; ++element)
 	{
-	case CODE_TYPE_NULL:
-		if (sink) Write(sink, "(null)"); 
-		printf("(null)");
-		return;
-	case CODE_TYPE_CHARACTER:
-		if (sink) Write(sink, (int)*(Kano_Char *)data);
-		printf("%d", (int)*(Kano_Char *)data);
-		return;
-	case CODE_TYPE_INTEGER:
-		if (sink) Write(sink, *(Kano_Int *)data);
-		printf("%zd", *(Kano_Int *)data);
-		return;
-	case CODE_TYPE_REAL:
-		if (sink) Write(sink, *(Kano_Real *)data);
-		printf("%f", *(Kano_Real *)data);
-		return;
-	case CODE_TYPE_BOOL:
-		if (sink) Write(sink, (*(Kano_Bool *)data));
-		printf("%s", (*(Kano_Bool *)data) ? "true" : "false");
-		return;
-	case CODE_TYPE_PROCEDURE:
-		if (sink) WriteFormatted(sink, "0x%ll", data);
-		printf("%p", data);
-		return;
-
-	case CODE_TYPE_POINTER: {
-		auto pointer_type = (Code_Type_Pointer *)type;
-		void *raw_ptr = *(void **)data;
-
 		if (sink) Write(sink, "{ ");
 		printf("{ ");
-
-		if (raw_ptr)
-		{
-			if (sink) WriteFormatted(sink, "raw: %, ", raw_ptr);
-			printf("raw: %p, ", raw_ptr);
-		} else
-		{
-			if (sink) Write(sink, "raw: (null), ");
-			printf("raw: (null), ");
-		}
-
-		auto mem_type = interp_get_memory_type(interp, raw_ptr);
-
-		if (sink) Write(sink, "value: ");
-		printf("value: ");
-
-		if (mem_type != Memory_Type_INVALID)
-		{
-			stdout_value(interp, sink, pointer_type->base_type, raw_ptr);
-			if (sink) Write(sink, " "); printf(" ");
-		} else
-		{
-			if (sink) Write(sink, raw_ptr ? String("(garbage)") : String("(invalid)"));
-			printf("%s ", raw_ptr ? "(garbage)" : "(invalid)");
-		}
-
-		if (sink) Write(sink, "}");
-		printf("}");
-		return;
-	}
-
-	case CODE_TYPE_STRUCT: {
-		auto _struct = (Code_Type_Struct *)type;
-
-		if (sink) Write(sink, "{ ");
-		printf("{ ");
-
 		for (int64_t index = 0; index < _struct->member_count; ++index)
 		{
 			auto member = &_struct->members[index];
+
 			if (sink) Write(sink, member->name);
+			if (sink) Write(sink, ": ");
 			printf("%.*s: ", (int)member->name.length, member->name.data);
-			stdout_value(interp, sink, member->type, (uint8_t *)data + member->offset);
+			stdout_value(interp, sink, member->type, data + count * member->offset + element * member->type->runtime_size);
 
-			if (index < _struct->member_count - 1)
+			if (index + 1 < _struct->member_count)
 			{
 				if (sink) Write(sink, ",");
 				printf(",");
@@ -168,51 +114,177 @@ static void stdout_value(Interpreter *interp, String_Builder *sink, Code_Type *t
 			if (sink) Write(sink, " ");
 			printf(" ");
 		}
-
-		if (sink) Write(sink, "}");
-		printf("}");
-		return;
+		if (sink) Write(sink, "} ");
+		printf("} ");
 	}
+	if (sink) Write(sink, "]");
+	printf("]");
+}
 
-	case CODE_TYPE_ARRAY_VIEW: {
-		auto arr_type = (Code_Type_Array_View *)type;
-
-		auto arr_count = *(Kano_Int *)data;
-		auto arr_data = (uint8_t *)data + sizeof(Kano_Int);
+static void stdout_ops(Interpreter *interp, String_Builder *sink, Type_Op *ops, int64_t count, uint8_t *base)
+{
+	for (int64_t index = 0; index < count; ++index)
+	{
+		auto op   = &ops[index];
+		auto data = base + op->offset;
 
-		if (sink) Write(sink, "[ ");
-		printf("[ ");
-		for (int64_t index = 0; index < arr_count; ++index)
+		switch (op->kind)
 		{
-			stdout_value(interp, sink, arr_type->element_type, arr_data + index * arr_type->element_type->runtime_size);
-			if (sink) Write(sink, " ");
-			printf(" ");
-		}
-		if (sink) Write(sink, "]");
-		printf("]");
+		case TYPE_OP_NULL:
+			if (sink) Write(sink, "(null)"); 
+			printf("(null)");
+			break;
+		case TYPE_OP_CHARACTER:
+			if (sink) Write(sink, (int)*(Kano_Char *)data);
+			printf("%d", (int)*(Kano_Char *)data);
+			break;
+		case TYPE_OP_INTEGER:
+			if (sink) Write(sink, *(Kano_Int *)data);
+			printf("%zd", *(Kano_Int *)data);
+			break;
+		case TYPE_OP_REAL:
+			if (sink) Write(sink, *(Kano_Real *)data);
+			printf("%f", *(Kano_Real *)data);
+			break;
+		case TYPE_OP_BOOL:
+			if (sink) Write(sink, (*(Kano_Bool *)data));
+			printf("%s", (*(Kano_Bool *)data) ? "true" : "false");
+			break;
+		case TYPE_OP_SIZED_INTEGER: {
+			auto value = code_type_sized_integer_value(op->type->runtime_size, ((Code_Type_Sized_Integer *)op->type)->is_signed, data);
+			if (sink) Write(sink, value);
+			printf("%zd", value);
+		} break;
+		case TYPE_OP_SIZED_REAL:
+			if (sink) Write(sink, (Kano_Real) *(float *)data);
+			printf("%f", (Kano_Real) *(float *)data);
+			break;
+		case TYPE_OP_PROCEDURE:
+			if (sink) WriteFormatted(sink, "0x%ll", data);
+			printf("%p", data);
+			break;
+
+		case TYPE_OP_POINTER: {
+			auto pointer_type = (Code_Type_Pointer *)op->type;
+			void *raw_ptr = *(void **)data;
+
+			if (sink) Write(sink, "{ ");
+			printf("{ ");
+
+			if (raw_ptr)
+			{
+				if (sink) WriteFormatted(sink, "raw: %, ", raw_ptr);
+				printf("raw: %p, ", raw_ptr);
+			} else
+			{
+				if (sink) Write(sink, "raw: (null), ");
+				printf("raw: (null), ");
+			}
 
-		return;
-	}
+			auto mem_type = interp_get_memory_type(interp, raw_ptr);
 
-	case CODE_TYPE_STATIC_ARRAY: {
-		auto arr_type = (Code_Type_Static_Array *)type;
+			if (sink) Write(sink, "value: ");
+			printf("value: ");
 
-		auto arr_data = (uint8_t *)data;
+			if (mem_type != Memory_Type_INVALID)
+			{
+				stdout_value(interp, sink, pointer_type->base_type, raw_ptr);
+				if (sink) Write(sink, " "); printf(" ");
+			} else
+			{
+				if (sink) Write(sink, raw_ptr ? String("(garbage)") : String("(invalid)"));
+				printf("%s ", raw_ptr ? "(garbage)" : "(invalid)");
+			}
+
+			if (sink) Write(sink, "}");
+			printf("}");
+		} break;
+
+		case TYPE_OP_ARRAY_VIEW: {
+			auto element = ((Code_Type_Array_View *)op->type)->element_type;
+			auto ops     = &type_info(element)->ops;
+
+			auto arr_count = *(Kano_Int *)data;
+			auto arr_data = data + sizeof(Kano_Int);
+
+			if (((Code_Type_Array_View *)op->type)->soa)
+			{
+				stdout_soa(interp, sink, (Code_Type_Struct *)element, *(uint8_t **)arr_data, arr_count);
+				break;
+			}
+
+			if (sink) Write(sink, "[ ");
+			printf("[ ");
+			for (int64_t element_index = 0; element_index < arr_count; ++element_index)
+			{
+				stdout_ops(interp, sink, ops->data, ops->count, arr_data + element_index * element->runtime_size);
+				if (sink) Write(sink, " ");
+				printf(" ");
+			}
+			if (sink) Write(sink, "]");
+			printf("]");
+		} break;
+
+		case TYPE_OP_STRUCT: {
+			if (sink) Write(sink, "{ ");
+			printf("{ ");
+			stdout_ops(interp, sink, op + 1, op->count, data);
+			if (sink) Write(sink, "}");
+			printf("}");
+			index += op->count;
+		} break;
+
+		case TYPE_OP_MEMBER: {
+			if (sink) Write(sink, op->name);
+			if (sink) Write(sink, ": ");
+			printf("%.*s: ", (int)op->name.length, op->name.data);
+			stdout_ops(interp, sink, op + 1, op->count, data);
+			index += op->count;
+
+			// Members are separated by a comma, the last member is the end of the ops of its struct
+			if (index + 1 < count)
+			{
+				if (sink) Write(sink, ",");
+				printf(",");
+			}
 
-		if (sink) Write(sink, "[ ");
-		printf("[ ");
-		for (int64_t index = 0; index < arr_type->element_count; ++index)
-		{
-			stdout_value(interp, sink, arr_type->element_type, arr_data + index * arr_type->element_type->runtime_size);
 			if (sink) Write(sink, " ");
 			printf(" ");
+		} break;
+
+		case TYPE_OP_ARRAY: {
+			if (sink) Write(sink, "[ ");
+			printf("[ ");
+			for (uint32_t element = 0; element < op->repeat; ++element)
+			{
+				stdout_ops(interp, sink, op + 1, op->count, data + element * op->stride);
+				if (sink) Write(sink, " ");
+				printf(" ");
+			}
+			if (sink) Write(sink, "]");
+			printf("]");
+			index += op->count;
+		} break;
+
+		case TYPE_OP_SOA_ARRAY: {
+			auto element = ((Code_Type_Static_Array *)op->type)->element_type;
+			stdout_soa(interp, sink, (Code_Type_Struct *)element, data, op->repeat);
+		} break;
 		}
-		if (sink) Write(sink, "]");
-		printf("]");
+	}
+}
 
+static void stdout_value(Interpreter *interp, String_Builder *sink, Code_Type *type, void *data)
+{
+	if (!data)
+	{
+		if (sink) Write(sink, "(null)"); 
+		printf("(null)");
 		return;
 	}
-	}
+
+	auto ops = &type_info(type)->ops;
+	stdout_ops(interp, sink, ops->data, ops->count, (uint8_t *)data);
 }
 
 static void basic_print(Interpreter *interp) {
@@ -404,6 +476,362 @@ static void basic_va_arg_next(Interpreter *interp) {
 	morph.Return(x);
 }
 
+//
+// Numeric kernels over array views. The input is split in blocks whose size only depends on
+// its length, so that the results do not depend on the number of threads that computed them.
+//
+
+constexpr int64_t KERNEL_BLOCK_MIN   = 16 * 1024;
+constexpr int64_t KERNEL_BLOCK_COUNT = 256;
+
+// Shorter inputs are not worth waking the workers for
+constexpr int64_t KERNEL_PARALLEL_MIN = 128 * 1024;
+
+enum Kernel_Op
+{
+	KERNEL_OP_ADD,
+	KERNEL_OP_MIN,
+	KERNEL_OP_MAX,
+	KERNEL_OP_DOT,
+	KERNEL_OP_SCALE,
+	KERNEL_OP_AXPY,
+};
+
+template <typename T>
+struct Kernel
+{
+	Kernel_Op op;
+	T *       x;
+	T *       y;
+	T         alpha;
+	int64_t   length;
+	int64_t   block_size;
+	int64_t   block_count;
+	T         partials[KERNEL_BLOCK_COUNT];
+};
+
+// Scalar versions, the SIMD overloads below are picked for the types they support
+
+template <typename T>
+static T simd_reduce(Kernel_Op op, const T *x, const T *y, int64_t count)
+{
+	T result = (op == KERNEL_OP_MIN || op == KERNEL_OP_MAX) ? x[0] : 0;
+	for (int64_t index = 0; index < count; ++index)
+	{
+		switch (op)
+		{
+			case KERNEL_OP_ADD: result += x[index]; break;
+			case KERNEL_OP_MIN: result = Minimum(result, x[index]); break;
+			case KERNEL_OP_MAX: result = Maximum(result, x[index]); break;
+			case KERNEL_OP_DOT: result += x[index] * y[index]; break;
+			NoDefaultCase();
+		}
+	}
+	return result;
+}
+
+template <typename T>
+static void simd_map(Kernel_Op op, T alpha, const T *x, T *y, int64_t count)
+{
+	for (int64_t index = 0; index < count; ++index)
+		y[index] = op == KERNEL_OP_SCALE ? y[index] * alpha : y[index] + alpha * x[index];
+}
+
+#if defined(__SSE2__)
+
+static Kano_Real simd_reduce(Kernel_Op op, const Kano_Real *x, const Kano_Real *y, int64_t count)
+{
+	int64_t index = 0;
+
+	__m128d acc0, acc1;
+	if (op == KERNEL_OP_MIN || op == KERNEL_OP_MAX)
+		acc0 = acc1 = _mm_set1_pd(x[0]);
+	else
+		acc0 = acc1 = _mm_setzero_pd();
+
+	for (; index + 4 <= count; index += 4)
+	{
+		auto a = _mm_loadu_pd(x + index);
+		auto b = _mm_loadu_pd(x + index + 2);
+		switch (op)
+		{
+			case KERNEL_OP_ADD: acc0 = _mm_add_pd(acc0, a); acc1 = _mm_add_pd(acc1, b); break;
+			case KERNEL_OP_MIN: acc0 = _mm_min_pd(acc0, a); acc1 = _mm_min_pd(acc1, b); break;
+			case KERNEL_OP_MAX: acc0 = _mm_max_pd(acc0, a); acc1 = _mm_max_pd(acc1, b); break;
+			case KERNEL_OP_DOT:
+				acc0 = _mm_add_pd(acc0, _mm_mul_pd(a, _mm_loadu_pd(y + index)));
+				acc1 = _mm_add_pd(acc1, _mm_mul_pd(b, _mm_loadu_pd(y + index + 2)));
+				break;
+			NoDefaultCase();
+		}
+	}
+
+	double lanes[4];
+	_mm_storeu_pd(lanes, acc0);
+	_mm_storeu_pd(lanes + 2, acc1);
+
+	Kano_Real result = lanes[0];
+	for (int lane = 1; lane < 4; ++lane)
+	{
+		switch (op)
+		{
+			case KERNEL_OP_MIN: result = Minimum(result, lanes[lane]); break;
+			case KERNEL_OP_MAX: result = Maximum(result, lanes[lane]); break;
+			default: result += lanes[lane]; break;
+		}
+	}
+
+	for (; index < count; ++index)
+	{
+		switch (op)
+		{
+			case KERNEL_OP_ADD: result += x[index]; break;
+			case KERNEL_OP_MIN: result = Minimum(result, x[index]); break;
+			case KERNEL_OP_MAX: result = Maximum(result, x[index]); break;
+			case KERNEL_OP_DOT: result += x[index] * y[index]; break;
+			NoDefaultCase();
+		}
+	}
+
+	return result;
+}
+
+static void simd_map(Kernel_Op op, Kano_Real alpha, const Kano_Real *x, Kano_Real *y, int64_t count)
+{
+	int64_t index = 0;
+	auto    a     = _mm_set1_pd(alpha);
+	for (; index + 2 <= count; index += 2)
+	{
+		if (op == KERNEL_OP_SCALE)
+			_mm_storeu_pd(y + index, _mm_mul_pd(_mm_loadu_pd(y + index), a));
+		else
+			_mm_storeu_pd(y + index, _mm_add_pd(_mm_loadu_pd(y + index), _mm_mul_pd(a, _mm_loadu_pd(x + index))));
+	}
+
+	for (; index < count; ++index)
+		y[index] = op == KERNEL_OP_SCALE ? y[index] * alpha : y[index] + alpha * x[index];
+}
+
+static Kano_Int simd_reduce(Kernel_Op op, const Kano_Int *x, const Kano_Int *y, int64_t count)
+{
+	// SSE2 only has the 64 bit addition, the other operations are unrolled instead
+	if (op == KERNEL_OP_ADD)
+	{
+		int64_t index = 0;
+		auto    acc0  = _mm_setzero_si128();
+		auto    acc1  = _mm_setzero_si128();
+		for (; index + 4 <= count; index += 4)
+		{
+			acc0 = _mm_add_epi64(acc0, _mm_loadu_si128((const __m128i *)(x + index)));
+			acc1 = _mm_add_epi64(acc1, _mm_loadu_si128((const __m128i *)(x + index + 2)));
+		}
+
+		int64_t lanes[2];
+		_mm_storeu_si128((__m128i *)lanes, _mm_add_epi64(acc0, acc1));
+
+		Kano_Int result = lanes[0] + lanes[1];
+		for (; index < count; ++index)
+			result += x[index];
+		return result;
+	}
+
+	Kano_Int acc[4] = { x[0], x[0], x[0], x[0] };
+	if (op == KERNEL_OP_DOT)
+		acc[0] = acc[1] = acc[2] = acc[3] = 0;
+
+	int64_t index = 0;
+	for (; index + 4 <= count; index += 4)
+	{
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			auto value = x[index + lane];
+			switch (op)
+			{
+				case KERNEL_OP_MIN: acc[lane] = Minimum(acc[lane], value); break;
+				case KERNEL_OP_MAX: acc[lane] = Maximum(acc[lane], value); break;
+				case KERNEL_OP_DOT: acc[lane] += value * y[index + lane]; break;
+				NoDefaultCase();
+			}
+		}
+	}
+
+	for (; index < count; ++index)
+	{
+		switch (op)
+		{
+			case KERNEL_OP_MIN: acc[0] = Minimum(acc[0], x[index]); break;
+			case KERNEL_OP_MAX: acc[0] = Maximum(acc[0], x[index]); break;
+			case KERNEL_OP_DOT: acc[0] += x[index] * y[index]; break;
+			NoDefaultCase();
+		}
+	}
+
+	Kano_Int result = acc[0];
+	for (int lane = 1; lane < 4; ++lane)
+	{
+		switch (op)
+		{
+			case KERNEL_OP_MIN: result = Minimum(result, acc[lane]); break;
+			case KERNEL_OP_MAX: result = Maximum(result, acc[lane]); break;
+			default: result += acc[lane]; break;
+		}
+	}
+
+	return result;
+}
+
+#endif
+
+template <typename T>
+static void kernel_run_blocks(void *data, int64_t first, int64_t last)
+{
+	auto kernel = (Kernel<T> *)data;
+	for (auto block = first; block < last; ++block)
+	{
+		auto begin = block * kernel->block_size;
+		auto count = Minimum(kernel->block_size, kernel->length - begin);
+		auto y     = kernel->y ? kernel->y + begin : nullptr;
+
+		if (kernel->op == KERNEL_OP_SCALE || kernel->op == KERNEL_OP_AXPY)
+			simd_map(kernel->op, kernel->alpha, kernel->x + begin, y, count);
+		else
+			kernel->partials[block] = simd_reduce(kernel->op, kernel->x + begin, y, count);
+	}
+}
+
+template <typename T>
+static T kernel_execute(Interpreter *interp, Kernel_Op op, T *x, T *y, T alpha, int64_t length)
+{
+	if (length <= 0)
+		return 0;
+
+	Kernel<T> kernel = {};
+	kernel.op          = op;
+	kernel.x           = x;
+	kernel.y           = y;
+	kernel.alpha       = alpha;
+	kernel.length      = length;
+	kernel.block_size  = Maximum(KERNEL_BLOCK_MIN, (length + KERNEL_BLOCK_COUNT - 1) / KERNEL_BLOCK_COUNT);
+	kernel.block_count = (length + kernel.block_size - 1) / kernel.block_size;
+
+	if (length >= KERNEL_PARALLEL_MIN)
+		interp_parallel_range(interp, kernel.block_count, kernel_run_blocks<T>, &kernel);
+	else
+		kernel_run_blocks<T>(&kernel, 0, kernel.block_count);
+
+	T result = kernel.partials[0];
+	for (int64_t block = 1; block < kernel.block_count; ++block)
+	{
+		switch (op)
+		{
+			case KERNEL_OP_MIN: result = Minimum(result, kernel.partials[block]); break;
+			case KERNEL_OP_MAX: result = Maximum(result, kernel.partials[block]); break;
+			default: result += kernel.partials[block]; break;
+		}
+	}
+
+	return result;
+}
+
+template <typename T>
+static void basic_reduce(Interpreter *interp, Kernel_Op op)
+{
+	Interp_Morph morph(interp);
+	morph.OffsetReturn<T>();
+	auto x = morph.Arg<Array_View<T>>();
+	morph.Return(kernel_execute<T>(interp, op, x.data, nullptr, 0, x.count));
+}
+
+template <typename T>
+static void basic_dot(Interpreter *interp)
+{
+	Interp_Morph morph(interp);
+	morph.OffsetReturn<T>();
+	auto x = morph.Arg<Array_View<T>>();
+	auto y = morph.Arg<Array_View<T>>();
+	morph.Return(kernel_execute<T>(interp, KERNEL_OP_DOT, x.data, y.data, 0, Minimum(x.count, y.count)));
+}
+
+static void basic_reduce_add(Interpreter *interp) { basic_reduce<Kano_Real>(interp, KERNEL_OP_ADD); }
+static void basic_reduce_min(Interpreter *interp) { basic_reduce<Kano_Real>(interp, KERNEL_OP_MIN); }
+static void basic_reduce_max(Interpreter *interp) { basic_reduce<Kano_Real>(interp, KERNEL_OP_MAX); }
+static void basic_reduce_add_int(Interpreter *interp) { basic_reduce<Kano_Int>(interp, KERNEL_OP_ADD); }
+static void basic_reduce_min_int(Interpreter *interp) { basic_reduce<Kano_Int>(interp, KERNEL_OP_MIN); }
+static void basic_reduce_max_int(Interpreter *interp) { basic_reduce<Kano_Int>(interp, KERNEL_OP_MAX); }
+
+static void basic_scale(Interpreter *interp) {
+	Interp_Morph morph(interp);
+	auto x = morph.Arg<Array_View<Kano_Real>>();
+	auto s = morph.Arg<Kano_Real>();
+	kernel_execute<Kano_Real>(interp, KERNEL_OP_SCALE, x.data, x.data, s, x.count);
+}
+
+static void basic_axpy(Interpreter *interp) {
+	Interp_Morph morph(interp);
+	auto a = morph.Arg<Kano_Real>();
+	auto x = morph.Arg<Array_View<Kano_Real>>();
+	auto y = morph.Arg<Array_View<Kano_Real>>();
+	kernel_execute<Kano_Real>(interp, KERNEL_OP_AXPY, x.data, y.data, a, Minimum(x.count, y.count));
+}
+
+static void basic_thread_start(Interpreter *interp) {
+	Interp_Morph morph(interp);
+	morph.OffsetReturn<Kano_Int>();
+	auto procedure = morph.Arg<Code_Value_Procedure>(sizeof(Code_Value_Procedure));
+	auto argument  = morph.Arg<void *>();
+	morph.Return(interp_thread_start(interp, procedure, argument));
+}
+
+static void basic_thread_join(Interpreter *interp) {
+	Interp_Morph morph(interp);
+	auto handle = morph.Arg<Kano_Int>();
+	interp_thread_join(interp, handle);
+}
+
+// The integers of the program are accessed through atomics of the same layout
+static_assert(sizeof(std::atomic<Kano_Int>) == sizeof(Kano_Int), "Kano_Int atomics must be lock free");
+
+static std::atomic<Kano_Int> *basic_atomic(Kano_Int *ptr) {
+	return (std::atomic<Kano_Int> *)ptr;
+}
+
+static void basic_atomic_load(Interpreter *interp) {
+	Interp_Morph morph(interp);
+	morph.OffsetReturn<Kano_Int>();
+	auto ptr = morph.Arg<Kano_Int *>();
+	morph.Return(basic_atomic(ptr)->load());
+}
+
+static void basic_atomic_store(Interpreter *interp) {
+	Interp_Morph morph(interp);
+	auto ptr   = morph.Arg<Kano_Int *>();
+	auto value = morph.Arg<Kano_Int>();
+	basic_atomic(ptr)->store(value);
+}
+
+// Returns the value before the addition
+static void basic_atomic_add(Interpreter *interp) {
+	Interp_Morph morph(interp);
+	morph.OffsetReturn<Kano_Int>();
+	auto ptr   = morph.Arg<Kano_Int *>();
+	auto value = morph.Arg<Kano_Int>();
+	morph.Return(basic_atomic(ptr)->fetch_add(value));
+}
+
+static void basic_atomic_cas(Interpreter *interp) {
+	Interp_Morph morph(interp);
+	morph.OffsetReturn<Kano_Bool>();
+	auto ptr      = morph.Arg<Kano_Int *>();
+	auto expected = morph.Arg<Kano_Int>();
+	auto desired  = morph.Arg<Kano_Int>();
+	Kano_Bool result = basic_atomic(ptr)->compare_exchange_strong(expected, desired);
+	morph.Return(result);
+}
+
+static void basic_fence(Interpreter *interp) {
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
 static void include_basic(Code_Type_Resolver *resolver)
 {
 	Procedure_Builder builder(resolver);
@@ -420,30 +848,126 @@ static void include_basic(Code_Type_Resolver *resolver)
 
 	proc_builder_argument(&builder, "int");
 	proc_builder_return(&builder, "*void");
+	proc_builder_thread_safe(&builder);
 	proc_builder_register(&builder, "allocate", basic_allocate);
 
 	proc_builder_argument(&builder, "*void");
+	proc_builder_thread_safe(&builder);
 	proc_builder_register(&builder, "free", basic_free);
 
 	proc_builder_argument(&builder, "float");
 	proc_builder_return(&builder, "float");
+	proc_builder_thread_safe(&builder);
 	proc_builder_register(&builder, "sin", basic_sin);
 
 	proc_builder_argument(&builder, "float");
 	proc_builder_return(&builder, "float");
+	proc_builder_thread_safe(&builder);
 	proc_builder_register(&builder, "cos", basic_cos);
 
 	proc_builder_argument(&builder, "float");
 	proc_builder_return(&builder, "float");
+	proc_builder_thread_safe(&builder);
 	proc_builder_register(&builder, "tan", basic_tan);
 
 	proc_builder_argument(&builder, "*void");
 	proc_builder_return(&builder, "*void");
+	proc_builder_thread_safe(&builder);
 	proc_builder_register(&builder, "va_arg_next", basic_va_arg_next);
 
 	proc_builder_argument(&builder, "*void");
 	proc_builder_return(&builder, "*void");
+	proc_builder_thread_safe(&builder);
 	proc_builder_register(&builder, "va_arg", basic_va_arg);
 
+	proc_builder_argument(&builder, "[]float");
+	proc_builder_return(&builder, "float");
+	proc_builder_thread_safe(&builder);
+	proc_builder_register(&builder, "reduce_add", basic_reduce_add);
+
+	proc_builder_argument(&builder, "[]float");
+	proc_builder_return(&builder, "float");
+	proc_builder_thread_safe(&builder);
+	proc_builder_register(&builder, "reduce_min", basic_reduce_min);
+
+	proc_builder_argument(&builder, "[]float");
+	proc_builder_return(&builder, "float");
+	proc_builder_thread_safe(&builder);
+	proc_builder_register(&builder, "reduce_max", basic_reduce_max);
+
+	proc_builder_argument(&builder, "[]float");
+	proc_builder_argument(&builder, "[]float");
+	proc_builder_return(&builder, "float");
+	proc_builder_thread_safe(&builder);
+	proc_builder_register(&builder, "dot", basic_dot<Kano_Real>);
+
+	proc_builder_argument(&builder, "[]float");
+	proc_builder_argument(&builder, "float");
+	proc_builder_thread_safe(&builder);
+	proc_builder_register(&builder, "scale", basic_scale);
+
+	proc_builder_argument(&builder, "float");
+	proc_builder_argument(&builder, "[]float");
+	proc_builder_argument(&builder, "[]float");
+	proc_builder_thread_safe(&builder);
+	proc_builder_register(&builder, "axpy", basic_axpy);
+
+	proc_builder_argument(&builder, "[]int");
+	proc_builder_return(&builder, "int");
+	proc_builder_thread_safe(&builder);
+	proc_builder_register(&builder, "reduce_add_int", basic_reduce_add_int);
+
+	proc_builder_argument(&builder, "[]int");
+	proc_builder_return(&builder, "int");
+	proc_builder_thread_safe(&builder);
+	proc_builder_register(&builder, "reduce_min_int", basic_reduce_min_int);
+
+	proc_builder_argument(&builder, "[]int");
+	proc_builder_return(&builder, "int");
+	proc_builder_thread_safe(&builder);
+	proc_builder_register(&builder, "reduce_max_int", basic_reduce_max_int);
+
+	proc_builder_argument(&builder, "[]int");
+	proc_builder_argument(&builder, "[]int");
+	proc_builder_return(&builder, "int");
+	proc_builder_thread_safe(&builder);
+	proc_builder_register(&builder, "dot_int", basic_dot<Kano_Int>);
+
+	proc_builder_argument(&builder, "proc(*void)");
+	proc_builder_argument(&builder, "*void");
+	proc_builder_return(&builder, "int");
+	proc_builder_thread_safe(&builder);
+	proc_builder_register(&builder, "thread_start", basic_thread_start);
+
+	proc_builder_argument(&builder, "int");
+	proc_builder_thread_safe(&builder);
+	proc_builder_register(&builder, "thread_join", basic_thread_join);
+
+	proc_builder_argument(&builder, "*int");
+	proc_builder_return(&builder, "int");
+	proc_builder_thread_safe(&builder);
+	proc_builder_register(&builder, "atomic_load", basic_atomic_load);
+
+	proc_builder_argument(&builder, "*int");
+	proc_builder_argument(&builder, "int");
+	proc_builder_thread_safe(&builder);
+	proc_builder_register(&builder, "atomic_store", basic_atomic_store);
+
+	proc_builder_argument(&builder, "*int");
+	proc_builder_argument(&builder, "int");
+	proc_builder_return(&builder, "int");
+	proc_builder_thread_safe(&builder);
+	proc_builder_register(&builder, "atomic_add", basic_atomic_add);
+
+	proc_builder_argument(&builder, "*int");
+	proc_builder_argument(&builder, "int");
+	proc_builder_argument(&builder, "int");
+	proc_builder_return(&builder, "bool");
+	proc_builder_thread_safe(&builder);
+	proc_builder_register(&builder, "atomic_cas", basic_atomic_cas);
+
+	proc_builder_thread_safe(&builder);
+	proc_builder_register(&builder, "fence", basic_fence);
+
 	proc_builder_free(&builder);
 }
@@ -2,15 +2,66 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <math.h>
+#include <atomic>
+
+//
+// Buckets of the builders using the default allocator are shared by all the threads through
+// a global pool, so that the builders of the next requests reuse them instead of allocating.
+// The builders using other allocators (arenas) keep their buckets to themselves.
+//
+
+constexpr int64_t STRING_BUILDER_POOL_MAX_BUCKETS = 1024;
+
+static std::atomic_flag        BucketPoolLock = ATOMIC_FLAG_INIT;
+static String_Builder::Bucket *BucketPool;
+static int64_t                 BucketPoolCount;
+
+static bool StringBuilderUsesPool(String_Builder *builder) {
+	return builder->allocator.proc == DefaultMemoryAllocatorProc;
+}
+
+static String_Builder::Bucket *BucketPoolPop() {
+	while (BucketPoolLock.test_and_set(std::memory_order_acquire));
+	auto buk = BucketPool;
+	if (buk) {
+		BucketPool = buk->next;
+		BucketPoolCount -= 1;
+		buk->next = nullptr;
+	}
+	BucketPoolLock.clear(std::memory_order_release);
+	return buk;
+}
+
+// Returns the buckets that did not fit in the pool
+static String_Builder::Bucket *BucketPoolPush(String_Builder::Bucket *list) {
+	while (BucketPoolLock.test_and_set(std::memory_order_acquire));
+	while (list && BucketPoolCount < STRING_BUILDER_POOL_MAX_BUCKETS) {
+		auto buk = list;
+		list = list->next;
+		buk->next = BucketPool;
+		BucketPool = buk;
+		BucketPoolCount += 1;
+	}
+	BucketPoolLock.clear(std::memory_order_release);
+	return list;
+}
 
 static String_Builder::Bucket *StringBuilderNewBucket(String_Builder *builder) {
+	if (builder->free_list == nullptr && StringBuilderUsesPool(builder)) {
+		builder->free_list = BucketPoolPop();
+	}
+
 	if (builder->free_list == nullptr) {
-		builder->free_list = new(builder->allocator) String_Builder::Bucket;
+		builder->free_list = (String_Builder::Bucket *)MemoryAllocate(sizeof(String_Builder::Bucket), builder->allocator);
+		builder->free_list->next = nullptr;
 	}
 
+	// Only the header is reset, the data is always written before it is read
 	auto buk = builder->free_list;
 	builder->free_list = buk->next;
-	*buk = String_Builder::Bucket{};
+	buk->next    = nullptr;
+	buk->written = 0;
 	return buk;
 }
 
@@ -51,46 +102,134 @@ int Write(String_Builder *builder, uint8_t value) {
 	return WriteBuffer(builder, &value, 1);
 }
 
+static const char DigitPairs[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+// Writes the digits backwards ending at `end`, returns the number of digits
+static int FormatUnsigned(char *end, uint64_t value) {
+	char *ptr = end;
+
+	while (value >= 100) {
+		auto pair = (value % 100) * 2;
+		value /= 100;
+		ptr -= 2;
+		ptr[0] = DigitPairs[pair];
+		ptr[1] = DigitPairs[pair + 1];
+	}
+
+	if (value >= 10) {
+		ptr -= 2;
+		ptr[0] = DigitPairs[value * 2];
+		ptr[1] = DigitPairs[value * 2 + 1];
+	} else {
+		*--ptr = (char)('0' + value);
+	}
+
+	return (int)(end - ptr);
+}
+
+static int WriteUnsigned(String_Builder *builder, uint64_t value, bool negative) {
+	char buffer[24];
+	char *end = buffer + sizeof(buffer);
+	int count = FormatUnsigned(end, value);
+	if (negative) end[-++count] = '-';
+	return WriteBuffer(builder, end - count, count);
+}
+
+static int WriteSigned(String_Builder *builder, int64_t value) {
+	// Negated as unsigned so that the minimum value does not overflow
+	if (value < 0) return WriteUnsigned(builder, 0 - (uint64_t)value, true);
+	return WriteUnsigned(builder, (uint64_t)value, false);
+}
+
+// Same output as printf("%.2f"), the fraction is rounded from its exact product
+// with 100 (recovered with fma) using round-half-even, as glibc does.
+// Values that do not fit in 64 bits and non-finite values go through snprintf.
+static int WriteReal(String_Builder *builder, double value) {
+	double magnitude = fabs(value);
+
+	if (!(magnitude < 9.2e18)) {
+		char buffer[512];
+		int written = snprintf(buffer, sizeof(buffer), "%.2f", value);
+		return WriteBuffer(builder, &buffer, Minimum(written, (int)sizeof(buffer) - 1));
+	}
+
+	double integral = trunc(magnitude);
+	double fraction = magnitude - integral;
+
+	double product = fraction * 100.0;
+	double error   = fma(fraction, 100.0, -product);
+	double lower   = floor(product);
+	double excess  = product - lower;
+
+	uint64_t cents = (uint64_t)lower;
+	if (excess > 0.5 || (excess == 0.5 && (error > 0 || (error == 0 && (cents & 1)))))
+		cents += 1;
+
+	uint64_t whole = (uint64_t)integral;
+	if (cents >= 100) {
+		whole += 1;
+		cents -= 100;
+	}
+
+	char buffer[32];
+	char *end = buffer + sizeof(buffer);
+	end[-1] = DigitPairs[cents * 2 + 1];
+	end[-2] = DigitPairs[cents * 2];
+	end[-3] = '.';
+	int count = 3 + FormatUnsigned(end - 3, whole);
+	if (signbit(value)) end[-++count] = '-';
+	return WriteBuffer(builder, end - count, count);
+}
+
 int Write(String_Builder *builder, int32_t value) {
-	char buffer[128];
-	int written = snprintf(buffer, sizeof(buffer), "%d", value);
-	return WriteBuffer(builder, &buffer, written);
+	return WriteSigned(builder, value);
 }
 
 int Write(String_Builder *builder, uint32_t value) {
-	char buffer[128];
-	int written = snprintf(buffer, sizeof(buffer), "%u", value);
-	return WriteBuffer(builder, &buffer, written);
+	return WriteUnsigned(builder, value, false);
 }
 
 int Write(String_Builder *builder, int64_t value) {
-	char buffer[128];
-	int written = snprintf(buffer, sizeof(buffer), "%zd", value);
-	return WriteBuffer(builder, &buffer, written);
+	return WriteSigned(builder, value);
 }
 
 int Write(String_Builder *builder, uint64_t value) {
-	char buffer[128];
-	int written = snprintf(buffer, sizeof(buffer), "%zu", value);
-	return WriteBuffer(builder, &buffer, written);
+	return WriteUnsigned(builder, value, false);
 }
 
 int Write(String_Builder *builder, float value) {
-	char buffer[128];
-	int written = snprintf(buffer, sizeof(buffer), "%.2f", value);
-	return WriteBuffer(builder, &buffer, written);
+	return WriteReal(builder, value);
 }
 
 int Write(String_Builder *builder, double value) {
-	char buffer[128];
-	int written = snprintf(buffer, sizeof(buffer), "%.2f", value);
-	return WriteBuffer(builder, &buffer, written);
+	return WriteReal(builder, value);
 }
 
 int Write(String_Builder *builder, void *value) {
-	char buffer[128];
-	int written = snprintf(buffer, sizeof(buffer), "%08llx", (size_t)value);
-	return WriteBuffer(builder, &buffer, written);
+	static const char HexDigits[] = "0123456789abcdef";
+
+	char buffer[16];
+	char *end = buffer + sizeof(buffer);
+	char *ptr = end;
+
+	// At least 8 digits, same as "%08llx"
+	size_t bits = (size_t)value;
+	do {
+		*--ptr = HexDigits[bits & 0xf];
+		bits >>= 4;
+	} while (bits || end - ptr < 8);
+
+	return WriteBuffer(builder, ptr, end - ptr);
 }
 
 int Write(String_Builder *builder, const char *value) {
@@ -131,13 +270,22 @@ void ResetBuilder(String_Builder *builder) {
 		builder->free_list = builder->head.next;
 	}
 
-	builder->head = String_Builder::Bucket{};
+	builder->head.next    = nullptr;
+	builder->head.written = 0;
+	builder->current      = &builder->head;
+	builder->written      = 0;
 }
 
 void FreeBuilder(String_Builder *builder) {
 	ResetBuilder(builder);
 
 	auto root = builder->free_list;
+	builder->free_list = nullptr;
+
+	if (StringBuilderUsesPool(builder)) {
+		root = BucketPoolPush(root);
+	}
+
 	while (root) {
 		auto ptr = root;
 		root = root->next;
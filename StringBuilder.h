@@ -44,14 +44,18 @@ int WriteFormatted(String_Builder *builder, const char *format);
 
 template <typename Type, typename ...Args>
 int WriteFormatted(String_Builder *builder, const char *format, Type value, Args... args) {
+	// The literal run before the next '%' is copied at once
+	auto literal = format;
+	while (*format && *format != '%')
+		++format;
+
 	int written = 0;
+	if (format != literal)
+		written += WriteBuffer(builder, (void *)literal, format - literal);
 
-	for (; *format; ++format) {
-		if (*format == '%') {
-			written += Write(builder, value);
-			return written + WriteFormatted(builder, format + 1, args...);
-		}
-		written += Write(builder, *format);
+	if (*format == '%') {
+		written += Write(builder, value);
+		return written + WriteFormatted(builder, format + 1, args...);
 	}
 
 	return written;
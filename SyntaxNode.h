@@ -44,6 +44,7 @@ enum Syntax_Node_Kind
 	SYNTAX_NODE_FOR,
 	SYNTAX_NODE_WHILE,
 	SYNTAX_NODE_DO,
+	SYNTAX_NODE_SPAWN,
 	SYNTAX_NODE_PROCEDURE_ARGUMENT,
 	SYNTAX_NODE_PROCEDURE,
 	SYNTAX_NODE_DECLARATION,
@@ -74,6 +75,7 @@ struct Syntax_Node_If;
 struct Syntax_Node_For;
 struct Syntax_Node_While;
 struct Syntax_Node_Do;
+struct Syntax_Node_Spawn;
 struct Syntax_Node_Procedure_Argument;
 struct Syntax_Node_Procedure;
 struct Syntax_Node_Declaration;
@@ -165,8 +167,9 @@ struct Syntax_Node_Procedure_Prototype_Argument : public Syntax_Node
 		kind = SYNTAX_NODE_PROCEDURE_PROTOTYPE_ARGUMENT;
 	}
 
-	Syntax_Node_Type *                        type = nullptr;
-	Syntax_Node_Procedure_Prototype_Argument *next = nullptr;
+	Syntax_Node_Type *                        type  = nullptr;
+	uint32_t                                  flags = 0;
+	Syntax_Node_Procedure_Prototype_Argument *next  = nullptr;
 };
 
 struct Syntax_Node_Procedure_Prototype : public Syntax_Node
@@ -345,6 +348,8 @@ struct Syntax_Node_For : public Syntax_Node
 	Syntax_Node_Expression *increment      = nullptr;
 
 	Syntax_Node_Statement * body           = nullptr;
+
+	bool                    parallel       = false;
 };
 
 struct Syntax_Node_While : public Syntax_Node
@@ -369,6 +374,16 @@ struct Syntax_Node_Do : public Syntax_Node
 	Syntax_Node_Expression *condition = nullptr;
 };
 
+struct Syntax_Node_Spawn : public Syntax_Node
+{
+	Syntax_Node_Spawn()
+	{
+		kind = SYNTAX_NODE_SPAWN;
+	}
+
+	Syntax_Node_Expression *call = nullptr;
+};
+
 struct Syntax_Node_Procedure_Argument : public Syntax_Node
 {
 	Syntax_Node_Procedure_Argument()
@@ -432,6 +447,7 @@ struct Syntax_Node_Array_View : public Syntax_Node
 	}
 
 	Syntax_Node_Type *element_type = nullptr;
+	bool              soa          = false;
 };
 
 struct Syntax_Node_Static_Array : public Syntax_Node
@@ -443,6 +459,7 @@ struct Syntax_Node_Static_Array : public Syntax_Node
 
 	Syntax_Node_Expression *expression   = nullptr;
 	Syntax_Node_Type *      element_type = nullptr;
+	bool                    soa          = false;
 };
 
 struct Syntax_Node_Statement : public Syntax_Node
@@ -81,6 +81,8 @@ enum Token_Kind
 	TOKEN_KIND_FOR,
 	TOKEN_KIND_WHILE,
 	TOKEN_KIND_DO,
+	TOKEN_KIND_PARALLEL,
+	TOKEN_KIND_SPAWN,
 
 	TOKEN_KIND_SIZE_OF,
 	TOKEN_KIND_TYPE_OF,
@@ -94,6 +96,8 @@ enum Token_Kind
 	TOKEN_KIND_VOID,
 	TOKEN_KIND_NULL,
 
+	TOKEN_KIND_SOA,
+
 	TOKEN_KIND_IDENTIFIER,
 
 	TOKEN_KIND_END,
@@ -177,7 +181,8 @@ static inline String token_kind_string(Token_Kind kind)
 	                           "else",
 
 	                           "for",         "while",
-	                           "do",
+	                           "do",          "parallel",
+	                           "spawn",
 
 	                           "size_of",     "type_of",
 
@@ -186,6 +191,8 @@ static inline String token_kind_string(Token_Kind kind)
 								"cast",
 	                           "void",        "null",
 
+	                           "#soa",
+
 	                           "identifier",
 
 	                           "-end-"};
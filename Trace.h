@@ -0,0 +1,208 @@
+#pragma once
+#include "Kr/KrBasic.h"
+#include "StringBuilder.h"
+#include "JsonWriter.h"
+#include "Interp.h"
+
+constexpr int TRACE_FORMAT_VERSION = 6;
+
+// Number of delta steps between two full keyframes in the delta trace
+constexpr int64_t TRACE_KEYFRAME_INTERVAL = 64;
+
+enum Trace_Format
+{
+	TRACE_FORMAT_FULL,
+	TRACE_FORMAT_DELTA,
+	TRACE_FORMAT_BINARY,
+};
+
+static inline const char *trace_format_string(Trace_Format format) {
+	if (format == TRACE_FORMAT_FULL) return "full";
+	if (format == TRACE_FORMAT_DELTA) return "delta";
+	if (format == TRACE_FORMAT_BINARY) return "binary";
+	return "(null)";
+}
+
+enum Memory_Type {
+	Memory_Type_INVALID,
+	Memory_Type_STACK,
+	Memory_Type_GLOBAL,
+	Memory_Type_HEAP,
+};
+
+static inline const char *memory_type_string(Memory_Type type) {
+	if (type == Memory_Type_INVALID) return "(invalid)";
+	if (type == Memory_Type_STACK) return "stack";
+	if (type == Memory_Type_GLOBAL) return "global";
+	if (type == Memory_Type_HEAP) return "heap";
+	return "(null)";
+}
+
+// Only the steps in [step_first, step_last] are traced, the steps before
+// the window are executed without tracing and the execution stops after it
+struct Trace_Options {
+	Trace_Format format = TRACE_FORMAT_FULL;
+	uint64_t     step_first = 0;
+	uint64_t     step_last = UINT64_MAX;
+};
+
+//
+// Binary trace
+//
+// All the integers are little endian, varint is unsigned LEB128.
+// header: "KTRC" u8(version)
+// record: u8(Trace_Record) followed by the payload
+//   STRING: varint(id) varint(length) bytes
+//   TYPE  : varint(id) u8(kind) varint(runtime_size) varint(name) u8(indirection) payload
+//           POINTER      : varint(base type)
+//           STRUCT       : varint(member count) [varint(name) varint(type) varint(offset)]...
+//           ARRAY_VIEW   : varint(element type) u8(soa)
+//           STATIC_ARRAY : varint(count) varint(element type) u8(soa)
+//           SIZED_INTEGER: u8(signed)
+//   SYMBOL: varint(id) varint(name) varint(type)
+//   STEP  : u8(Intercept_Kind) varint(line) f32(exe_dt) f32(exe_time)
+//           globals: [variable]... varint(0)
+//           callstack: [varint(procedure name) [variable]... varint(0)]... varint(0)
+//           varint(length) bytes (appended console output)
+//           u8(console_in changed) [varint(length) bytes]
+//   END   : f32(exe_time) varint(bss_size) varint(stack_size) varint(heap_allocated) varint(heap_freed)
+//           varint(step_count) u8(complete) u8(budget_exceeded) varint(length) bytes (symbol map as json)
+// variable: varint(symbol) u64(address) u8(Memory_Type) value
+// value: the raw bytes of the value for the types without indirection
+//        POINTER      : u64(raw) u8(Memory_Type) [value of base when the memory is valid]
+//        ARRAY_VIEW   : i64(count) u64(data) u8(Memory_Type) [value of element]...
+//        STRUCT       : [value of member]...
+//        STATIC_ARRAY : [value of element]...
+//        the elements of the #soa arrays and views are gathered, so they are written as any other element
+// Type, string and symbol ids start from 1, they are always defined before the step using them.
+//
+
+static const char TRACE_BINARY_MAGIC[4] = { 'K', 'T', 'R', 'C' };
+
+enum Trace_Record : uint8_t
+{
+	TRACE_RECORD_STRING,
+	TRACE_RECORD_TYPE,
+	TRACE_RECORD_SYMBOL,
+	TRACE_RECORD_STEP,
+	TRACE_RECORD_END,
+};
+
+static inline void trace_write_varint(String_Builder *builder, uint64_t value) {
+	uint8_t buffer[10];
+	int count = 0;
+	do {
+		uint8_t byte = value & 0x7f;
+		value >>= 7;
+		if (value) byte |= 0x80;
+		buffer[count++] = byte;
+	} while (value);
+	WriteBuffer(builder, buffer, count);
+}
+
+template <typename T>
+static inline void trace_write_raw(String_Builder *builder, T value) {
+	WriteBuffer(builder, &value, sizeof(value));
+}
+
+struct Trace_Reader {
+	uint8_t *data;
+	int64_t  length;
+	int64_t  position;
+	bool     failed;
+};
+
+static inline uint64_t trace_read_varint(Trace_Reader *reader) {
+	uint64_t value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (reader->position >= reader->length) {
+			reader->failed = true;
+			return 0;
+		}
+		uint8_t byte = reader->data[reader->position++];
+		value |= (uint64_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) return value;
+	}
+	reader->failed = true;
+	return value;
+}
+
+static inline uint8_t *trace_read_bytes(Trace_Reader *reader, int64_t length) {
+	if (length < 0 || reader->position + length > reader->length) {
+		reader->failed = true;
+		reader->position = reader->length;
+		return nullptr;
+	}
+	auto bytes = reader->data + reader->position;
+	reader->position += length;
+	return bytes;
+}
+
+template <typename T>
+static inline T trace_read_raw(Trace_Reader *reader) {
+	T value = {};
+	auto bytes = trace_read_bytes(reader, sizeof(T));
+	if (bytes) memcpy(&value, bytes, sizeof(T));
+	return value;
+}
+
+struct Trace_Variable {
+	String            name;
+	struct Code_Type *type;
+	void *            address;
+	int64_t           offset;
+	int64_t           length;
+};
+
+struct Trace_Frame {
+	String   procedure_name;
+	uint64_t stack_top;
+	int64_t  first_variable;
+	int64_t  variable_count;
+};
+
+// State of a single step as seen by the delta trace, frame 0 holds the globals.
+// For the types without indirection the bytes are the raw value, otherwise they
+// are the serialized value, so the changes behind pointers are also detected
+struct Trace_Snapshot {
+	Array<Trace_Frame>    frames;
+	Array<Trace_Variable> variables;
+	Array<uint8_t>        bytes;
+};
+
+struct Trace_State {
+	Trace_Format   format = TRACE_FORMAT_FULL;
+	uint64_t       step_first = 0;
+	uint64_t       step_last = UINT64_MAX;
+	uint64_t       step_count = 0;
+	Trace_Snapshot snapshots[2];
+	int            current = 0;
+	int64_t        console_out_written = 0;
+	String         console_in;
+	double         intercept_seconds = 0;
+	String_Builder scratch;
+	Json_Writer    scratch_json;
+
+	Table<String, uint64_t>   binary_strings;
+	Table<uint64_t, uint64_t> binary_types;
+	Table<uint64_t, uint64_t> binary_symbols;
+	String_Builder            binary_record;
+};
+
+// Filled by GenerateDebugCodeInfo and RunCode, the times are in seconds. The lexer runs
+// on demand while parsing, so it is part of the parse time
+struct Run_Stats {
+	double   parse = 0;
+	double   resolve = 0;
+	double   execute = 0;
+	double   trace = 0;
+	uint64_t steps = 0;
+	uint64_t ticks = 0;
+	uint64_t heap_allocated = 0;
+	bool     budget_exceeded = false;
+};
+
+bool GenerateDebugCodeInfo(String code, String input, Trace_Options options, Interp_Budget budget, Memory_Arena *arena, String_Builder *builder, Run_Stats *stats);
+
+// Runs the code without tracing, only the console output, timing and heap stats are written
+bool RunCode(String code, String input, Interp_Budget budget, Memory_Arena *arena, String_Builder *builder, Run_Stats *stats);
@@ -0,0 +1,593 @@
+#include "Kr/KrBasic.h"
+#include "Interp.h"
+#include "Trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+void AssertHandle(const char *reason, const char *file, int line, const char *proc)
+{
+	fprintf(stderr, "Internal Compiler Error %s. File: %s(%d)\n", reason, file, line);
+	DebugTriggerbreakpoint();
+}
+
+String read_entire_file(const char *file)
+{
+	FILE *f = fopen(file, "rb");
+	if (!f) return String();
+
+	fseek(f, 0, SEEK_END);
+	long fsize = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	uint8_t *string = (uint8_t *)MemoryAllocate(fsize + 1);
+	fread(string, 1, fsize, f);
+	fclose(f);
+
+	string[fsize] = 0;
+	return String(string, (int64_t)fsize);
+}
+
+//
+//
+//
+
+struct Trace_Member
+{
+	uint64_t name;
+	uint64_t type;
+	uint64_t offset;
+};
+
+struct Trace_Type
+{
+	bool                defined = false;
+	uint8_t             kind = CODE_TYPE_NULL;
+	uint64_t            runtime_size = 0;
+	uint64_t            name = 0;
+	bool                indirection = false;
+	bool                is_signed = false;
+	bool                soa = false;
+	uint64_t            element = 0;
+	uint64_t            count = 0;
+	Array<Trace_Member> members;
+};
+
+struct Trace_Symbol
+{
+	uint64_t name;
+	uint64_t type;
+};
+
+struct Trace_Converter
+{
+	Trace_Reader        reader;
+	Array<String>       strings;
+	Array<Trace_Type>   types;
+	Array<Trace_Symbol> symbols;
+	String_Builder      console_out;
+	String              console_in;
+	Json_Writer         json;
+};
+
+template <typename T>
+static T *convert_find(Array<T> &arr, uint64_t id)
+{
+	if (id == 0 || id >= (uint64_t)arr.count)
+		return nullptr;
+	return &arr[id];
+}
+
+template <typename T>
+static T *convert_define(Array<T> &arr, uint64_t id)
+{
+	if (id >= (uint64_t)arr.count)
+	{
+		auto count = arr.count;
+		arr.Resize(id + 1);
+		for (auto index = count; index < arr.count; ++index)
+			arr[index] = T{};
+	}
+	return &arr[id];
+}
+
+static String convert_string(Trace_Converter *conv, uint64_t id)
+{
+	auto string = convert_find(conv->strings, id);
+	return string ? *string : String("(null)");
+}
+
+static String convert_type_name(Trace_Converter *conv, uint64_t id)
+{
+	auto type = convert_find(conv->types, id);
+	return type ? convert_string(conv, type->name) : String("void");
+}
+
+static void convert_symbol(Trace_Converter *conv, String name, uint64_t type_id, uint64_t address, Memory_Type memory, uint8_t *bytes);
+
+static void convert_soa(Trace_Converter *conv, Trace_Type *type, uint64_t address, uint64_t count, Memory_Type memory, uint8_t *bytes);
+
+// The bytes are given for the values without indirection that are part of a parent value,
+// otherwise the value is read from the stream
+static void convert_value(Trace_Converter *conv, uint64_t type_id, uint64_t address, Memory_Type memory, uint8_t *bytes)
+{
+	auto json   = &conv->json;
+	auto reader = &conv->reader;
+
+	auto type = convert_find(conv->types, type_id);
+	if (!type || !type->defined)
+	{
+		reader->failed = true;
+		json->write_single_value("(null)");
+		return;
+	}
+
+	if (!bytes && !type->indirection)
+	{
+		bytes = trace_read_bytes(reader, type->runtime_size);
+		if (!bytes)
+		{
+			json->write_single_value("(null)");
+			return;
+		}
+	}
+
+	switch (type->kind)
+	{
+		case CODE_TYPE_NULL: json->write_single_value("(null)"); return;
+		case CODE_TYPE_CHARACTER: json->write_single_value("%", (int) *(Kano_Char *)bytes); return;
+
+		case CODE_TYPE_INTEGER: {
+			Kano_Int value;
+			memcpy(&value, bytes, sizeof(value));
+			json->write_single_value("%", value);
+		} return;
+
+		case CODE_TYPE_REAL: {
+			Kano_Real value;
+			memcpy(&value, bytes, sizeof(value));
+			json->write_single_value("%", value);
+		} return;
+
+		case CODE_TYPE_SIZED_INTEGER: {
+			uint32_t value = 0;
+			memcpy(&value, bytes, Minimum(type->runtime_size, sizeof(value)));
+			json->write_single_value("%", code_type_sized_integer_value((uint32_t)type->runtime_size, type->is_signed, &value));
+		} return;
+
+		case CODE_TYPE_SIZED_REAL: {
+			float value;
+			memcpy(&value, bytes, sizeof(value));
+			json->write_single_value("%", (Kano_Real)value);
+		} return;
+
+		case CODE_TYPE_BOOL: json->write_single_value("%", bytes[0] ? "true" : "false"); return;
+		case CODE_TYPE_PROCEDURE: json->write_single_value("%", (void *)address); return;
+
+		case CODE_TYPE_POINTER: {
+			auto raw_ptr  = trace_read_raw<uint64_t>(reader);
+			auto mem_type = (Memory_Type)trace_read_raw<uint8_t>(reader);
+
+			json->begin_object();
+
+			if (raw_ptr)
+				json->write_key_value_formatted("raw", "0x%", (void *)raw_ptr);
+			else
+				json->write_key_value_formatted("raw", "%", "null");
+
+			json->write_key_value_formatted("base_type", "%", convert_type_name(conv, type->element));
+			json->write_key_value_formatted("memory", "%", memory_type_string(mem_type));
+
+			json->write_key("value");
+			if (mem_type != Memory_Type_INVALID && type->element)
+			{
+				convert_value(conv, type->element, raw_ptr, mem_type, nullptr);
+			}
+			else
+			{
+				json->write_single_value("%", raw_ptr ? String("(garbage)") : String("(invalid)"));
+			}
+
+			json->end_object();
+		} return;
+
+		case CODE_TYPE_STRUCT: {
+			json->begin_array();
+			for (auto &member : type->members)
+			{
+				if (reader->failed) break;
+				convert_symbol(conv, convert_string(conv, member.name), member.type, address + member.offset, memory, bytes ? bytes + member.offset : nullptr);
+			}
+			json->end_array();
+		} return;
+
+		case CODE_TYPE_ARRAY_VIEW: {
+			auto arr_count = trace_read_raw<int64_t>(reader);
+			auto arr_data  = trace_read_raw<uint64_t>(reader);
+			auto mem_type  = (Memory_Type)trace_read_raw<uint8_t>(reader);
+
+			if (type->soa)
+			{
+				convert_soa(conv, type, arr_data, (uint64_t)arr_count, mem_type, nullptr);
+				return;
+			}
+
+			auto element = convert_find(conv->types, type->element);
+			uint64_t element_size = element ? element->runtime_size : 0;
+
+			json->begin_array();
+			for (int64_t index = 0; index < arr_count && !reader->failed; ++index)
+			{
+				convert_value(conv, type->element, arr_data + index * element_size, mem_type, nullptr);
+			}
+			json->end_array();
+		} return;
+
+		case CODE_TYPE_STATIC_ARRAY: {
+			if (type->soa)
+			{
+				convert_soa(conv, type, address, type->count, memory, bytes);
+				return;
+			}
+
+			auto element = convert_find(conv->types, type->element);
+			uint64_t element_size = element ? element->runtime_size : 0;
+
+			json->begin_array();
+			for (uint64_t index = 0; index < type->count && !reader->failed; ++index)
+			{
+				convert_value(conv, type->element, address + index * element_size, memory, bytes ? bytes + index * element_size : nullptr);
+			}
+			json->end_array();
+		} return;
+	}
+
+	reader->failed = true;
+	json->write_single_value("(null)");
+}
+
+static void convert_symbol(Trace_Converter *conv, String name, uint64_t type_id, uint64_t address, Memory_Type memory, uint8_t *bytes)
+{
+	auto json = &conv->json;
+
+	json->begin_object();
+	json->write_key_value_formatted("name", "%", name);
+	json->write_key_value_formatted("type", "%", convert_type_name(conv, type_id));
+	json->write_key_value_formatted("address", "0x%", (void *)address);
+	json->write_key_value_formatted("memory", "%", memory_type_string(memory));
+
+	json->write_key("value");
+	convert_value(conv, type_id, address, memory, bytes);
+
+	json->end_object();
+}
+
+// The #soa elements are written gathered, only the addresses of their members are in the block of each member
+static void convert_soa(Trace_Converter *conv, Trace_Type *type, uint64_t address, uint64_t count, Memory_Type memory, uint8_t *bytes)
+{
+	auto json   = &conv->json;
+	auto reader = &conv->reader;
+
+	auto element = convert_find(conv->types, type->element);
+	if (!element || element->kind != CODE_TYPE_STRUCT)
+	{
+		reader->failed = true;
+		json->write_single_value("(null)");
+		return;
+	}
+
+	json->begin_array();
+	for (uint64_t index = 0; index < count && !reader->failed; ++index)
+	{
+		uint8_t *element_bytes = nullptr;
+		if (bytes)
+			element_bytes = bytes + index * element->runtime_size;
+		else if (!element->indirection)
+			element_bytes = trace_read_bytes(reader, element->runtime_size);
+
+		json->begin_array();
+		for (auto &member : element->members)
+		{
+			if (reader->failed) break;
+
+			auto member_type = convert_find(conv->types, member.type);
+			uint64_t member_size = member_type ? member_type->runtime_size : 0;
+			uint64_t member_address = address + count * member.offset + index * member_size;
+
+			convert_symbol(conv, convert_string(conv, member.name), member.type, member_address, memory, element_bytes ? element_bytes + member.offset : nullptr);
+		}
+		json->end_array();
+	}
+	json->end_array();
+}
+
+static void convert_variables(Trace_Converter *conv)
+{
+	auto reader = &conv->reader;
+
+	while (!reader->failed)
+	{
+		auto id = trace_read_varint(reader);
+		if (id == 0) break;
+
+		auto address = trace_read_raw<uint64_t>(reader);
+		auto memory  = (Memory_Type)trace_read_raw<uint8_t>(reader);
+
+		auto symbol = convert_find(conv->symbols, id);
+		if (!symbol)
+		{
+			reader->failed = true;
+			break;
+		}
+
+		convert_symbol(conv, convert_string(conv, symbol->name), symbol->type, address, memory, nullptr);
+	}
+}
+
+static void convert_step(Trace_Converter *conv)
+{
+	auto json   = &conv->json;
+	auto reader = &conv->reader;
+
+	auto intercept   = (Intercept_Kind)trace_read_raw<uint8_t>(reader);
+	auto line_number = trace_read_varint(reader);
+	auto exe_dt      = trace_read_raw<float>(reader);
+	auto exe_time    = trace_read_raw<float>(reader);
+
+	json->begin_object();
+
+	if (intercept == INTERCEPT_PROCEDURE_CALL || intercept == INTERCEPT_PROCEDURE_RETURN)
+	{
+		const char *intercept_type = (intercept == INTERCEPT_PROCEDURE_CALL) ? "call" : "return";
+		json->write_key_value_formatted("intercept", "procedure_%", intercept_type);
+		json->write_key_value("line_number", (int64_t)line_number);
+	}
+	else
+	{
+		json->write_key_value_formatted("intercept", "statement");
+		json->write_key_value("line_number", line_number);
+	}
+
+	json->write_key_value("exe_dt", exe_dt);
+	json->write_key_value("exe_time", exe_time);
+
+	json->write_key("globals");
+	json->begin_array();
+	convert_variables(conv);
+	json->end_array();
+
+	json->write_key("callstack");
+	json->begin_array();
+	while (!reader->failed)
+	{
+		auto procedure = trace_read_varint(reader);
+		if (procedure == 0) break;
+
+		json->begin_object();
+		json->write_key_value_formatted("procedure", "%", convert_string(conv, procedure));
+		json->write_key("variables");
+		json->begin_array();
+		convert_variables(conv);
+		json->end_array();
+		json->end_object();
+	}
+	json->end_array();
+
+	auto console_out_length = trace_read_varint(reader);
+	auto console_out        = trace_read_bytes(reader, (int64_t)console_out_length);
+	if (console_out)
+		WriteBuffer(&conv->console_out, console_out, console_out_length);
+
+	if (trace_read_raw<uint8_t>(reader))
+	{
+		auto console_in_length = trace_read_varint(reader);
+		auto console_in        = trace_read_bytes(reader, (int64_t)console_in_length);
+		conv->console_in = console_in ? String(console_in, console_in_length) : String();
+	}
+
+	json->write_key("console_out");
+	json->begin_string_value();
+	json->append_builder(&conv->console_out);
+	json->end_string_value();
+
+	json->write_key_value_formatted("console_in", "%", conv->console_in);
+
+	json->end_object();
+}
+
+static void convert_type(Trace_Converter *conv)
+{
+	auto reader = &conv->reader;
+
+	auto id   = trace_read_varint(reader);
+	auto type = convert_define(conv->types, id);
+
+	type->defined      = true;
+	type->kind         = trace_read_raw<uint8_t>(reader);
+	type->runtime_size = trace_read_varint(reader);
+	type->name         = trace_read_varint(reader);
+	type->indirection  = trace_read_raw<uint8_t>(reader) != 0;
+
+	switch (type->kind)
+	{
+		case CODE_TYPE_POINTER: {
+			type->element = trace_read_varint(reader);
+		} break;
+
+		case CODE_TYPE_ARRAY_VIEW: {
+			type->element = trace_read_varint(reader);
+			type->soa     = trace_read_raw<uint8_t>(reader) != 0;
+		} break;
+
+		case CODE_TYPE_STRUCT: {
+			auto count = trace_read_varint(reader);
+			for (uint64_t index = 0; index < count && !reader->failed; ++index)
+			{
+				Trace_Member member;
+				member.name   = trace_read_varint(reader);
+				member.type   = trace_read_varint(reader);
+				member.offset = trace_read_varint(reader);
+				type->members.Add(member);
+			}
+		} break;
+
+		case CODE_TYPE_STATIC_ARRAY: {
+			type->count   = trace_read_varint(reader);
+			type->element = trace_read_varint(reader);
+			type->soa     = trace_read_raw<uint8_t>(reader) != 0;
+		} break;
+
+		case CODE_TYPE_SIZED_INTEGER: {
+			type->is_signed = trace_read_raw<uint8_t>(reader) != 0;
+		} break;
+	}
+}
+
+static bool convert_trace(Trace_Converter *conv)
+{
+	auto json   = &conv->json;
+	auto reader = &conv->reader;
+
+	auto magic = trace_read_bytes(reader, sizeof(TRACE_BINARY_MAGIC));
+	if (!magic || memcmp(magic, TRACE_BINARY_MAGIC, sizeof(TRACE_BINARY_MAGIC)) != 0)
+		return false;
+
+	auto version = trace_read_raw<uint8_t>(reader);
+	if (version != TRACE_FORMAT_VERSION)
+		return false;
+
+	json->begin_object();
+
+	json->write_key_value("trace_version", (int)version);
+	json->write_key_value_formatted("trace_format", "%", trace_format_string(TRACE_FORMAT_FULL));
+
+	json->write_key("error");
+	json->begin_string_value();
+	json->end_string_value();
+
+	json->write_key("runtime");
+	json->begin_array();
+
+	while (!reader->failed)
+	{
+		auto record = (Trace_Record)trace_read_raw<uint8_t>(reader);
+
+		if (record == TRACE_RECORD_STRING)
+		{
+			auto id     = trace_read_varint(reader);
+			auto length = trace_read_varint(reader);
+			auto data   = trace_read_bytes(reader, (int64_t)length);
+			*convert_define(conv->strings, id) = String(data, data ? length : 0);
+		}
+		else if (record == TRACE_RECORD_TYPE)
+		{
+			convert_type(conv);
+		}
+		else if (record == TRACE_RECORD_SYMBOL)
+		{
+			auto id     = trace_read_varint(reader);
+			auto symbol = convert_define(conv->symbols, id);
+			symbol->name = trace_read_varint(reader);
+			symbol->type = trace_read_varint(reader);
+		}
+		else if (record == TRACE_RECORD_STEP)
+		{
+			convert_step(conv);
+		}
+		else if (record == TRACE_RECORD_END)
+		{
+			auto exe_time       = trace_read_raw<float>(reader);
+			auto bss_size       = trace_read_varint(reader);
+			auto stack_size     = trace_read_varint(reader);
+			auto heap_allocated = trace_read_varint(reader);
+			auto heap_freed     = trace_read_varint(reader);
+			auto step_count     = trace_read_varint(reader);
+			bool complete       = trace_read_raw<uint8_t>(reader) != 0;
+			bool budget         = trace_read_raw<uint8_t>(reader) != 0;
+			auto map_length     = trace_read_varint(reader);
+			auto map            = trace_read_bytes(reader, (int64_t)map_length);
+
+			if (!map)
+				return false;
+
+			json->end_array();
+
+			json->write_key_value("exe_time", exe_time);
+			json->write_key_value("bss_size", bss_size);
+			json->write_key_value("stack_size", stack_size);
+			json->write_key_value("heap_allocated", heap_allocated);
+			json->write_key_value("heap_freed", heap_freed);
+			json->write_key_value("heap_leaked", heap_allocated - heap_freed);
+			json->write_key_value("step_count", step_count);
+			json->write_key_value("complete", complete);
+			json->write_key_value("budget_exceeded", budget);
+
+			json->write_key("map");
+			WriteBuffer(json->builder, map, map_length);
+
+			json->end_object();
+			return true;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	return false;
+}
+
+int main(int argc, char **argv)
+{
+	InitThreadContext(0);
+
+	if (argc != 2 && argc != 3) {
+		fprintf(stderr, "Error: Expected trace file\n");
+		fprintf(stderr, "\tUsage: %s <trace> [output]\n\n", argv[0]);
+		return 1;
+	}
+
+	String trace = read_entire_file(argv[1]);
+	if (!trace.data) {
+		fprintf(stderr, "File \"%s\" could not be read.\n\n", argv[1]);
+		return 1;
+	}
+
+	FILE *out = stdout;
+	if (argc == 3) {
+		out = fopen(argv[2], "wb");
+		if (!out) {
+			fprintf(stderr, "File \"%s\" could not be opened.\n\n", argv[2]);
+			return 1;
+		}
+	}
+
+	// The compile errors are reported as json in every trace format
+	if (trace.length && trace.data[0] == '{') {
+		fwrite(trace.data, 1, trace.length, out);
+		return 0;
+	}
+
+	auto conv = new Trace_Converter;
+	conv->reader.data     = trace.data;
+	conv->reader.length   = trace.length;
+	conv->reader.position = 0;
+	conv->reader.failed   = false;
+
+	String_Builder builder;
+	conv->json.builder = &builder;
+
+	if (!convert_trace(conv)) {
+		fprintf(stderr, "File \"%s\" is not a valid binary trace.\n\n", argv[1]);
+		return 1;
+	}
+
+	for (auto buk = &builder.head; buk; buk = buk->next) {
+		fwrite(buk->data, 1, buk->written, out);
+	}
+
+	if (out != stdout)
+		fclose(out);
+
+	return 0;
+}
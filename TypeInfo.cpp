@@ -0,0 +1,209 @@
+#include "TypeInfo.h"
+#include "StringBuilder.h"
+
+// The names of the nested types are written in place, the cache of a struct may not be
+// published yet when its members point back to it
+static void type_info_write_name(String_Builder *builder, Code_Type *type)
+{
+	switch (type->kind)
+	{
+		case CODE_TYPE_NULL: Write(builder, "void"); return;
+		case CODE_TYPE_CHARACTER: Write(builder, "byte"); return;
+		case CODE_TYPE_INTEGER: Write(builder, "int"); return;
+		case CODE_TYPE_REAL: Write(builder, "float"); return;
+		case CODE_TYPE_BOOL: Write(builder, "bool"); return;
+		case CODE_TYPE_SIZED_INTEGER: WriteFormatted(builder, "%%", ((Code_Type_Sized_Integer *)type)->is_signed ? "i" : "u", type->runtime_size * 8); return;
+		case CODE_TYPE_SIZED_REAL: Write(builder, "f32"); return;
+
+		case CODE_TYPE_POINTER: {
+			Write(builder, "*");
+			type_info_write_name(builder, ((Code_Type_Pointer *)type)->base_type);
+			return;
+		}
+
+		case CODE_TYPE_PROCEDURE: {
+			auto proc = (Code_Type_Procedure *)type;
+			Write(builder, "proc(");
+			for (int64_t index = 0; index < proc->argument_count; ++index)
+			{
+				auto flags = code_type_argument_flags(proc, index);
+				if (flags & SYMBOL_BIT_REFERENCE)
+				{
+					Write(builder, (flags & SYMBOL_BIT_READ_ONLY) ? "in " : "ref ");
+					type_info_write_name(builder, ((Code_Type_Pointer *)proc->arguments[index])->base_type);
+				}
+				else
+				{
+					type_info_write_name(builder, proc->arguments[index]);
+				}
+				if (index < proc->argument_count - 1) Write(builder, ", ");
+			}
+			Write(builder, ")");
+
+			if (proc->return_type)
+			{
+				Write(builder, "->");
+				type_info_write_name(builder, proc->return_type);
+			}
+			return;
+		}
+
+		case CODE_TYPE_STRUCT: {
+			auto strt = (Code_Type_Struct *)type;
+			Write(builder, strt->name);
+			return;
+		}
+
+		case CODE_TYPE_ARRAY_VIEW: {
+			auto arr = (Code_Type_Array_View *)type;
+			Write(builder, arr->soa ? "#soa []" : "[]");
+			type_info_write_name(builder, arr->element_type);
+			return;
+		}
+
+		case CODE_TYPE_STATIC_ARRAY: {
+			auto arr = (Code_Type_Static_Array *)type;
+			WriteFormatted(builder, arr->soa ? "#soa [%]" : "[%]", arr->element_count);
+			type_info_write_name(builder, arr->element_type);
+			return;
+		}
+
+		NoDefaultCase();
+	}
+}
+
+static bool type_info_indirection(Code_Type *type)
+{
+	switch (type->kind)
+	{
+		case CODE_TYPE_NULL: return false;
+		case CODE_TYPE_CHARACTER: return false;
+		case CODE_TYPE_INTEGER: return false;
+		case CODE_TYPE_REAL: return false;
+		case CODE_TYPE_BOOL: return false;
+		case CODE_TYPE_SIZED_INTEGER: return false;
+		case CODE_TYPE_SIZED_REAL: return false;
+		case CODE_TYPE_PROCEDURE: return false;
+		case CODE_TYPE_POINTER: return true;
+		case CODE_TYPE_ARRAY_VIEW: return true;
+
+		case CODE_TYPE_STRUCT: {
+			auto _struct = (Code_Type_Struct *)type;
+			for (int64_t index = 0; index < _struct->member_count; ++index)
+			{
+				if (type_info(_struct->members[index].type)->indirection)
+					return true;
+			}
+			return false;
+		}
+
+		case CODE_TYPE_STATIC_ARRAY: {
+			auto arr = (Code_Type_Static_Array *)type;
+			return type_info(arr->element_type)->indirection;
+		}
+
+		NoDefaultCase();
+	}
+
+	return false;
+}
+
+static void type_info_build_ops(Array<Type_Op> *ops, Code_Type *type, uint32_t offset)
+{
+	Type_Op op;
+	op.offset = offset;
+	op.type   = type;
+
+	switch (type->kind)
+	{
+		case CODE_TYPE_NULL: op.kind = TYPE_OP_NULL; ops->Add(op); return;
+		case CODE_TYPE_CHARACTER: op.kind = TYPE_OP_CHARACTER; ops->Add(op); return;
+		case CODE_TYPE_INTEGER: op.kind = TYPE_OP_INTEGER; ops->Add(op); return;
+		case CODE_TYPE_REAL: op.kind = TYPE_OP_REAL; ops->Add(op); return;
+		case CODE_TYPE_BOOL: op.kind = TYPE_OP_BOOL; ops->Add(op); return;
+		case CODE_TYPE_SIZED_INTEGER: op.kind = TYPE_OP_SIZED_INTEGER; ops->Add(op); return;
+		case CODE_TYPE_SIZED_REAL: op.kind = TYPE_OP_SIZED_REAL; ops->Add(op); return;
+		case CODE_TYPE_PROCEDURE: op.kind = TYPE_OP_PROCEDURE; ops->Add(op); return;
+		case CODE_TYPE_POINTER: op.kind = TYPE_OP_POINTER; ops->Add(op); return;
+		case CODE_TYPE_ARRAY_VIEW: op.kind = TYPE_OP_ARRAY_VIEW; ops->Add(op); return;
+
+		case CODE_TYPE_STRUCT: {
+			auto _struct = (Code_Type_Struct *)type;
+
+			op.kind = TYPE_OP_STRUCT;
+			auto struct_index = ops->count;
+			ops->Add(op);
+
+			for (int64_t index = 0; index < _struct->member_count; ++index)
+			{
+				auto member = &_struct->members[index];
+
+				Type_Op member_op;
+				member_op.kind   = TYPE_OP_MEMBER;
+				member_op.offset = (uint32_t)member->offset;
+				member_op.name   = member->name;
+				member_op.type   = member->type;
+
+				auto member_index = ops->count;
+				ops->Add(member_op);
+				type_info_build_ops(ops, member->type, 0);
+				(*ops)[member_index].count = (uint32_t)(ops->count - member_index - 1);
+			}
+
+			(*ops)[struct_index].count = (uint32_t)(ops->count - struct_index - 1);
+			return;
+		}
+
+		case CODE_TYPE_STATIC_ARRAY: {
+			auto arr = (Code_Type_Static_Array *)type;
+
+			if (arr->soa)
+			{
+				op.kind   = TYPE_OP_SOA_ARRAY;
+				op.repeat = arr->element_count;
+				ops->Add(op);
+				return;
+			}
+
+			op.kind   = TYPE_OP_ARRAY;
+			op.repeat = arr->element_count;
+			op.stride = arr->element_type->runtime_size;
+
+			auto array_index = ops->count;
+			ops->Add(op);
+			type_info_build_ops(ops, arr->element_type, 0);
+			(*ops)[array_index].count = (uint32_t)(ops->count - array_index - 1);
+			return;
+		}
+
+		NoDefaultCase();
+	}
+}
+
+Type_Info *type_info(Code_Type *type)
+{
+	auto cached = type->info.load(std::memory_order_acquire);
+	if (cached)
+		return cached;
+
+	auto info = new Type_Info;
+
+	String_Builder builder;
+	type_info_write_name(&builder, type);
+	info->name = BuildString(&builder);
+	FreeBuilder(&builder);
+
+	info->indirection = type_info_indirection(type);
+	type_info_build_ops(&info->ops, type, 0);
+
+	// Several threads may build the info of a type at once, the first one to finish is kept
+	if (!type->info.compare_exchange_strong(cached, info, std::memory_order_acq_rel, std::memory_order_acquire))
+	{
+		MemoryFree(info->name.data, info->name.length + 1);
+		Free(&info->ops);
+		delete info;
+		return cached;
+	}
+
+	return info;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "CodeNode.h"
+
+enum Type_Op_Kind : uint8_t
+{
+	TYPE_OP_NULL,
+	TYPE_OP_CHARACTER,
+	TYPE_OP_INTEGER,
+	TYPE_OP_REAL,
+	TYPE_OP_BOOL,
+	TYPE_OP_PROCEDURE,
+	TYPE_OP_POINTER,
+	TYPE_OP_ARRAY_VIEW,
+	TYPE_OP_STRUCT,
+	TYPE_OP_MEMBER,
+	TYPE_OP_ARRAY,
+	TYPE_OP_SIZED_INTEGER,
+	TYPE_OP_SIZED_REAL,
+	TYPE_OP_SOA_ARRAY,
+};
+
+// The STRUCT, MEMBER and ARRAY ops own the `count` ops that follow them,
+// ARRAY repeats them `repeat` times with the `stride` between the elements.
+// SOA_ARRAY owns no ops, its `repeat` elements are read member by member from the struct of `type`.
+// The offsets of the owned ops are relative to the offset of the owner.
+struct Type_Op
+{
+	Type_Op_Kind kind   = TYPE_OP_NULL;
+	uint32_t     offset = 0;
+	uint32_t     count  = 0;
+	uint32_t     repeat = 0;
+	uint32_t     stride = 0;
+	String       name;
+	Code_Type *  type   = nullptr;
+};
+
+struct Type_Info
+{
+	String         name;
+	bool           indirection = false;
+	Array<Type_Op> ops;
+};
+
+// Built on the first use and cached in the type
+Type_Info *type_info(Code_Type *type);
+
+inline String type_name(Code_Type *type)
+{
+	if (!type) return "void";
+	return type_info(type)->name;
+}
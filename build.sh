@@ -15,5 +15,8 @@ fi
 
 mkdir -p bin
 
-${COMPILER} -g -std=c++17 -DKANO_SERVER -DASSERTION_HANDLED Main.cpp Server.cpp Lexer.cpp Parser.cpp Resolver.cpp Printer.cpp StringBuilder.cpp Interp.cpp ./Kr/KrCommon.cpp ./Kr/KrBasic.cpp -o bin/Kano -lpthread
-${COMPILER} -g -std=c++17 -DASSERTION_HANDLED Compiler.cpp Lexer.cpp Parser.cpp Resolver.cpp Printer.cpp StringBuilder.cpp Interp.cpp ./Kr/KrCommon.cpp ./Kr/KrBasic.cpp -o bin/kanoc -lpthread
+${COMPILER} -g -std=c++17 -DKANO_SERVER -DHTTPSERVER_IO_URING -DASSERTION_HANDLED Main.cpp Server.cpp Lexer.cpp Parser.cpp Resolver.cpp Printer.cpp StringBuilder.cpp Interp.cpp TypeInfo.cpp Metrics.cpp ./Kr/KrCommon.cpp ./Kr/KrBasic.cpp -o bin/Kano -lpthread
+${COMPILER} -g -std=c++17 -DASSERTION_HANDLED Compiler.cpp Lexer.cpp Parser.cpp Resolver.cpp Printer.cpp StringBuilder.cpp Interp.cpp TypeInfo.cpp ./Kr/KrCommon.cpp ./Kr/KrBasic.cpp -o bin/kanoc -lpthread
+${COMPILER} -g -std=c++17 -DASSERTION_HANDLED TraceConvert.cpp StringBuilder.cpp ./Kr/KrCommon.cpp ./Kr/KrBasic.cpp -o bin/kano-trace -lpthread
+${COMPILER} -O2 -std=c++17 -DASSERTION_HANDLED FormatBench.cpp StringBuilder.cpp ./Kr/KrCommon.cpp ./Kr/KrBasic.cpp -o bin/format-bench -lpthread
+${COMPILER} -g -std=c++17 -DKANO_SERVER -DKANO_BENCH -DHTTPSERVER_IO_URING -DASSERTION_HANDLED Bench.cpp Main.cpp Server.cpp Lexer.cpp Parser.cpp Resolver.cpp Printer.cpp StringBuilder.cpp Interp.cpp TypeInfo.cpp Metrics.cpp ./Kr/KrCommon.cpp ./Kr/KrBasic.cpp -o bin/kano-bench -lpthread
@@ -77,6 +77,22 @@
 *       request + headers cannot fit in this size the request body will be
 *       streamed in.
 *
+*     HTTPSERVER_IO_URING - not defined by default - On Linux, drive the
+*       sockets through io_uring instead of epoll. Accepts, reads and sends are
+*       queued and submitted together with a single system call per loop
+*       iteration. The server falls back to epoll when the kernel does not
+*       allow io_uring.
+*
+*     HTTP_URING_ENTRIES - default 256 - The size of the io_uring submission
+*       queue.
+*
+*     HTTP_URING_BUFFER_COUNT - default 64 - The number of read buffers that
+*       are registered with io_uring. Reads fall back to unregistered buffers
+*       when all of them are in use.
+*
+*     HTTP_URING_BUFFER_SIZE - default 16384 (16KB) - The size of each
+*       registered read buffer.
+*
 *   For more details see the documentation of the interface and the example
 *   below.
 *
@@ -99,6 +115,7 @@ struct http_string_s {
 struct http_server_s;
 struct http_request_s;
 struct http_response_s;
+struct iovec;
 
 // Returns the event loop id that the server is running on. This will be an
 // epoll fd when running on Linux or a kqueue on BSD. This can be used to
@@ -237,10 +254,29 @@ void http_response_header(struct http_response_s* response, char const * key, ch
 // http_respond has been called.
 void http_response_body(struct http_response_s* response, char const * body, int length);
 
+// Set the response body as a list of buffers. The buffers are written to the
+// socket with writev instead of being copied into the response buffer. The
+// iovec array itself is copied, but the memory it points to must stay valid
+// until the write has completed or the session has ended, at which point
+// release (if not NULL) is called with userdata.
+void http_response_body_iov(
+  struct http_response_s* response,
+  struct iovec const * iov,
+  int iovcnt,
+  void (*release)(void*),
+  void* userdata
+);
+
 // Starts writing the response to the client. Any memory allocated for the
 // response body or response headers is safe to free after this call.
 void http_respond(struct http_request_s* request, struct http_response_s* response);
 
+// Responds to the request from any thread. The request handler returns without
+// responding and the request is kept, without timing out, until this is called.
+// The event loop of the request is woken up and sends the response on its own
+// thread.
+void http_respond_async(struct http_request_s* request, struct http_response_s* response);
+
 // Writes a chunk to the client. The notify_done callback will be called when
 // the write is complete. This call consumes the response so a new response
 // will need to be initialized for each chunk. The response status of the
@@ -314,6 +350,9 @@ int main() {
 #ifndef _POSIX_C_SOURCE 
 #define _POSIX_C_SOURCE 199309L
 #endif
+#if defined(HTTPSERVER_IO_URING) && __has_include(<linux/io_uring.h>)
+#define URING
+#endif
 #else
 #define KQUEUE
 #endif
@@ -330,7 +369,10 @@ int main() {
 #include <signal.h>
 #include <limits.h>
 #include <assert.h>
+#include <stddef.h>
+#include <pthread.h>
 #include <arpa/inet.h>
+#include <sys/uio.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 
@@ -339,6 +381,13 @@ int main() {
 #else
 #include <sys/epoll.h>
 #include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#endif
+
+#ifdef URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
 #endif
 
 // *** macro definitions
@@ -354,6 +403,14 @@ int main() {
 
 #define HTTP_MAX_HEADER_COUNT 127
 
+#define HTTP_URING_ENTRIES 256
+#define HTTP_URING_BUFFER_COUNT 64
+#define HTTP_URING_BUFFER_SIZE 16384
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
 #define HTTP_FLAG_SET(var, flag) var |= flag
 #define HTTP_FLAG_CLEAR(var, flag) var &= ~flag
 #define HTTP_FLAG_CHECK(var, flag) (var & flag)
@@ -448,26 +505,51 @@ typedef struct http_request_s {
   int timeout;
   struct http_server_s* server;
   http_token_dyn_t tokens;
+  struct iovec* iov;
+  int iov_index;
+  int iov_count;
+  void (*iov_release)(void*);
+  void* iov_userdata;
+#ifdef URING
+  struct http_request_s* uring_next;
+  struct http_request_s* uring_prev;
+  int uring_pending;
+  int uring_direct;
+#endif
   char flags;
 } http_request_t;
 
+// Response given from another thread, waiting for the event loop
+typedef struct hs_posted_s {
+  struct http_request_s* request;
+  struct http_response_s* response;
+  struct hs_posted_s* next;
+} hs_posted_t;
+
 typedef struct http_server_s {
 #ifdef KQUEUE
   void (*handler)(struct kevent* ev);
 #else
   epoll_cb_t handler;
   epoll_cb_t timer_handler;
+  epoll_cb_t wakeup_handler;
 #endif
   int64_t memused;
   int socket;
   int port;
   int loop;
   int timerfd;
+  int wakeup;
+  pthread_mutex_t posted_lock;
+  hs_posted_t* posted;
   socklen_t len;
   void (*request_handler)(http_request_t*);
   struct sockaddr_in addr;
   void* data;
   char date[32];
+#ifdef URING
+  struct hs_uring_s* uring;
+#endif
 } http_server_t;
 
 typedef struct http_header_s {
@@ -479,6 +561,10 @@ typedef struct http_header_s {
 typedef struct http_response_s {
   http_header_t* headers;
   char const * body;
+  struct iovec* body_iov;
+  int body_iov_count;
+  void (*body_iov_release)(void*);
+  void* body_iov_userdata;
   int content_length;
   int status;
 } http_response_t;
@@ -540,6 +626,19 @@ void hs_server_listen_cb(struct epoll_event* ev);
 void hs_session_io_cb(struct epoll_event* ev);
 void hs_server_timer_cb(struct epoll_event* ev);
 void hs_request_timer_cb(struct epoll_event* ev);
+void hs_server_wakeup_cb(struct epoll_event* ev);
+
+#endif
+
+void hs_wakeup(struct http_server_s* serv);
+void hs_respond_posted(struct http_server_s* serv);
+
+#ifdef URING
+
+void hs_uring_read(http_request_t* request);
+void hs_uring_write(http_request_t* request);
+void hs_uring_keep_alive(http_request_t* request);
+void hs_uring_end_session(http_request_t* request);
 
 #endif
 
@@ -724,14 +823,33 @@ static int const hs_token_start_states[] = {
 
 // *** input stream ***
 
-int hs_stream_read_socket(hs_stream_t* stream, int socket, int64_t* memused) {
-  if (stream->index < stream->length) return 1;
+void hs_stream_alloc(hs_stream_t* stream, int64_t* memused) {
   if (!stream->buf) {
     *memused += HTTP_REQUEST_BUF_SIZE;
     stream->buf = (char*)calloc(1, HTTP_REQUEST_BUF_SIZE);
     assert(stream->buf != NULL);
     stream->capacity = HTTP_REQUEST_BUF_SIZE;
   }
+}
+
+// Grows the buffer until it can hold size bytes, up to the max request size
+void hs_stream_grow(hs_stream_t* stream, int64_t size, int64_t* memused) {
+  if (size <= stream->capacity || stream->capacity == HTTP_MAX_REQUEST_BUF_SIZE) return;
+  *memused -= stream->capacity;
+  while (stream->capacity < size && stream->capacity < HTTP_MAX_REQUEST_BUF_SIZE) {
+    stream->capacity *= 2;
+  }
+  if (stream->capacity > HTTP_MAX_REQUEST_BUF_SIZE) {
+    stream->capacity = HTTP_MAX_REQUEST_BUF_SIZE;
+  }
+  *memused += stream->capacity;
+  stream->buf = (char*)realloc(stream->buf, stream->capacity);
+  assert(stream->buf != NULL);
+}
+
+int hs_stream_read_socket(hs_stream_t* stream, int socket, int64_t* memused) {
+  if (stream->index < stream->length) return 1;
+  hs_stream_alloc(stream, memused);
   int bytes;
   do {
     bytes = read(
@@ -1028,17 +1146,51 @@ void hs_bind_localhost(int s, struct sockaddr_in* addr, const char* ipaddr, int
   }
 }
 
+void hs_advance_iov(http_request_t* session, int bytes) {
+  while (bytes > 0 && session->iov_index < session->iov_count) {
+    struct iovec* iov = &session->iov[session->iov_index];
+    if ((size_t)bytes < iov->iov_len) {
+      iov->iov_base = (char*)iov->iov_base + bytes;
+      iov->iov_len -= bytes;
+      return;
+    }
+    bytes -= iov->iov_len;
+    session->iov_index++;
+  }
+}
+
 int hs_write_client_socket(http_request_t* session) {
-  int bytes = write(
-    session->socket,
-    session->stream.buf + session->stream.total_bytes,
-    session->stream.length - session->stream.total_bytes
-  );
+  int bytes;
+  if (session->iov) {
+    int count = session->iov_count - session->iov_index;
+    if (count > IOV_MAX) count = IOV_MAX;
+    bytes = writev(session->socket, session->iov + session->iov_index, count);
+    if (bytes > 0) hs_advance_iov(session, bytes);
+  } else {
+    bytes = write(
+      session->socket,
+      session->stream.buf + session->stream.total_bytes,
+      session->stream.length - session->stream.total_bytes
+    );
+  }
   if (bytes > 0) session->stream.total_bytes += bytes;
   return errno == EPIPE ? 0 : 1;
 }
 
+void hs_free_iov(http_request_t* session) {
+  if (session->iov) {
+    free(session->iov);
+    session->iov = NULL;
+    session->iov_index = 0;
+    session->iov_count = 0;
+    if (session->iov_release) session->iov_release(session->iov_userdata);
+    session->iov_release = NULL;
+    session->iov_userdata = NULL;
+  }
+}
+
 void hs_free_buffer(http_request_t* session) {
+  hs_free_iov(session);
   if (session->stream.buf) {
     free(session->stream.buf);
     session->server->memused -= session->stream.capacity;
@@ -1058,6 +1210,9 @@ void hs_init_session(http_request_t* session) {
 }
 
 void hs_end_session(http_request_t* session) {
+#ifdef URING
+  if (session->server->uring) return hs_uring_end_session(session);
+#endif
   hs_delete_events(session);
   close(session->socket);
   hs_free_buffer(session);
@@ -1071,8 +1226,12 @@ void hs_reset_timeout(http_request_t* request, int time) {
 }
 
 void hs_read_and_process_request(http_request_t* request);
+void hs_write_complete(http_request_t* request);
 
 void hs_write_response(http_request_t* request) {
+#ifdef URING
+  if (request->server->uring) return hs_uring_write(request);
+#endif
   if (!hs_write_client_socket(request)) {
     HTTP_FLAG_SET(request->flags, HTTP_END_SESSION);
     return;
@@ -1083,7 +1242,14 @@ void hs_write_response(http_request_t* request) {
     hs_add_write_event(request);
     request->state = HTTP_SESSION_WRITE;
     hs_reset_timeout(request, HTTP_REQUEST_TIMEOUT);
-  } else if (HTTP_FLAG_CHECK(request->flags, HTTP_CHUNKED_RESPONSE)) {
+  } else {
+    hs_write_complete(request);
+  }
+}
+
+// Called once the whole buffer has been written
+void hs_write_complete(http_request_t* request) {
+  if (HTTP_FLAG_CHECK(request->flags, HTTP_CHUNKED_RESPONSE)) {
     // All bytes of the chunk were written and we need to get the next chunk
     // from the application.
     request->state = HTTP_SESSION_WRITE;
@@ -1095,12 +1261,18 @@ void hs_write_response(http_request_t* request) {
       request->state = HTTP_SESSION_INIT;
       hs_free_buffer(request);
       hs_reset_timeout(request, HTTP_KEEP_ALIVE_TIMEOUT);
+#ifdef URING
+      // There is no readiness event to wait for, the read is queued right away
+      if (request->server->uring) hs_uring_keep_alive(request);
+#endif
     } else {
       HTTP_FLAG_SET(request->flags, HTTP_END_SESSION);
     }
   }
 }
 
+void hs_process_request_stream(http_request_t* request);
+
 void hs_error_response(http_request_t* request, int code, char const * message) {
   struct http_response_s* response = http_response_init();
   http_response_status(response, code);
@@ -1112,13 +1284,28 @@ void hs_error_response(http_request_t* request, int code, char const * message)
 
 void hs_read_and_process_request(http_request_t* request) {
   request->state = HTTP_SESSION_READ;
-  http_token_t token = {0, 0, 0};
   hs_reset_timeout(request, HTTP_REQUEST_TIMEOUT);
+#ifdef URING
+  if (request->server->uring) {
+    // Parse what is left in the buffer before queueing another read
+    if (request->stream.index < request->stream.length) {
+      hs_process_request_stream(request);
+    } else {
+      hs_uring_read(request);
+    }
+    return;
+  }
+#endif
   int rc = hs_stream_read_socket(&request->stream, request->socket, &request->server->memused);
   if (rc == 0) {
     HTTP_FLAG_SET(request->flags, HTTP_END_SESSION);
     return;
   }
+  hs_process_request_stream(request);
+}
+
+void hs_process_request_stream(http_request_t* request) {
+  http_token_t token = {0, 0, 0};
   do {
     token = http_parse(&request->parser, &request->stream);
     if (token.type != HS_TOK_NONE) http_token_dyn_push(&request->tokens, token);
@@ -1194,11 +1381,12 @@ void hs_accept_connections(http_server_t* server) {
 }
 
 void hs_generate_date_time(char* datetime) {
+  // Every reactor thread formats its own date, gmtime would share one buffer
   time_t rawtime;
-  struct tm * timeinfo;
+  struct tm timeinfo;
   time(&rawtime);
-  timeinfo = gmtime(&rawtime);
-  strftime(datetime, 32, "%a, %d %b %Y %T GMT", timeinfo);
+  gmtime_r(&rawtime, &timeinfo);
+  strftime(datetime, 32, "%a, %d %b %Y %T GMT", &timeinfo);
 }
 
 http_server_t* http_server_init(int port, void (*handler)(http_request_t*)) {
@@ -1207,6 +1395,8 @@ http_server_t* http_server_init(int port, void (*handler)(http_request_t*)) {
   serv->port = port;
   serv->memused = 0;
   serv->handler = hs_server_listen_cb;
+  serv->posted = NULL;
+  pthread_mutex_init(&serv->posted_lock, NULL);
   hs_server_init(serv);
   hs_generate_date_time(serv->date);
   serv->request_handler = handler;
@@ -1420,6 +1610,26 @@ void http_response_body(http_response_t* response, char const * body, int length
   response->content_length = length;
 }
 
+void http_response_body_iov(
+  http_response_t* response,
+  struct iovec const * iov,
+  int iovcnt,
+  void (*release)(void*),
+  void* userdata
+) {
+  // One extra slot is reserved in front for the response headers
+  response->body_iov = (struct iovec*)malloc(sizeof(struct iovec) * (iovcnt + 1));
+  assert(response->body_iov != NULL);
+  memcpy(response->body_iov + 1, iov, sizeof(struct iovec) * iovcnt);
+  response->body_iov_count = iovcnt;
+  response->body_iov_release = release;
+  response->body_iov_userdata = userdata;
+  response->content_length = 0;
+  for (int i = 0; i < iovcnt; i++) {
+    response->content_length += iov[i].iov_len;
+  }
+}
+
 typedef struct {
   char* buf;
   int capacity;
@@ -1510,11 +1720,21 @@ void http_end_response(http_request_t* request, http_response_t* response, grwpr
     free(tmp);
   }
   hs_free_buffer(request);
-  free(response);
   request->stream.buf = printctx->buf;
   request->stream.total_bytes = 0;
   request->stream.length = printctx->size;
   request->stream.capacity = printctx->capacity;
+  if (response->body_iov) {
+    response->body_iov[0].iov_base = printctx->buf;
+    response->body_iov[0].iov_len = printctx->size;
+    request->stream.length += response->content_length;
+    request->iov = response->body_iov;
+    request->iov_index = 0;
+    request->iov_count = response->body_iov_count + 1;
+    request->iov_release = response->body_iov_release;
+    request->iov_userdata = response->body_iov_userdata;
+  }
+  free(response);
   request->state = HTTP_SESSION_WRITE;
   hs_write_response(request);
 }
@@ -1529,6 +1749,37 @@ void http_respond(http_request_t* request, http_response_t* response) {
   http_end_response(request, response, &printctx);
 }
 
+void http_respond_async(http_request_t* request, http_response_t* response) {
+  http_server_t* serv = request->server;
+  hs_posted_t* posted = (hs_posted_t*)malloc(sizeof(hs_posted_t));
+  assert(posted != NULL);
+  posted->request = request;
+  posted->response = response;
+  pthread_mutex_lock(&serv->posted_lock);
+  posted->next = serv->posted;
+  serv->posted = posted;
+  pthread_mutex_unlock(&serv->posted_lock);
+  hs_wakeup(serv);
+}
+
+// Called on the thread of the event loop once it is woken up
+void hs_respond_posted(http_server_t* serv) {
+  pthread_mutex_lock(&serv->posted_lock);
+  hs_posted_t* posted = serv->posted;
+  serv->posted = NULL;
+  pthread_mutex_unlock(&serv->posted_lock);
+  while (posted) {
+    hs_posted_t* next = posted->next;
+    http_request_t* request = posted->request;
+    http_respond(request, posted->response);
+    if (HTTP_FLAG_CHECK(request->flags, HTTP_END_SESSION)) {
+      hs_end_session(request);
+    }
+    free(posted);
+    posted = next;
+  }
+}
+
 void http_respond_chunk(
   http_request_t* request,
   http_response_t* response,
@@ -1566,6 +1817,8 @@ void hs_server_listen_cb(struct kevent* ev) {
   http_server_t* server = (http_server_t*)ev->udata;
   if (ev->filter == EVFILT_TIMER) {
     hs_generate_date_time(server->date);
+  } else if (ev->filter == EVFILT_USER) {
+    hs_respond_posted(server);
   } else {
     hs_accept_connections(server);
   }
@@ -1574,6 +1827,8 @@ void hs_server_listen_cb(struct kevent* ev) {
 void hs_session_io_cb(struct kevent* ev) {
   http_request_t* request = (http_request_t*)ev->udata;
   if (ev->filter == EVFILT_TIMER) {
+    // The handler keeps the request until it responds
+    if (request->state == HTTP_SESSION_NOP) return;
     request->timeout -= 1;
     if (request->timeout == 0) hs_end_session(request);
   } else {
@@ -1583,8 +1838,15 @@ void hs_session_io_cb(struct kevent* ev) {
 
 void hs_server_init(http_server_t* serv) {
   serv->loop = kqueue();
+  struct kevent ev_set[2];
+  EV_SET(&ev_set[0], 1, EVFILT_TIMER, EV_ADD | EV_ENABLE, 0, 1000, serv);
+  EV_SET(&ev_set[1], 1, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, serv);
+  kevent(serv->loop, ev_set, 2, NULL, 0, NULL);
+}
+
+void hs_wakeup(http_server_t* serv) {
   struct kevent ev_set;
-  EV_SET(&ev_set, 1, EVFILT_TIMER, EV_ADD | EV_ENABLE, 0, 1000, serv);
+  EV_SET(&ev_set, 1, EVFILT_USER, 0, NOTE_TRIGGER, 0, serv);
   kevent(serv->loop, &ev_set, 1, NULL, 0, NULL);
 }
 
@@ -1644,6 +1906,398 @@ void hs_add_write_event(http_request_t* request) {
 
 #else
 
+#ifdef URING
+
+// *** io_uring platform specific ***
+
+// The low bits of the user data tell which operation completed, the rest is
+// the server or the session pointer
+#define HS_URING_ACCEPT 1
+#define HS_URING_TICK 2
+#define HS_URING_READ 3
+#define HS_URING_WRITE 4
+#define HS_URING_BUFFERS 5
+#define HS_URING_WAKEUP 6
+#define HS_URING_OP_MASK 7
+
+// Buffer group of the read buffers provided to the kernel
+#define HS_URING_BUFFER_GROUP 0
+
+#ifndef IORING_CQE_F_MORE
+#define IORING_CQE_F_MORE (1U << 1)
+#endif
+
+typedef struct hs_uring_s {
+  int fd;
+  unsigned tail;
+  unsigned* sq_head;
+  unsigned* sq_tail;
+  unsigned sq_mask;
+  unsigned sq_entries;
+  struct io_uring_sqe* sqes;
+  unsigned* cq_head;
+  unsigned* cq_tail;
+  unsigned cq_mask;
+  struct io_uring_cqe* cqes;
+  int multishot_accept;
+  struct __kernel_timespec tick;
+  uint64_t wakeup;
+  char* buffers;
+  http_request_t* sessions;
+} hs_uring_t;
+
+int hs_uring_enter(hs_uring_t* uring, unsigned wait) {
+  __atomic_store_n(uring->sq_tail, uring->tail, __ATOMIC_RELEASE);
+  unsigned submit = uring->tail - __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+  return syscall(
+    __NR_io_uring_enter, uring->fd, submit, wait, IORING_ENTER_GETEVENTS, NULL, 0
+  );
+}
+
+// Queued entries are only submitted on the next enter, unless the queue is full
+struct io_uring_sqe* hs_uring_sqe(hs_uring_t* uring, void* ptr, int op) {
+  while (uring->tail - __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE) == uring->sq_entries) {
+    hs_uring_enter(uring, 0);
+  }
+  struct io_uring_sqe* sqe = &uring->sqes[uring->tail & uring->sq_mask];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->user_data = (uint64_t)(uintptr_t)ptr | op;
+  uring->tail++;
+  return sqe;
+}
+
+void hs_uring_provide_buffers(hs_uring_t* uring, int index, int count) {
+  struct io_uring_sqe* sqe = hs_uring_sqe(uring, NULL, HS_URING_BUFFERS);
+  sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+  sqe->fd = count;
+  sqe->addr = (uintptr_t)(uring->buffers + (size_t)index * HTTP_URING_BUFFER_SIZE);
+  sqe->len = HTTP_URING_BUFFER_SIZE;
+  sqe->off = index;
+  sqe->buf_group = HS_URING_BUFFER_GROUP;
+}
+
+hs_uring_t* hs_uring_init(http_server_t* serv) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int fd = syscall(__NR_io_uring_setup, HTTP_URING_ENTRIES, &params);
+  if (fd < 0) return NULL;
+
+  // Without fast poll every socket operation would block a kernel worker
+  if (!(params.features & IORING_FEAT_FAST_POLL)) {
+    close(fd);
+    return NULL;
+  }
+
+  size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  size_t sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  int single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    if (cq_size > sq_size) sq_size = cq_size;
+    cq_size = sq_size;
+  }
+
+  int prot = PROT_READ | PROT_WRITE;
+  int flags = MAP_SHARED | MAP_POPULATE;
+  char* sq = (char*)mmap(NULL, sq_size, prot, flags, fd, IORING_OFF_SQ_RING);
+  char* cq = single_mmap ? sq : (char*)mmap(NULL, cq_size, prot, flags, fd, IORING_OFF_CQ_RING);
+  void* sqes = mmap(NULL, sqes_size, prot, flags, fd, IORING_OFF_SQES);
+  if (sq == MAP_FAILED || cq == MAP_FAILED || sqes == MAP_FAILED) {
+    if (sq != MAP_FAILED) munmap(sq, sq_size);
+    if (cq != MAP_FAILED && !single_mmap) munmap(cq, cq_size);
+    if (sqes != MAP_FAILED) munmap(sqes, sqes_size);
+    close(fd);
+    return NULL;
+  }
+
+  hs_uring_t* uring = (hs_uring_t*)calloc(1, sizeof(hs_uring_t));
+  assert(uring != NULL);
+  uring->fd = fd;
+  uring->sq_head = (unsigned*)(sq + params.sq_off.head);
+  uring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+  uring->sq_mask = *(unsigned*)(sq + params.sq_off.ring_mask);
+  uring->sq_entries = *(unsigned*)(sq + params.sq_off.ring_entries);
+  uring->sqes = (struct io_uring_sqe*)sqes;
+  uring->cq_head = (unsigned*)(cq + params.cq_off.head);
+  uring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+  uring->cq_mask = *(unsigned*)(cq + params.cq_off.ring_mask);
+  uring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+  uring->tail = *uring->sq_tail;
+  uring->tick.tv_sec = 1;
+#ifdef IORING_ACCEPT_MULTISHOT
+  uring->multishot_accept = 1;
+#endif
+
+  // The submission entries are always used in order
+  unsigned* array = (unsigned*)(sq + params.sq_off.array);
+  for (unsigned i = 0; i < uring->sq_entries; i++) array[i] = i;
+
+  // The read buffers are handed to the kernel once, it picks one only when
+  // data arrives, so idle keep-alive connections do not hold a buffer
+  uring->buffers = (char*)malloc((size_t)HTTP_URING_BUFFER_COUNT * HTTP_URING_BUFFER_SIZE);
+  assert(uring->buffers != NULL);
+  hs_uring_provide_buffers(uring, 0, HTTP_URING_BUFFER_COUNT);
+  hs_uring_enter(uring, 1);
+  unsigned head = *uring->cq_head;
+  if (uring->cqes[head & uring->cq_mask].res < 0) {
+    free(uring->buffers);
+    uring->buffers = NULL;
+  }
+  __atomic_store_n(uring->cq_head, head + 1, __ATOMIC_RELEASE);
+
+  serv->loop = fd;
+  return uring;
+}
+
+void hs_uring_accept(http_server_t* serv) {
+  struct io_uring_sqe* sqe = hs_uring_sqe(serv->uring, serv, HS_URING_ACCEPT);
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = serv->socket;
+  sqe->accept_flags = SOCK_NONBLOCK;
+#ifdef IORING_ACCEPT_MULTISHOT
+  if (serv->uring->multishot_accept) sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+#endif
+}
+
+void hs_uring_arm_tick(http_server_t* serv) {
+  struct io_uring_sqe* sqe = hs_uring_sqe(serv->uring, serv, HS_URING_TICK);
+  sqe->opcode = IORING_OP_TIMEOUT;
+  sqe->addr = (uintptr_t)&serv->uring->tick;
+  sqe->len = 1;
+}
+
+void hs_uring_arm_wakeup(http_server_t* serv) {
+  struct io_uring_sqe* sqe = hs_uring_sqe(serv->uring, serv, HS_URING_WAKEUP);
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = serv->wakeup;
+  sqe->addr = (uintptr_t)&serv->uring->wakeup;
+  sqe->len = sizeof(serv->uring->wakeup);
+}
+
+void hs_uring_start(http_server_t* serv) {
+  hs_uring_accept(serv);
+  hs_uring_arm_tick(serv);
+  hs_uring_arm_wakeup(serv);
+}
+
+void hs_uring_read(http_request_t* request) {
+  hs_uring_t* uring = request->server->uring;
+  hs_stream_t* stream = &request->stream;
+  hs_stream_alloc(stream, &request->server->memused);
+  struct io_uring_sqe* sqe = hs_uring_sqe(uring, request, HS_URING_READ);
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = request->socket;
+  int space = HTTP_MAX_REQUEST_BUF_SIZE - stream->length;
+  if (uring->buffers && !request->uring_direct && space > 0) {
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = HS_URING_BUFFER_GROUP;
+    sqe->len = space < HTTP_URING_BUFFER_SIZE ? space : HTTP_URING_BUFFER_SIZE;
+  } else {
+    hs_stream_grow(stream, stream->length + 1, &request->server->memused);
+    sqe->addr = (uintptr_t)(stream->buf + stream->length);
+    sqe->len = stream->capacity - stream->length;
+  }
+  request->uring_pending = 1;
+}
+
+void hs_uring_write(http_request_t* request) {
+  request->state = HTTP_SESSION_WRITE;
+  hs_reset_timeout(request, HTTP_REQUEST_TIMEOUT);
+  struct io_uring_sqe* sqe = hs_uring_sqe(request->server->uring, request, HS_URING_WRITE);
+  sqe->fd = request->socket;
+  if (request->iov) {
+    int count = request->iov_count - request->iov_index;
+    if (count > IOV_MAX) count = IOV_MAX;
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->addr = (uintptr_t)(request->iov + request->iov_index);
+    sqe->len = count;
+  } else {
+    sqe->opcode = IORING_OP_SEND;
+    sqe->addr = (uintptr_t)(request->stream.buf + request->stream.total_bytes);
+    sqe->len = request->stream.length - request->stream.total_bytes;
+    sqe->msg_flags = MSG_NOSIGNAL;
+  }
+  request->uring_pending = 1;
+}
+
+void hs_uring_keep_alive(http_request_t* request) {
+  hs_init_session(request);
+  request->state = HTTP_SESSION_READ;
+  hs_uring_read(request);
+}
+
+void hs_uring_end_session(http_request_t* session) {
+  HTTP_FLAG_SET(session->flags, HTTP_END_SESSION);
+  if (session->uring_pending) {
+    // The pending operation completes once the socket is shut down and the
+    // session is freed then
+    shutdown(session->socket, SHUT_RDWR);
+    return;
+  }
+  hs_uring_t* uring = session->server->uring;
+  if (session->uring_prev) session->uring_prev->uring_next = session->uring_next;
+  else uring->sessions = session->uring_next;
+  if (session->uring_next) session->uring_next->uring_prev = session->uring_prev;
+  close(session->socket);
+  hs_free_buffer(session);
+  free(session->tokens.buf);
+  session->tokens.buf = NULL;
+  free(session);
+}
+
+void hs_uring_accepted(http_server_t* serv, struct io_uring_cqe* cqe) {
+  hs_uring_t* uring = serv->uring;
+  if (cqe->res == -EINVAL && uring->multishot_accept) {
+    // Multishot accepts need Linux 5.19, accept one connection per entry
+    uring->multishot_accept = 0;
+    hs_uring_accept(serv);
+    return;
+  }
+  if (!uring->multishot_accept || !(cqe->flags & IORING_CQE_F_MORE)) {
+    hs_uring_accept(serv);
+  }
+  if (cqe->res < 0) return;
+  http_request_t* session = (http_request_t*)calloc(1, sizeof(http_request_t));
+  assert(session != NULL);
+  session->socket = cqe->res;
+  session->server = serv;
+  session->timeout = HTTP_REQUEST_TIMEOUT;
+  session->uring_next = uring->sessions;
+  if (uring->sessions) uring->sessions->uring_prev = session;
+  uring->sessions = session;
+  http_session(session);
+}
+
+void hs_uring_read_complete(http_request_t* request, struct io_uring_cqe* cqe) {
+  hs_uring_t* uring = request->server->uring;
+  request->uring_pending = 0;
+  int direct = request->uring_direct;
+  request->uring_direct = 0;
+  int res = cqe->res;
+  char* buffer = NULL;
+  int index = 0;
+  if (cqe->flags & IORING_CQE_F_BUFFER) {
+    index = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    buffer = uring->buffers + (size_t)index * HTTP_URING_BUFFER_SIZE;
+  }
+  if (res > 0 && !HTTP_FLAG_CHECK(request->flags, HTTP_END_SESSION)) {
+    hs_stream_t* stream = &request->stream;
+    if (buffer) {
+      hs_stream_grow(stream, stream->length + res, &request->server->memused);
+      memcpy(stream->buf + stream->length, buffer, res);
+    }
+    stream->length += res;
+    stream->total_bytes += res;
+  }
+  if (buffer) hs_uring_provide_buffers(uring, index, 1);
+
+  if (HTTP_FLAG_CHECK(request->flags, HTTP_END_SESSION)) {
+    hs_uring_end_session(request);
+    return;
+  }
+  if (res == -ENOBUFS && !direct) {
+    // Every buffer is in use, read straight into the request buffer
+    request->uring_direct = 1;
+    hs_uring_read(request);
+    return;
+  }
+  if (res == -EAGAIN || res == -EINTR) {
+    hs_uring_read(request);
+    return;
+  }
+  if (res <= 0) {
+    hs_uring_end_session(request);
+    return;
+  }
+
+  hs_reset_timeout(request, HTTP_REQUEST_TIMEOUT);
+  hs_process_request_stream(request);
+  if (HTTP_FLAG_CHECK(request->flags, HTTP_END_SESSION)) {
+    hs_uring_end_session(request);
+  } else if (request->state == HTTP_SESSION_READ && !request->uring_pending) {
+    hs_uring_read(request);
+  }
+}
+
+void hs_uring_write_complete(http_request_t* request, struct io_uring_cqe* cqe) {
+  request->uring_pending = 0;
+  int res = cqe->res;
+  if (HTTP_FLAG_CHECK(request->flags, HTTP_END_SESSION)) {
+    hs_uring_end_session(request);
+    return;
+  }
+  if (res == -EAGAIN || res == -EINTR) {
+    hs_uring_write(request);
+    return;
+  }
+  if (res < 0) {
+    hs_uring_end_session(request);
+    return;
+  }
+  if (request->iov) hs_advance_iov(request, res);
+  request->stream.total_bytes += res;
+  if (request->stream.total_bytes != request->stream.length) {
+    hs_uring_write(request);
+    return;
+  }
+  hs_write_complete(request);
+  if (HTTP_FLAG_CHECK(request->flags, HTTP_END_SESSION)) {
+    hs_uring_end_session(request);
+  }
+}
+
+void hs_uring_tick(http_server_t* serv) {
+  hs_generate_date_time(serv->date);
+  hs_uring_arm_tick(serv);
+  http_request_t* session = serv->uring->sessions;
+  while (session) {
+    http_request_t* next = session->uring_next;
+    // The handler keeps the request until it responds
+    if (session->state != HTTP_SESSION_NOP) {
+      session->timeout -= 1;
+      if (session->timeout == 0) hs_uring_end_session(session);
+    }
+    session = next;
+  }
+}
+
+// Submits the queued entries and handles every completion, waiting for at
+// least one completion when wait is set
+int hs_uring_poll(http_server_t* serv, int wait) {
+  hs_uring_t* uring = serv->uring;
+  hs_uring_enter(uring, wait ? 1 : 0);
+  int count = 0;
+  unsigned head = *uring->cq_head;
+  while (head != __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE)) {
+    struct io_uring_cqe cqe = uring->cqes[head & uring->cq_mask];
+    head++;
+    __atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+    void* ptr = (void*)(uintptr_t)(cqe.user_data & ~(uint64_t)HS_URING_OP_MASK);
+    switch (cqe.user_data & HS_URING_OP_MASK) {
+      case HS_URING_ACCEPT:
+        hs_uring_accepted(serv, &cqe);
+        break;
+      case HS_URING_TICK:
+        hs_uring_tick(serv);
+        break;
+      case HS_URING_READ:
+        hs_uring_read_complete((http_request_t*)ptr, &cqe);
+        break;
+      case HS_URING_WRITE:
+        hs_uring_write_complete((http_request_t*)ptr, &cqe);
+        break;
+      case HS_URING_WAKEUP:
+        hs_uring_arm_wakeup(serv);
+        hs_respond_posted(serv);
+        break;
+    }
+    count++;
+  }
+  return count;
+}
+
+#endif
+
 // *** epoll platform specific ***
 
 void hs_server_listen_cb(struct epoll_event* ev) {
@@ -1662,16 +2316,35 @@ void hs_server_timer_cb(struct epoll_event* ev) {
   hs_generate_date_time(server->date);
 }
 
+void hs_server_wakeup_cb(struct epoll_event* ev) {
+  http_server_t* server = (http_server_t*)((char*)ev->data.ptr - offsetof(http_server_t, wakeup_handler));
+  uint64_t res;
+  int bytes = read(server->wakeup, &res, sizeof(res));
+  (void)bytes; // suppress warning
+  hs_respond_posted(server);
+}
+
+void hs_wakeup(http_server_t* serv) {
+  uint64_t one = 1;
+  int bytes = write(serv->wakeup, &one, sizeof(one));
+  (void)bytes; // suppress warning
+}
+
 void hs_request_timer_cb(struct epoll_event* ev) {
   http_request_t* request = (http_request_t*)((char*)ev->data.ptr - sizeof(epoll_cb_t));
   uint64_t res;
   int bytes = read(request->timerfd, &res, sizeof(res));
   (void)bytes; // suppress warning
+  // The handler keeps the request until it responds
+  if (request->state == HTTP_SESSION_NOP) return;
   request->timeout -= 1;
   if (request->timeout == 0) hs_end_session(request);
 }
 
 void hs_add_server_sock_events(http_server_t* serv) {
+#ifdef URING
+  if (serv->uring) return hs_uring_start(serv);
+#endif
   struct epoll_event ev;
   ev.events = EPOLLIN | EPOLLET;
   ev.data.ptr = serv;
@@ -1679,6 +2352,12 @@ void hs_add_server_sock_events(http_server_t* serv) {
 }
 
 void hs_server_init(http_server_t* serv) {
+  // Written by the threads responding to a request of this loop
+  serv->wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#ifdef URING
+  serv->uring = hs_uring_init(serv);
+  if (serv->uring) return;
+#endif
   serv->loop = epoll_create1(0);
   serv->timer_handler = hs_server_timer_cb;
 
@@ -1693,10 +2372,20 @@ void hs_server_init(http_server_t* serv) {
   ev.data.ptr = &serv->timer_handler;
   epoll_ctl(serv->loop, EPOLL_CTL_ADD, tfd, &ev);
   serv->timerfd = tfd;
+
+  serv->wakeup_handler = hs_server_wakeup_cb;
+  ev.events = EPOLLIN | EPOLLET;
+  ev.data.ptr = &serv->wakeup_handler;
+  epoll_ctl(serv->loop, EPOLL_CTL_ADD, serv->wakeup, &ev);
 }
 
 int http_server_listen_addr(http_server_t* serv, const char* ipaddr) {
   http_listen(serv, ipaddr);
+#ifdef URING
+  if (serv->uring) {
+    while (1) hs_uring_poll(serv, 1);
+  }
+#endif
   struct epoll_event ev_list[1];
   while (1) {
     int nev = epoll_wait(serv->loop, ev_list, 1, -1);
@@ -1719,6 +2408,9 @@ void hs_delete_events(http_request_t* request) {
 }
 
 int http_server_poll(http_server_t* serv) {
+#ifdef URING
+  if (serv->uring) return hs_uring_poll(serv, 0);
+#endif
   struct epoll_event ev;
   int nev = epoll_wait(serv->loop, &ev, 1, 0);
   if (nev <= 0) return nev;
@@ -1750,8 +2442,9 @@ void hs_add_events(http_request_t* request) {
 }
 
 void hs_add_write_event(http_request_t* request) {
+  // Keep watching for reads, the next keep-alive request arrives on the same socket
   struct epoll_event ev;
-  ev.events = EPOLLOUT | EPOLLET;
+  ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
   ev.data.ptr = request;
   epoll_ctl(request->server->loop, EPOLL_CTL_MOD, request->socket, &ev);
 }